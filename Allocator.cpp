@@ -1,11 +1,14 @@
 #include "Allocator.h"
+#include <chrono>
+#include <algorithm>
+#include <cstring>
 #include "VM.h"
 namespace CynicScript
 {
     SINGLETON_IMPL(Allocator)
 
     Allocator::Allocator()
-        : mObjectChain(nullptr)
+        : mGlobalVariableCount(GLOBAL_VARIABLE_MAX), mObjectChain(nullptr), mBytesAllocated(0)
     {
         ResetStatus();
     }
@@ -17,22 +20,29 @@ namespace CynicScript
 
     void Allocator::ResetStatus()
     {
-        if (mObjectChain)
-            FreeObjects();
-
-        mBytesAllocated = 0;
         mNextGCByteSize = 256;
-        mObjectChain = nullptr;
 
         mCallFrameTop = mCallFrameStack;
         mStackTop = mValueStack;
 
         mOpenUpValues = nullptr;
 
-        memset(mGlobalVariableList, 0, sizeof(Value) * GLOBAL_VARIABLE_MAX);
+        mImportedModules.clear();
+
+        memset(mGlobalVariableList, 0, sizeof(Value) * mGlobalVariableCount);
 
-        for (int32_t i = 0; i < LibraryManager::GetInstance()->GetLibraries().size(); ++i)
+        mGlobalVariableCount = LibraryManager::GetInstance()->GetLibraries().size();
+        for (size_t i = 0; i < mGlobalVariableCount; ++i)
             mGlobalVariableList[i] = LibraryManager::GetInstance()->GetLibraries()[i];
+
+        // with the roots reset only the interned strings survive,compiled functions and loaded images keep pointing at them
+        if (mObjectChain)
+        {
+            MarkRootObjects();
+            MarkGrayObjects();
+            ClearWeakReferences();
+            Sweep();
+        }
     }
 
     void Allocator::FreeObjects()
@@ -41,18 +51,37 @@ namespace CynicScript
         Object *object = mObjectChain;
         while (object != nullptr)
         {
-            Object *next = object->next;
-            size_t objBytes = sizeof(*object);
-            mBytesAllocated -= objBytes;
-            SAFE_DELETE(object);
+            Object *next = object->GetNext();
+            FreeObject(object);
             object = next;
         }
+        mObjectChain = nullptr;
 
 #ifdef CYS_GC_DEBUG
         Logger::Info(TEXT("collected {} bytes (from {} to {}) next gc bytes {}"), bytes - mBytesAllocated, bytes, mNextGCByteSize);
 #endif
     }
 
+    void Allocator::FreeObject(Object *object)
+    {
+#ifdef CYS_GC_DEBUG
+        Logger::Info(TEXT("delete object(0x{})"), (void *)object);
+#endif
+        size_t objBytes = SizeOfObject(object);
+        mBytesAllocated -= objBytes;
+
+        mGCStats.totalBytesFreed += objBytes;
+        mGCStats.totalObjectsFreed++;
+        mGCStats.liveObjectCount[object->kind]--;
+        mGCStats.liveObjectBytes[object->kind] -= objBytes;
+
+#ifdef CYS_HEAP_PROFILE
+        HeapProfiler::GetInstance()->RecordFree(object);
+#endif
+
+        DestroyObject(object);
+    }
+
     void Allocator::PushStack(const Value &value)
     {
 #ifndef NDEBUG
@@ -161,26 +190,99 @@ namespace CynicScript
 
     Value *Allocator::GetGlobalVariable(size_t idx)
     {
+        mGlobalVariableCount = std::max(mGlobalVariableCount, idx + 1);
         return &mGlobalVariableList[idx];
     }
 
     void Allocator::SetGlobalVariable(size_t idx, const Value &v)
     {
+        mGlobalVariableCount = std::max(mGlobalVariableCount, idx + 1);
         mGlobalVariableList[idx] = v;
     }
 
+    GCStats Allocator::GetGCStats() const
+    {
+        GCStats stats = mGCStats;
+        stats.heapBytes = mBytesAllocated;
+        stats.nextGCBytes = mNextGCByteSize;
+        return stats;
+    }
+
+    void Allocator::ResetGCStats()
+    {
+        auto liveObjectCount = mGCStats.liveObjectCount;
+        auto liveObjectBytes = mGCStats.liveObjectBytes;
+
+        mGCStats = GCStats();
+        mGCStats.peakHeapBytes = mBytesAllocated;
+        // live objects are the current heap state rather than a counter,keep them
+        mGCStats.liveObjectCount = liveObjectCount;
+        mGCStats.liveObjectBytes = liveObjectBytes;
+    }
+
+    ModuleObject *Allocator::GetImportedModule(const std::string &path) const
+    {
+        auto iter = mImportedModules.find(path);
+        return iter != mImportedModules.end() ? iter->second : nullptr;
+    }
+
+    void Allocator::SetImportedModule(const std::string &path, ModuleObject *moduleObj)
+    {
+        mImportedModules[path] = moduleObj;
+    }
+
+    StrObject *Allocator::InternStr(STRING_VIEW str)
+    {
+        std::lock_guard<std::mutex> lock(mInternedStrMutex);
+        auto [iter, isNew] = mInternedStrs.try_emplace(STRING(str), nullptr);
+        if (isNew)
+        {
+            // compiler workers and imports intern wherever the vm stopped,no collection starts from here but from a later allocation
+            auto isGCPaused = mIsGCPaused;
+            mIsGCPaused = true;
+            iter->second = CreateObject<StrObject>(str);
+            mIsGCPaused = isGCPaused;
+        }
+        return iter->second;
+    }
+
+    bool Allocator::IsInterned(const StrObject *str)
+    {
+        std::lock_guard<std::mutex> lock(mInternedStrMutex);
+        auto iter = mInternedStrs.find(str->value);
+        return iter != mInternedStrs.end() && iter->second == str;
+    }
+
     void Allocator::GC()
     {
 #ifdef CYS_GC_DEBUG
         Logger::Info(TEXT("begin gc"));
         size_t bytes = mBytesAllocated;
 #endif
+        auto start = std::chrono::steady_clock::now();
 
         MarkRootObjects();
         MarkGrayObjects();
+        MarkEphemerons();
+        ClearWeakReferences();
         Sweep();
         mNextGCByteSize = mBytesAllocated * GC_HEAP_GROW_FACTOR;
 
+        uint64_t pauseNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        uint64_t pauseUs = pauseNs / 1000;
+        size_t bucket = 0;
+        while (pauseUs > 0 && bucket < GC_PAUSE_HISTOGRAM_BUCKET_COUNT - 1)
+        {
+            pauseUs >>= 1;
+            bucket++;
+        }
+
+        mGCStats.collectionCount++;
+        mGCStats.totalPauseNs += pauseNs;
+        if (pauseNs > mGCStats.maxPauseNs)
+            mGCStats.maxPauseNs = pauseNs;
+        mGCStats.pauseHistogram[bucket]++;
+
 #ifdef CYS_GC_DEBUG
         Logger::Info(TEXT("end gc"));
         Logger::Info(TEXT("    collected {} bytes (from {} to {}) next gc bytes {}"), bytes - mBytesAllocated, bytes, mNextGCByteSize);
@@ -196,9 +298,15 @@ namespace CynicScript
         for (UpValueObject *upvalue = mOpenUpValues; upvalue != nullptr; upvalue = upvalue->nextUpValue)
             upvalue->Mark();
 
-        for (int32_t i = 0; i < GLOBAL_VARIABLE_MAX; ++i)
+        for (size_t i = 0; i < mGlobalVariableCount; ++i)
             if (mGlobalVariableList[i] != Value())
                 mGlobalVariableList[i].Mark();
+
+        for (const auto &[path, moduleObj] : mImportedModules)
+            moduleObj->Mark();
+
+        for (const auto &[str, strObj] : mInternedStrs)
+            strObj->Mark();
     }
 
     void Allocator::MarkGrayObjects()
@@ -211,6 +319,51 @@ namespace CynicScript
         }
     }
 
+    void Allocator::MarkEphemerons()
+    {
+        // a value in a weak key dict is reachable only if its key is,marking a value may revive keys of other entries,so iterate to a fixpoint
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (auto dict : mWeakKeyDicts)
+            {
+                for (auto &[k, v] : dict->elements)
+                {
+                    if (CYS_IS_OBJECT_VALUE(k) && k.object->marked && CYS_IS_OBJECT_VALUE(v) && !v.object->marked)
+                    {
+                        v.Mark();
+                        changed = true;
+                    }
+                }
+            }
+
+            if (changed)
+                MarkGrayObjects();
+        }
+    }
+
+    void Allocator::ClearWeakReferences()
+    {
+        for (auto weakRef : mWeakRefs)
+            if (!weakRef->target->marked)
+                weakRef->target = nullptr;
+
+        for (auto dict : mWeakKeyDicts)
+        {
+            for (auto iter = dict->elements.begin(); iter != dict->elements.end();)
+            {
+                if (CYS_IS_OBJECT_VALUE(iter->first) && !iter->first.object->marked)
+                    iter = dict->elements.erase(iter);
+                else
+                    ++iter;
+            }
+        }
+
+        mWeakRefs.clear();
+        mWeakKeyDicts.clear();
+    }
+
     void Allocator::Sweep()
     {
         Object *previous = nullptr;
@@ -221,14 +374,14 @@ namespace CynicScript
             {
                 object->UnMark();
                 previous = object;
-                object = object->next;
+                object = object->GetNext();
             }
             else
             {
                 Object *unreached = object;
-                object = object->next;
+                object = object->GetNext();
                 if (previous != nullptr)
-                    previous->next = object;
+                    previous->SetNext(object);
                 else
                     mObjectChain = object;
 
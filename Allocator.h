@@ -1,22 +1,53 @@
 #pragma once
 #include <vector>
+#include <array>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include "Object.h"
 #include "Value.h"
 #include "Utils.h"
 #include "Logger.h"
+#include "HeapProfiler.h"
 
 namespace CynicScript
 {
     struct CallFrame
     {
         ClosureObject *closure = nullptr;
-        uint8_t *ip = nullptr;
+        const uint8_t *ip = nullptr; // may point into a read-only mapped bytecode image
         Value *slots = nullptr;
 
 #ifdef CYS_FUNCTION_CACHE_OPT
         size_t argumentsHash;
 #endif
+
+#ifdef CYS_HEAP_PROFILE
+        const Token *relatedToken = nullptr; // token of the instruction currently executing in this frame
+#endif
+    };
+
+    struct GCStats
+    {
+        size_t collectionCount{0};
+        uint64_t totalPauseNs{0};
+        uint64_t maxPauseNs{0};
+        // bucket 0 counts pauses below 1us,bucket i counts pauses in [2^(i-1),2^i)us,the last bucket takes everything longer
+        std::array<size_t, GC_PAUSE_HISTOGRAM_BUCKET_COUNT> pauseHistogram{};
+
+        size_t totalBytesAllocated{0};
+        size_t totalBytesFreed{0};
+        size_t totalObjectsAllocated{0};
+        size_t totalObjectsFreed{0};
+
+        size_t heapBytes{0};
+        size_t peakHeapBytes{0};
+        size_t nextGCBytes{0};
+
+        std::array<size_t, OBJECT_KIND_COUNT> liveObjectCount{};
+        std::array<size_t, OBJECT_KIND_COUNT> liveObjectBytes{};
     };
+
     class CYS_API Allocator
     {
     public:
@@ -51,35 +82,66 @@ namespace CynicScript
         Value *GetGlobalVariable(size_t idx);
         void SetGlobalVariable(size_t idx, const Value &v);
 
+        GCStats GetGCStats() const;
+        void ResetGCStats();
+
+        // module objects of imported files by absolute path,nullptr for a file not imported yet(see OP_IMPORT)
+        ModuleObject *GetImportedModule(const std::string &path) const;
+        void SetImportedModule(const std::string &path, ModuleObject *moduleObj);
+
+        // one string object per content for the whole process,shared by every compiler and loaded image,
+        // so equal names of different files stay equal dict keys(see ValueHash).Only names are interned,string
+        // literals can be changed in place(see OP_SET_INDEX) and get an object of their own.
+        // Interned strings are gc roots and live as long as the process,thread safe as functions compile on worker threads
+        StrObject *InternStr(STRING_VIEW str);
+        bool IsInterned(const StrObject *str);
+
     private:
         Allocator();
         ~Allocator();
 
-        template <class T>
-        void FreeObject(T *object);
+        void FreeObject(Object *object);
         void FreeObjects();
         void GC();
 
         void MarkRootObjects();
         void MarkGrayObjects();
+        void MarkEphemerons();
+        void ClearWeakReferences();
         void Sweep();
 
         Value mGlobalVariableList[GLOBAL_VARIABLE_MAX];
+        size_t mGlobalVariableCount; // one past the highest global slot touched,only these are marked and cleared
 
         Value *mStackTop;
         Value mValueStack[STACK_MAX];
 
         CallFrame *mCallFrameTop;
-        CallFrame mCallFrameStack[STACK_MAX];
+        CallFrame mCallFrameStack[CALL_FRAME_MAX];
 
         UpValueObject *mOpenUpValues;
 
+        std::unordered_map<std::string, ModuleObject *> mImportedModules;
+
+        std::unordered_map<STRING, StrObject *> mInternedStrs;
+        std::mutex mInternedStrMutex;
+
         friend struct Object;
+        friend struct DictObject;
+        friend struct WeakRefObject;
+        friend class HeapSnapshot;
+        friend class HeapImage;
 
         Object *mObjectChain;
         std::vector<Object *> mGrayObjects;
+        std::vector<Object *> *mTracedReferences{nullptr}; // non-null while a heap snapshot collects references through Blacken()
+        std::vector<WeakRefObject *> mWeakRefs;             // weak references reached while marking
+        std::vector<DictObject *> mWeakKeyDicts;            // weak key dicts reached while marking
         size_t mBytesAllocated;
         size_t mNextGCByteSize;
+        bool mIsGCPaused{false}; // while a heap image is restored,its objects are only reachable once it is complete
+
+        GCStats mGCStats;
     };
 
     template <class T, typename... Args>
@@ -88,32 +150,36 @@ namespace CynicScript
         T *object = new T(std::forward<Args>(params)...);
         size_t objBytes = sizeof(*object);
         mBytesAllocated += objBytes;
+
+        mGCStats.totalBytesAllocated += objBytes;
+        mGCStats.totalObjectsAllocated++;
+        mGCStats.liveObjectCount[object->kind]++;
+        mGCStats.liveObjectBytes[object->kind] += objBytes;
+        if (mBytesAllocated > mGCStats.peakHeapBytes)
+            mGCStats.peakHeapBytes = mBytesAllocated;
+
+        if (!mIsGCPaused)
+        {
 #ifdef CYS_GC_STRESS
-        GC();
-#endif
-        if (mBytesAllocated > mNextGCByteSize)
             GC();
+#endif
+            if (mBytesAllocated > mNextGCByteSize)
+                GC();
+        }
 
-        object->next = mObjectChain;
+        object->SetNext(mObjectChain);
         object->marked = false;
         mObjectChain = object;
 #ifdef CYS_GC_DEBUG
         Logger::Info(TEXT("{} has been add to gc record chain {} for {}"), (void *)object, objBytes, object->kind);
 #endif
+#ifdef CYS_HEAP_PROFILE
+        HeapProfiler::GetInstance()->RecordAllocation(object, objBytes);
+#endif
 
         return object;
     }
 
-    template <class T>
-    inline void Allocator::FreeObject(T *object)
-    {
-#ifdef CYS_GC_DEBUG
-        Logger::Info(TEXT("delete object(0x{})"), (void *)object);
-#endif
-        mBytesAllocated -= sizeof(object);
-        SAFE_DELETE(object);
-    }
-
 #define GET_GLOBAL_VARIABLE(idx) (Allocator::GetInstance()->GetGlobalVariable(idx))
 
 #define PUSH_STACK(v) (Allocator::GetInstance()->PushStack(v))
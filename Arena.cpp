@@ -0,0 +1,57 @@
+#include "Arena.h"
+#include <algorithm>
+
+namespace CynicScript
+{
+	Arena::Arena(size_t blockSize)
+		: mBlockSize(blockSize), mCur(nullptr), mEnd(nullptr), mAllocatedBytes(0)
+	{
+	}
+
+	Arena::~Arena()
+	{
+		RunDestructors();
+		for (auto &block : mBlocks)
+			delete[] block.data;
+	}
+
+	void Arena::Reset()
+	{
+		RunDestructors();
+
+		// keep the first block for reuse,large arenas shrink back to a single block
+		for (size_t i = 1; i < mBlocks.size(); ++i)
+			delete[] mBlocks[i].data;
+		if (!mBlocks.empty())
+		{
+			mBlocks.resize(1);
+			mCur = mBlocks[0].data;
+			mEnd = mBlocks[0].data + mBlocks[0].size;
+		}
+
+		mAllocatedBytes = 0;
+	}
+
+	size_t Arena::GetAllocatedBytes() const
+	{
+		return mAllocatedBytes;
+	}
+
+	void Arena::AllocateBlock(size_t minSize)
+	{
+		Block block;
+		block.size = std::max(mBlockSize, minSize);
+		block.data = new uint8_t[block.size];
+		mBlocks.emplace_back(block);
+
+		mCur = block.data;
+		mEnd = block.data + block.size;
+	}
+
+	void Arena::RunDestructors()
+	{
+		for (auto iter = mDestructors.rbegin(); iter != mDestructors.rend(); ++iter)
+			iter->destroy(iter->object);
+		mDestructors.clear();
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "Utils.h"
+
+namespace CynicScript
+{
+	// Bump pointer allocator,everything allocated from an arena is released as a unit by Reset() or on destruction.
+	// Destructors of non trivially destructible objects are recorded and run in reverse allocation order on release.
+	class CYS_API Arena
+	{
+		NON_COPYABLE(Arena)
+	public:
+		Arena(size_t blockSize = ARENA_DEFAULT_BLOCK_SIZE);
+		~Arena();
+
+		template <typename T, typename... Args>
+		T *New(Args &&...params);
+
+		void *Allocate(size_t size, size_t alignment);
+
+		void Reset();
+
+		size_t GetAllocatedBytes() const;
+
+	private:
+		struct Block
+		{
+			uint8_t *data{nullptr};
+			size_t size{0};
+		};
+
+		struct Destructor
+		{
+			void (*destroy)(void *object);
+			void *object;
+		};
+
+		void AllocateBlock(size_t minSize);
+		void RunDestructors();
+
+		size_t mBlockSize;
+		std::vector<Block> mBlocks;
+		uint8_t *mCur;
+		uint8_t *mEnd;
+		size_t mAllocatedBytes;
+		std::vector<Destructor> mDestructors;
+	};
+
+	template <typename T, typename... Args>
+	inline T *Arena::New(Args &&...params)
+	{
+		void *memory = Allocate(sizeof(T), alignof(T));
+		T *object = new (memory) T(std::forward<Args>(params)...);
+		if constexpr (!std::is_trivially_destructible_v<T>)
+			mDestructors.push_back({[](void *p)
+									{ static_cast<T *>(p)->~T(); },
+									object});
+		return object;
+	}
+
+	inline void *Arena::Allocate(size_t size, size_t alignment)
+	{
+		uintptr_t aligned = ((uintptr_t)mCur + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		if (mCur == nullptr || aligned + size > (uintptr_t)mEnd)
+		{
+			AllocateBlock(size + alignment);
+			aligned = ((uintptr_t)mCur + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		}
+
+		mCur = (uint8_t *)(aligned + size);
+		mAllocatedBytes += size;
+		return (void *)aligned;
+	}
+}
@@ -1,7 +1,38 @@
 #include "Ast.h"
+#include <cstddef>
 
 namespace CynicScript
 {
+	SINGLETON_IMPL(AstArena)
+
+	AstArena::~AstArena()
+	{
+		Release();
+	}
+
+	void *AstArena::Allocate(size_t size)
+	{
+		return mArena.Allocate(size, alignof(std::max_align_t));
+	}
+
+	void AstArena::Record(AstNode *node)
+	{
+		mNodes.emplace_back(node);
+	}
+
+	void AstArena::Release()
+	{
+		for (auto iter = mNodes.rbegin(); iter != mNodes.rend(); ++iter)
+			(*iter)->~AstNode();
+		mNodes.clear();
+		mArena.Reset();
+	}
+
+	size_t AstArena::GetAllocatedBytes() const
+	{
+		return mArena.GetAllocatedBytes();
+	}
+
 	//----------------------Expressions-----------------------------
 
 	LiteralExpr::LiteralExpr(Token *tagToken)
@@ -89,7 +120,6 @@ namespace CynicScript
 	}
 	VarDescExpr::~VarDescExpr()
 	{
-		SAFE_DELETE(name);
 	}
 #ifndef NDEBUG
 	STRING VarDescExpr::ToString()
@@ -162,7 +192,6 @@ namespace CynicScript
 	}
 	GroupExpr::~GroupExpr()
 	{
-		SAFE_DELETE(expr);
 	}
 
 #ifndef NDEBUG
@@ -182,7 +211,6 @@ namespace CynicScript
 	}
 	PrefixExpr::~PrefixExpr()
 	{
-		SAFE_DELETE(right);
 	}
 #ifndef NDEBUG
 	STRING PrefixExpr::ToString()
@@ -200,8 +228,6 @@ namespace CynicScript
 	}
 	InfixExpr::~InfixExpr()
 	{
-		SAFE_DELETE(left);
-		SAFE_DELETE(right);
 	}
 #ifndef NDEBUG
 	STRING InfixExpr::ToString()
@@ -220,7 +246,6 @@ namespace CynicScript
 	}
 	PostfixExpr::~PostfixExpr()
 	{
-		SAFE_DELETE(left);
 	}
 
 #ifndef NDEBUG
@@ -240,9 +265,6 @@ namespace CynicScript
 	}
 	ConditionExpr::~ConditionExpr()
 	{
-		SAFE_DELETE(condition);
-		SAFE_DELETE(trueBranch);
-		SAFE_DELETE(falseBranch);
 	}
 #ifndef NDEBUG
 	STRING ConditionExpr::ToString()
@@ -260,8 +282,6 @@ namespace CynicScript
 	}
 	IndexExpr::~IndexExpr()
 	{
-		SAFE_DELETE(ds);
-		SAFE_DELETE(index);
 	}
 #ifndef NDEBUG
 	STRING IndexExpr::ToString()
@@ -280,7 +300,6 @@ namespace CynicScript
 	}
 	RefExpr::~RefExpr()
 	{
-		SAFE_DELETE(refExpr);
 	}
 #ifndef NDEBUG
 	STRING RefExpr::ToString()
@@ -299,7 +318,6 @@ namespace CynicScript
 	LambdaExpr::~LambdaExpr()
 	{
 		std::vector<VarDescExpr *>().swap(parameters);
-		SAFE_DELETE(body);
 	}
 #ifndef NDEBUG
 	STRING LambdaExpr::ToString()
@@ -327,7 +345,6 @@ namespace CynicScript
 	}
 	CallExpr::~CallExpr()
 	{
-		SAFE_DELETE(callee);
 		std::vector<Expr *>().swap(arguments);
 	}
 #ifndef NDEBUG
@@ -356,8 +373,6 @@ namespace CynicScript
 	}
 	DotExpr::~DotExpr()
 	{
-		SAFE_DELETE(callee);
-		SAFE_DELETE(callMember);
 	}
 #ifndef NDEBUG
 	STRING DotExpr::ToString()
@@ -375,7 +390,6 @@ namespace CynicScript
 	}
 	NewExpr::~NewExpr()
 	{
-		SAFE_DELETE(callee);
 	}
 #ifndef NDEBUG
 	STRING NewExpr::ToString()
@@ -405,7 +419,6 @@ namespace CynicScript
 	}
 	BaseExpr::~BaseExpr()
 	{
-		SAFE_DELETE(callMember);
 	}
 #ifndef NDEBUG
 	STRING BaseExpr::ToString()
@@ -424,7 +437,6 @@ namespace CynicScript
 	}
 	CompoundExpr::~CompoundExpr()
 	{
-		SAFE_DELETE(endExpr);
 		std::vector<Stmt *>().swap(stmts);
 	}
 #ifndef NDEBUG
@@ -475,7 +487,6 @@ namespace CynicScript
 	}
 	VarArgExpr::~VarArgExpr()
 	{
-		SAFE_DELETE(argName);
 	}
 #ifndef NDEBUG
 	STRING VarArgExpr::ToString()
@@ -493,7 +504,6 @@ namespace CynicScript
 	}
 	FactorialExpr::~FactorialExpr()
 	{
-		SAFE_DELETE(expr);
 	}
 #ifndef NDEBUG
 	STRING FactorialExpr::ToString()
@@ -540,7 +550,6 @@ namespace CynicScript
 	}
 	ExprStmt::~ExprStmt()
 	{
-		SAFE_DELETE(expr);
 	}
 #ifndef NDEBUG
 	STRING ExprStmt::ToString()
@@ -558,7 +567,6 @@ namespace CynicScript
 	}
 	ReturnStmt::~ReturnStmt()
 	{
-		SAFE_DELETE(expr);
 	}
 #ifndef NDEBUG
 	STRING ReturnStmt::ToString()
@@ -583,9 +591,6 @@ namespace CynicScript
 	}
 	IfStmt::~IfStmt()
 	{
-		SAFE_DELETE(condition);
-		SAFE_DELETE(thenBranch);
-		SAFE_DELETE(elseBranch);
 	}
 #ifndef NDEBUG
 	STRING IfStmt::ToString()
@@ -631,9 +636,6 @@ namespace CynicScript
 	}
 	WhileStmt::~WhileStmt()
 	{
-		SAFE_DELETE(condition);
-		SAFE_DELETE(body);
-		SAFE_DELETE(increment);
 	}
 #ifndef NDEBUG
 	STRING WhileStmt::ToString()
@@ -739,7 +741,6 @@ namespace CynicScript
 	}
 	EnumDecl::~EnumDecl()
 	{
-		SAFE_DELETE(name);
 		std::unordered_map<IdentifierExpr *, Expr *>().swap(enumItems);
 	}
 
@@ -778,17 +779,19 @@ namespace CynicScript
 	}
 	ModuleDecl::~ModuleDecl()
 	{
-		SAFE_DELETE(name);
 		std::vector<VarDecl *>().swap(varItems);
 		std::vector<ClassDecl *>().swap(classItems);
 		std::vector<ModuleDecl *>().swap(moduleItems);
 		std::vector<EnumDecl *>().swap(enumItems);
 		std::vector<FunctionDecl *>().swap(functionItems);
+		std::vector<ImportDecl *>().swap(importItems);
 	}
 #ifndef NDEBUG
 	STRING ModuleDecl::ToString()
 	{
 		STRING result = TEXT("module ") + name->ToString() + TEXT("\n{\n");
+		for (const auto &item : importItems)
+			result += item->ToString() + TEXT("\n");
 		for (const auto &item : varItems)
 			result += item->ToString() + TEXT("\n");
 		for (const auto &item : classItems)
@@ -803,6 +806,24 @@ namespace CynicScript
 	}
 #endif
 
+	ImportDecl::ImportDecl(Token *tagToken)
+		: Decl(tagToken, AstKind::IMPORT), name(nullptr)
+	{
+	}
+	ImportDecl::ImportDecl(Token *tagToken, IdentifierExpr *name, STRING_VIEW path)
+		: Decl(tagToken, AstKind::IMPORT), name(name), path(path)
+	{
+	}
+	ImportDecl::~ImportDecl()
+	{
+	}
+#ifndef NDEBUG
+	STRING ImportDecl::ToString()
+	{
+		return TEXT("import \"") + path + TEXT("\";");
+	}
+#endif
+
 	FunctionDecl::FunctionDecl(Token *tagToken)
 		: Decl(tagToken, AstKind::FUNCTION), name(nullptr), body(nullptr)
 	{
@@ -815,9 +836,7 @@ namespace CynicScript
 
 	FunctionDecl::~FunctionDecl()
 	{
-		SAFE_DELETE(name);
 		std::vector<VarDescExpr *>().swap(parameters);
-		SAFE_DELETE(body);
 	}
 #ifndef NDEBUG
 	STRING FunctionDecl::ToString()
@@ -6,6 +6,7 @@
 #include "Type.h"
 #include "Token.h"
 #include "Utils.h"
+#include "Arena.h"
 namespace CynicScript
 {
 	enum class AstKind
@@ -47,13 +48,41 @@ namespace CynicScript
 		FUNCTION,
 		CLASS,
 		MODULE,
+		IMPORT,
 		ASTSTMTS,
 	};
 
+	struct AstNode;
+
+	// Owns every ast node of the current compilation,parser,passes and compiler all allocate nodes from it with plain new.
+	// Nodes never delete their children,the whole tree is destroyed and its memory reclaimed at once by Release().
+	class CYS_API AstArena
+	{
+	public:
+		SINGLETON_DECL(AstArena)
+
+		void *Allocate(size_t size);
+		void Record(AstNode *node);
+
+		void Release();
+
+		size_t GetAllocatedBytes() const;
+
+	private:
+		AstArena() = default;
+		~AstArena();
+
+		Arena mArena;
+		std::vector<AstNode *> mNodes;
+	};
+
 	struct AstNode
 	{
-		AstNode(Token *tagToken, AstKind kind) : tagToken(tagToken), kind(kind) {}
+		AstNode(Token *tagToken, AstKind kind) : tagToken(tagToken), kind(kind) { AstArena::GetInstance()->Record(this); }
 		virtual ~AstNode() {}
+
+		static void *operator new(size_t size) { return AstArena::GetInstance()->Allocate(size); }
+		static void operator delete(void *) noexcept {} // released with the arena
 #ifndef NDEBUG
 		virtual STRING ToString() = 0;
 #endif
@@ -559,6 +588,8 @@ namespace CynicScript
 		std::vector<std::pair<MemberPrivilege, EnumDecl *>> enumerations;
 	};
 
+	struct ImportDecl;
+
 	struct ModuleDecl : public Decl
 	{
 		ModuleDecl(Token *tagToken);
@@ -581,5 +612,21 @@ namespace CynicScript
 		std::vector<ModuleDecl *> moduleItems;
 		std::vector<EnumDecl *> enumItems;
 		std::vector<FunctionDecl *> functionItems;
+		std::vector<ImportDecl *> importItems; // only for the module compiled from an imported file
+	};
+
+	// import "path";binds the module compiled from the file to the stem of its file name
+	struct ImportDecl : public Decl
+	{
+		ImportDecl(Token *tagToken);
+		ImportDecl(Token *tagToken, IdentifierExpr *name, STRING_VIEW path);
+		~ImportDecl() override;
+
+#ifndef NDEBUG
+		STRING ToString() override;
+#endif
+
+		IdentifierExpr *name;
+		STRING path; // as written,see ModuleManager::Resolve()
 	};
 }
\ No newline at end of file
@@ -47,6 +47,7 @@ namespace CynicScript
             case AstKind::FUNCTION:
             case AstKind::CLASS:
             case AstKind::MODULE:
+            case AstKind::IMPORT:
                 return ExecuteDecl((Decl *)stmt);
             case AstKind::ASTSTMTS:
                 return ExecuteAstStmts((AstStmts *)stmt);
@@ -69,6 +70,8 @@ namespace CynicScript
                 return ExecuteClassDecl((ClassDecl *)decl);
             case AstKind::MODULE:
                 return ExecuteModuleDecl((ModuleDecl *)decl);
+            case AstKind::IMPORT:
+                return ExecuteImportDecl((ImportDecl *)decl);
             default:
                 return decl;
             }
@@ -80,6 +83,7 @@ namespace CynicScript
         virtual Decl *ExecuteFunctionDecl(FunctionDecl *decl) { return decl; }
         virtual Decl *ExecuteModuleDecl(ModuleDecl *decl) { return decl; }
         virtual Decl *ExecuteClassDecl(ClassDecl *decl) { return decl; }
+        virtual Decl *ExecuteImportDecl(ImportDecl *decl) { return decl; }
 
         virtual Stmt *ExecuteExprStmt(ExprStmt *stmt) { return stmt; }
         virtual Stmt *ExecuteReturnStmt(ReturnStmt *stmt) { return stmt; }
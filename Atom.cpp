@@ -0,0 +1,20 @@
+#include "Atom.h"
+
+namespace CynicScript
+{
+	SINGLETON_IMPL(AtomTable)
+
+	Atom AtomTable::Intern(SOURCE_STRING_VIEW name)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto iter = mAtoms.find(name);
+		if (iter != mAtoms.end())
+			return iter->second;
+
+		const auto &storedName = mNames.emplace_back(name);
+		auto atom = static_cast<Atom>(mNames.size());
+		mAtoms.emplace(storedName, atom);
+		return atom;
+	}
+}
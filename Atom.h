@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "Utils.h"
+
+namespace CynicScript
+{
+	// Identifiers interned to integers,equal names get the same atom for the whole process,so the compiler
+	// compares and hashes them as integers instead of strings.0 is never handed out.
+	using Atom = uint32_t;
+
+	constexpr Atom NO_ATOM = 0;
+
+	class CYS_API AtomTable
+	{
+	public:
+		SINGLETON_DECL(AtomTable)
+
+		// thread safe,the lexers of a parallel scan intern concurrently
+		Atom Intern(SOURCE_STRING_VIEW name);
+
+	private:
+		AtomTable() = default;
+		~AtomTable() = default;
+
+		std::mutex mMutex;
+		std::deque<SOURCE_STRING> mNames;					 // name of atom i+1,a deque never moves its elements
+		std::unordered_map<SOURCE_STRING_VIEW, Atom> mAtoms; // keys view into mNames
+	};
+}
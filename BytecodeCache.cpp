@@ -0,0 +1,251 @@
+#include "BytecodeCache.h"
+#include <array>
+#include <random>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+#include <cstdlib>
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#include "Version.h"
+#include "Logger.h"
+
+namespace CynicScript
+{
+	namespace
+	{
+		// programs compiled by another interpreter or format version never hit the cache,
+		// neither do modules compiled under another name or the same file run as a program
+		uint64_t GetSeed(uint64_t moduleNameHash)
+		{
+			const std::array<uint32_t, 3> versions = {CYS_BINARY_FILE_MAGIC_NUMBER, CYS_VERSION_BINARY, CYS_BINARY_FORMAT_VERSION};
+			return HashBytes(&moduleNameHash, sizeof(moduleNameHash), HashBytes(versions.data(), sizeof(versions)));
+		}
+
+		// never 0,which stands for a program
+		uint64_t HashModuleName(STRING_VIEW moduleName)
+		{
+			auto hash = HashBytes(moduleName.data(), moduleName.size() * sizeof(moduleName[0]));
+			return hash != 0 ? hash : 1;
+		}
+
+		std::string ToHexString(uint64_t value)
+		{
+			constexpr char digits[] = "0123456789abcdef";
+			std::string result(16, '0');
+			for (size_t i = 0; i < 16; ++i)
+				result[15 - i] = digits[(value >> (i * 4)) & 0xF];
+			return result;
+		}
+
+		// per user,a shared directory would let other users plant the program run for a source
+		std::string GetDefaultDirectory()
+		{
+#if defined(_WIN32) || defined(_WIN64)
+			if (auto localAppData = std::getenv("LOCALAPPDATA"); localAppData && localAppData[0] != '\0')
+				return (std::filesystem::path(localAppData) / "CynicScript" / "Cache").string();
+#else
+			if (auto cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome && cacheHome[0] == '/') // relative paths are ignored like the spec says
+				return (std::filesystem::path(cacheHome) / "CynicScript").string();
+			if (auto home = std::getenv("HOME"); home && home[0] == '/')
+				return (std::filesystem::path(home) / ".cache" / "CynicScript").string();
+#endif
+			return {};
+		}
+
+		// the cache directory and its entries must be owned by the current user and writable by nobody else,
+		// symbolic links are not followed.Windows relies on the acl of the per user directory
+		bool IsPrivatePath(const std::string &path, bool isDirectory)
+		{
+#if defined(_WIN32) || defined(_WIN64)
+			return true;
+#else
+			struct stat status;
+			if (lstat(path.c_str(), &status) != 0)
+				return false;
+			if (isDirectory ? !S_ISDIR(status.st_mode) : !S_ISREG(status.st_mode))
+				return false;
+			return status.st_uid == geteuid() && (status.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+#endif
+		}
+
+		// the parents are created with the default mode,the cache directory itself only accessible by the current user
+		bool PrepareDirectory(const std::string &directory)
+		{
+			std::error_code error;
+			std::filesystem::path path(directory);
+			if (path.has_parent_path())
+			{
+				std::filesystem::create_directories(path.parent_path(), error);
+				if (error)
+					return false;
+			}
+#if defined(_WIN32) || defined(_WIN64)
+			std::filesystem::create_directory(path, error);
+			if (error)
+				return false;
+#else
+			if (mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST)
+				return false;
+#endif
+			return IsPrivatePath(directory, true);
+		}
+
+		void CheckProgramHeader(const BytecodeImage &image)
+		{
+			const auto &header = image.GetHeader();
+			if (header.magicNumber != CYS_BINARY_FILE_MAGIC_NUMBER)
+				CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,cannot deserialize from this file"));
+			if (header.version != CYS_VERSION_BINARY)
+				CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file version of {},current version is {}"), header.version, CYS_VERSION_BINARY);
+			if (header.formatVersion != CYS_BINARY_FORMAT_VERSION)
+				CYS_LOG_ERROR(TEXT("Invalid CynicScript binary format version of {},current format version is {}"), header.formatVersion, CYS_BINARY_FORMAT_VERSION);
+			if (header.imageSize != image.GetSize())
+				CYS_LOG_ERROR(TEXT("Truncated CynicScript binary file:{},expect {} bytes but got {}"), Logger::Record::mCurFilePath, header.imageSize, image.GetSize());
+			if (header.flags & BYTECODE_FLAG_HEAP_IMAGE)
+				CYS_LOG_ERROR(TEXT("{} is a heap image,not a program"), Logger::Record::mCurFilePath);
+			if (header.flags & BYTECODE_FLAG_MODULE)
+				CYS_LOG_ERROR(TEXT("{} is an imported module,not a program"), Logger::Record::mCurFilePath);
+			if (!image.IsIntact())
+				CYS_LOG_ERROR(TEXT("Corrupted CynicScript binary file:{}"), Logger::Record::mCurFilePath);
+		}
+	}
+
+	BytecodeCache::BytecodeCache()
+		: mDirectory(GetDefaultDirectory())
+	{
+	}
+
+	void BytecodeCache::SetDirectory(std::string_view directory)
+	{
+		mDirectory = directory;
+	}
+
+	FunctionObject *BytecodeCache::Load(std::string_view sourcePath, STRING_VIEW moduleName)
+	{
+		mCachePath.clear();
+		if (mDirectory.empty() || !mSource->Open(sourcePath))
+			return nullptr;
+
+		SOURCE_STRING_VIEW source(reinterpret_cast<const SOURCE_CHAR_T *>(mSource->GetData()), mSource->GetSize());
+		if (source.starts_with(UTF8_BOM))
+			source.remove_prefix(UTF8_BOM.size());
+
+		mModuleNameHash = moduleName.empty() ? 0 : HashModuleName(moduleName);
+		mSourceHash = HashBytes(source.data(), source.size(), GetSeed(mModuleNameHash));
+		mSourceSize = source.size();
+		mCachePath = (std::filesystem::path(mDirectory) / (ToHexString(mSourceHash) + CYS_BINARY_FILE_EXTENSION)).string();
+
+		if (!IsPrivatePath(mDirectory, true) || !IsPrivatePath(mCachePath, false))
+			return nullptr;
+
+		auto image = std::make_unique<BytecodeImage>();
+		if (!image->Open(mCachePath))
+			return nullptr;
+
+		// a damaged file is a miss like a stale one,not an error:the image hash makes sure the chunks decoded lazily
+		// later are what was stored,so a run never fails halfway on a cache entry
+		const auto &header = image->GetHeader();
+		if (header.magicNumber != CYS_BINARY_FILE_MAGIC_NUMBER ||
+			header.version != CYS_VERSION_BINARY ||
+			header.formatVersion != CYS_BINARY_FORMAT_VERSION ||
+			header.sourceHash != mSourceHash ||
+			header.sourceSize != mSourceSize ||
+			header.moduleNameHash != mModuleNameHash ||
+			((header.flags & BYTECODE_FLAG_MODULE) != 0) != (mModuleNameHash != 0) ||
+			header.imageSize != image->GetSize() ||
+			(header.flags & BYTECODE_FLAG_HEAP_IMAGE) ||
+			!image->IsIntact())
+			return nullptr;
+
+		// the rebuilt tokens are reported against this source like the scanned ones would
+		image->SetSourceId(Logger::RecordSourceFile(sourcePath, source));
+		mLoadedSources.emplace_back(std::move(mSource));
+		mSource = std::make_unique<MappedFile>();
+		return mImages.emplace_back(std::move(image))->LoadMainFunction();
+	}
+
+	void BytecodeCache::Store(const FunctionObject *mainFunc)
+	{
+		if (mCachePath.empty())
+			return;
+
+		if (!PrepareDirectory(mDirectory))
+			return;
+
+		std::error_code error;
+
+		// written aside and renamed into place,so concurrent runs never read a partial file
+		auto tempPath = mCachePath + "." + ToHexString(std::random_device{}()) + ".tmp";
+		{
+			BytecodeWriter writer(mSourceHash, mSourceSize, false, mModuleNameHash != 0 ? BYTECODE_FLAG_MODULE : 0, mModuleNameHash);
+			mainFunc->Serialize(writer);
+			auto image = writer.Finish();
+			std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return;
+			file.write(reinterpret_cast<const char *>(image.data()), image.size());
+			if (!file.good())
+			{
+				file.close();
+				std::filesystem::remove(tempPath, error);
+				return;
+			}
+		}
+
+		// whatever the umask,Load() skips entries writable by others
+		std::filesystem::permissions(tempPath, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write, error);
+		if (error)
+		{
+			std::filesystem::remove(tempPath, error);
+			return;
+		}
+
+		std::filesystem::rename(tempPath, mCachePath, error);
+		if (error)
+			std::filesystem::remove(tempPath, error);
+	}
+
+	FunctionObject *BytecodeCache::LoadProgram(std::string_view path)
+	{
+		Logger::RecordFilePath(path);
+		Logger::RecordSource(SOURCE_STRING_VIEW()); // tokens are reported by line,the source is not shipped with the binary
+
+		auto image = std::make_unique<BytecodeImage>();
+		if (!image->Open(path))
+			CYS_LOG_ERROR(TEXT("Failed to open file or not a CynicScript binary file:{}"), Logger::Record::mCurFilePath);
+
+		CheckProgramHeader(*image);
+		return mImages.emplace_back(std::move(image))->LoadMainFunction();
+	}
+
+	FunctionObject *BytecodeCache::LoadImage(std::span<const uint8_t> data, std::string_view sourcePath)
+	{
+		SOURCE_STRING_VIEW source;
+		auto &sourceFile = mLoadedSources.emplace_back(std::make_unique<MappedFile>());
+		if (sourceFile->Open(sourcePath))
+		{
+			source = SOURCE_STRING_VIEW(reinterpret_cast<const SOURCE_CHAR_T *>(sourceFile->GetData()), sourceFile->GetSize());
+			if (source.starts_with(UTF8_BOM))
+				source.remove_prefix(UTF8_BOM.size());
+		}
+
+		auto image = std::make_unique<BytecodeImage>();
+		image->SetSourceId(Logger::RecordSourceFile(sourcePath, source));
+		if (!image->Open(data))
+			CYS_LOG_ERROR(TEXT("Not a CynicScript binary image,compiled from:{}"), Logger::Record::mCurFilePath);
+
+		CheckProgramHeader(*image);
+		return mImages.emplace_back(std::move(image))->LoadMainFunction();
+	}
+
+	std::vector<uint8_t> BytecodeCache::Serialize(const FunctionObject *mainFunc, uint64_t sourceHash, uint64_t sourceSize, bool isStringTableCompressed)
+	{
+		BytecodeWriter writer(sourceHash, sourceSize, isStringTableCompressed);
+		mainFunc->Serialize(writer);
+		return writer.Finish();
+	}
+}
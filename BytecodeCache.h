@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include "Utils.h"
+#include "MappedFile.h"
+#include "BytecodeImage.h"
+#include "Object.h"
+
+namespace CynicScript
+{
+	// Compiled programs written to disk and loaded back without running the front end(see BytecodeImage.h for the format).
+	//
+	// Files are mapped and executed in place:opcodes are never copied,constants are decoded when first used
+	// and function bodies when first called,so loading costs little more than validating the header and
+	// hashing the image once.
+	//
+	// As a cache,Load() hashes the source together with the interpreter and format version(and the module name for an
+	// imported file) and looks for <directory>/<hash>.cysc,a missing,stale or damaged file is a miss and Store()
+	// replaces it after compiling.
+	// The directory defaults to $XDG_CACHE_HOME/CynicScript or ~/.cache/CynicScript(%LOCALAPPDATA%\CynicScript\Cache
+	// on windows),it is created 0700 and neither it nor its entries are used unless owned by and private to the current user.
+	class CYS_API BytecodeCache
+	{
+		NON_COPYABLE(BytecodeCache)
+	public:
+		BytecodeCache();
+		~BytecodeCache() = default;
+
+		void SetDirectory(std::string_view directory);
+
+		// the cached program of the source file,nullptr on a miss.The source stays mapped for error reports.
+		// An imported module is cached apart from the same file run as a program and from other modules of the same content
+		FunctionObject *Load(std::string_view sourcePath, STRING_VIEW moduleName = {});
+		// write the program compiled for the source of the last Load(),failures only cost the next run a recompile
+		void Store(const FunctionObject *mainFunc);
+
+		// load a binary file written by -s,errors are fatal
+		FunctionObject *LoadProgram(std::string_view path);
+		// load an image held in memory that was compiled from the source file,the data has to outlive the cache.
+		// Like a cache hit the source is mapped for error reports
+		FunctionObject *LoadImage(std::span<const uint8_t> data, std::string_view sourcePath);
+
+		static std::vector<uint8_t> Serialize(const FunctionObject *mainFunc, uint64_t sourceHash = 0, uint64_t sourceSize = 0, bool isStringTableCompressed = false);
+
+	private:
+		std::string mDirectory;
+
+		std::unique_ptr<MappedFile> mSource{std::make_unique<MappedFile>()}; // hashed by the last Load()
+		std::vector<std::unique_ptr<MappedFile>> mLoadedSources;				// of the loaded programs,reported against until the cache goes
+		uint64_t mSourceHash{0};
+		uint64_t mSourceSize{0};
+		uint64_t mModuleNameHash{0}; // 0 when the last Load() was of a program
+		std::string mCachePath;
+
+		std::vector<std::unique_ptr<BytecodeImage>> mImages; // chunks loaded from them execute in place,kept mapped as long as the cache lives
+	};
+}
@@ -0,0 +1,365 @@
+#include "BytecodeImage.h"
+#include <array>
+#include <algorithm>
+#include "Version.h"
+#include "Object.h"
+#include "Allocator.h"
+#include "Logger.h"
+
+namespace CynicScript
+{
+	namespace
+	{
+		// positions of the header fields filled in by BytecodeWriter::Finish()
+		constexpr size_t HEADER_IMAGE_SIZE_POSITION = 4 + 4 + 4 + 8 + 8 + 8;
+		constexpr size_t HEADER_STRING_TABLE_OFFSET_POSITION = HEADER_IMAGE_SIZE_POSITION + 8;
+		constexpr size_t HEADER_IMAGE_HASH_POSITION = HEADER_STRING_TABLE_OFFSET_POSITION + 4 + 1;
+
+		uint64_t HashImage(std::span<const uint8_t> data)
+		{
+			auto headerHash = HashBytes(data.data(), HEADER_IMAGE_HASH_POSITION);
+			return HashBytes(data.data() + BYTECODE_HEADER_SIZE, data.size() - BYTECODE_HEADER_SIZE, headerHash);
+		}
+
+		constexpr size_t LZ_MIN_MATCH_LENGTH = 4;
+		constexpr size_t LZ_HASH_BITS = 14;
+
+		uint32_t HashLzSequence(const uint8_t *p)
+		{
+			uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+			return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+		}
+
+		// Greedy LZ77 over the string table,which repeats identifier stems and common words a lot.
+		// Output is a sequence of:varuint literal count,literals,then unless the input ends there,
+		// varuint match distance and varuint match length minus LZ_MIN_MATCH_LENGTH.
+		std::vector<uint8_t> LzCompress(std::span<const uint8_t> input)
+		{
+			std::vector<uint8_t> result;
+			std::vector<uint32_t> lastPositions(1 << LZ_HASH_BITS, UINT32_MAX);
+
+			size_t literalStart = 0;
+			size_t i = 0;
+			while (i + LZ_MIN_MATCH_LENGTH <= input.size())
+			{
+				auto hash = HashLzSequence(input.data() + i);
+				auto candidate = lastPositions[hash];
+				lastPositions[hash] = static_cast<uint32_t>(i);
+
+				size_t matchLength = 0;
+				if (candidate != UINT32_MAX)
+					while (i + matchLength < input.size() && input[candidate + matchLength] == input[i + matchLength])
+						matchLength++;
+
+				if (matchLength < LZ_MIN_MATCH_LENGTH)
+				{
+					i++;
+					continue;
+				}
+
+				ByteConverter::WriteVarUint(result, i - literalStart);
+				result.insert(result.end(), input.begin() + literalStart, input.begin() + i);
+				ByteConverter::WriteVarUint(result, i - candidate);
+				ByteConverter::WriteVarUint(result, matchLength - LZ_MIN_MATCH_LENGTH);
+
+				i += matchLength;
+				literalStart = i;
+			}
+
+			ByteConverter::WriteVarUint(result, input.size() - literalStart);
+			result.insert(result.end(), input.begin() + literalStart, input.end());
+			return result;
+		}
+
+		std::vector<uint8_t> LzDecompress(std::span<const uint8_t> input, size_t decompressedSize)
+		{
+			std::vector<uint8_t> result;
+			result.reserve(decompressedSize);
+
+			size_t offset = 0;
+			while (true)
+			{
+				auto literalCount = ByteConverter::ReadVarUint(input, offset);
+				auto literals = ByteConverter::ReadBytes(input, offset, literalCount);
+				result.insert(result.end(), literals, literals + literalCount);
+				if (offset == input.size())
+					break;
+
+				auto distance = ByteConverter::ReadVarUint(input, offset);
+				auto matchLength = ByteConverter::ReadVarUint(input, offset) + LZ_MIN_MATCH_LENGTH;
+				if (distance == 0 || distance > result.size() || matchLength > decompressedSize - result.size())
+					CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,damaged compressed string table"));
+
+				// byte by byte,a match may overlap the bytes it produces
+				auto from = result.size() - distance;
+				for (size_t i = 0; i < matchLength; ++i)
+					result.emplace_back(result[from + i]);
+			}
+
+			if (result.size() != decompressedSize)
+				CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,string table decompressed to {} bytes instead of {}"), result.size(), decompressedSize);
+			return result;
+		}
+	}
+
+	BytecodeWriter::BytecodeWriter(uint64_t sourceHash, uint64_t sourceSize, bool isStringTableCompressed, uint8_t flags, uint64_t moduleNameHash)
+		: mIsStringTableCompressed(isStringTableCompressed)
+	{
+		WriteU32(CYS_BINARY_FILE_MAGIC_NUMBER);
+		WriteU32(CYS_VERSION_BINARY);
+		WriteU32(CYS_BINARY_FORMAT_VERSION);
+		WriteU64(sourceHash);
+		WriteU64(sourceSize);
+		WriteU64(moduleNameHash);
+		WriteU64(0); // image size
+		WriteU32(0); // string table offset
+		WriteU8(flags | (isStringTableCompressed ? BYTECODE_FLAG_COMPRESSED_STRING_TABLE : 0));
+		WriteU64(0); // image hash
+	}
+
+	void BytecodeWriter::WriteU8(uint8_t integer)
+	{
+		ByteConverter::WriteU8(mData, integer);
+	}
+
+	void BytecodeWriter::WriteU32(uint32_t integer)
+	{
+		ByteConverter::WriteU32(mData, integer);
+	}
+
+	void BytecodeWriter::WriteU64(uint64_t integer)
+	{
+		ByteConverter::WriteU64(mData, integer);
+	}
+
+	void BytecodeWriter::WriteVarUint(uint64_t integer)
+	{
+		ByteConverter::WriteVarUint(mData, integer);
+	}
+
+	void BytecodeWriter::WriteVarInt(int64_t integer)
+	{
+		ByteConverter::WriteVarInt(mData, integer);
+	}
+
+	void BytecodeWriter::WriteBytes(const uint8_t *bytes, size_t size)
+	{
+		mData.insert(mData.end(), bytes, bytes + size);
+	}
+
+	void BytecodeWriter::WriteString(SOURCE_STRING_VIEW str)
+	{
+		auto [iter, isNew] = mStringIndices.try_emplace(SOURCE_STRING(str), static_cast<uint32_t>(mStringOffsets.size()));
+		if (isNew)
+		{
+			mStringOffsets.emplace_back(static_cast<uint32_t>(mStringBytes.size()));
+			ByteConverter::WriteVarUint(mStringBytes, str.size());
+			mStringBytes.insert(mStringBytes.end(), str.begin(), str.end());
+		}
+		WriteVarUint(iter->second);
+	}
+
+	size_t BytecodeWriter::GetPosition() const
+	{
+		return mData.size();
+	}
+
+	void BytecodeWriter::PatchU32(size_t position, uint32_t integer)
+	{
+		auto bytes = ByteConverter::ToU32ByteList(integer);
+		std::copy(bytes.begin(), bytes.end(), mData.begin() + position);
+	}
+
+	void BytecodeWriter::AlignToPage(size_t size)
+	{
+		auto pageOffset = mData.size() % BYTECODE_IMAGE_PAGE_SIZE;
+		if (pageOffset != 0 && (size > BYTECODE_IMAGE_PAGE_SIZE || pageOffset + size > BYTECODE_IMAGE_PAGE_SIZE))
+			mData.resize(mData.size() + BYTECODE_IMAGE_PAGE_SIZE - pageOffset, 0);
+	}
+
+	std::vector<uint8_t> BytecodeWriter::Finish()
+	{
+		// string table:u32 string count,u32 offsets of the strings,then each string as varuint length and utf-8 bytes
+		std::vector<uint8_t> stringTable;
+		stringTable.reserve(4 + mStringOffsets.size() * 4 + mStringBytes.size());
+		ByteConverter::WriteU32(stringTable, static_cast<uint32_t>(mStringOffsets.size()));
+		for (const auto &offset : mStringOffsets)
+			ByteConverter::WriteU32(stringTable, offset);
+		stringTable.insert(stringTable.end(), mStringBytes.begin(), mStringBytes.end());
+
+		PatchU32(HEADER_STRING_TABLE_OFFSET_POSITION, static_cast<uint32_t>(mData.size()));
+		if (mIsStringTableCompressed)
+		{
+			// prefixed with its decompressed size
+			WriteVarUint(stringTable.size());
+			auto compressed = LzCompress(stringTable);
+			WriteBytes(compressed.data(), compressed.size());
+		}
+		else
+		{
+			WriteBytes(stringTable.data(), stringTable.size());
+		}
+
+		auto imageSize = ByteConverter::ToU64ByteList(mData.size());
+		std::copy(imageSize.begin(), imageSize.end(), mData.begin() + HEADER_IMAGE_SIZE_POSITION);
+
+		auto imageHash = ByteConverter::ToU64ByteList(HashImage(mData));
+		std::copy(imageHash.begin(), imageHash.end(), mData.begin() + HEADER_IMAGE_HASH_POSITION);
+		return std::move(mData);
+	}
+
+	bool BytecodeImage::Open(std::string_view path)
+	{
+		if (!mFile.Open(path) || mFile.GetSize() < BYTECODE_HEADER_SIZE)
+			return false;
+
+		mData = std::span<const uint8_t>(mFile.GetData(), mFile.GetSize());
+		ReadHeader();
+		return true;
+	}
+
+	bool BytecodeImage::Open(std::span<const uint8_t> data)
+	{
+		if (data.size() < BYTECODE_HEADER_SIZE)
+			return false;
+
+		mFile.Close();
+		mData = data;
+		ReadHeader();
+		return true;
+	}
+
+	void BytecodeImage::ReadHeader()
+	{
+		size_t offset = 0;
+		mHeader.magicNumber = ReadU32(offset);
+		mHeader.version = ReadU32(offset);
+		mHeader.formatVersion = ReadU32(offset);
+		mHeader.sourceHash = ReadU64(offset);
+		mHeader.sourceSize = ReadU64(offset);
+		mHeader.moduleNameHash = ReadU64(offset);
+		mHeader.imageSize = ReadU64(offset);
+		mHeader.stringTableOffset = ReadU32(offset);
+		mHeader.flags = ReadU8(offset);
+		mHeader.imageHash = ReadU64(offset);
+	}
+
+	const BytecodeHeader &BytecodeImage::GetHeader() const
+	{
+		return mHeader;
+	}
+
+	size_t BytecodeImage::GetSize() const
+	{
+		return mData.size();
+	}
+
+	bool BytecodeImage::IsIntact() const
+	{
+		return HashImage(mData) == mHeader.imageHash;
+	}
+
+	FunctionObject *BytecodeImage::LoadMainFunction()
+	{
+		LoadStringTable();
+
+		size_t offset = BYTECODE_HEADER_SIZE;
+		auto mainFunc = new FunctionObject();
+		mainFunc->Deserialize(*this, offset);
+		return mainFunc;
+	}
+
+	void BytecodeImage::LoadStringTable()
+	{
+		size_t offset = mHeader.stringTableOffset;
+		if (mHeader.flags & BYTECODE_FLAG_COMPRESSED_STRING_TABLE)
+		{
+			auto decompressedSize = ReadVarUint(offset);
+			mDecompressedStringTable = LzDecompress(mData.subspan(offset), decompressedSize);
+			mStringTable = mDecompressedStringTable;
+		}
+		else
+		{
+			ReadBytes(offset, 0);
+			mStringTable = mData.subspan(offset);
+		}
+
+		size_t tableOffset = 0;
+		mStringCount = ByteConverter::ReadU32(mStringTable, tableOffset);
+		ByteConverter::ReadBytes(mStringTable, tableOffset, static_cast<size_t>(mStringCount) * 4);
+		mStrObjects.assign(mStringCount, nullptr);
+	}
+
+	uint8_t BytecodeImage::ReadU8(size_t &offset) const
+	{
+		return ByteConverter::ReadU8(mData, offset);
+	}
+
+	uint32_t BytecodeImage::ReadU32(size_t &offset) const
+	{
+		return ByteConverter::ReadU32(mData, offset);
+	}
+
+	uint64_t BytecodeImage::ReadU64(size_t &offset) const
+	{
+		return ByteConverter::ReadU64(mData, offset);
+	}
+
+	uint64_t BytecodeImage::ReadVarUint(size_t &offset) const
+	{
+		return ByteConverter::ReadVarUint(mData, offset);
+	}
+
+	int64_t BytecodeImage::ReadVarInt(size_t &offset) const
+	{
+		return ByteConverter::ReadVarInt(mData, offset);
+	}
+
+	const uint8_t *BytecodeImage::ReadBytes(size_t &offset, size_t size) const
+	{
+		return ByteConverter::ReadBytes(mData, offset, size);
+	}
+
+	SOURCE_STRING_VIEW BytecodeImage::ReadString(size_t &offset) const
+	{
+		auto idx = ReadVarUint(offset);
+		if (idx >= mStringCount)
+			CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,string index {} out of range {}"), idx, mStringCount);
+
+		size_t offsetPos = 4 + idx * 4;
+		size_t stringOffset = 4 + static_cast<size_t>(mStringCount) * 4 + ByteConverter::ReadU32(mStringTable, offsetPos);
+		auto size = ByteConverter::ReadVarUint(mStringTable, stringOffset);
+		return SOURCE_STRING_VIEW(reinterpret_cast<const SOURCE_CHAR_T *>(ByteConverter::ReadBytes(mStringTable, stringOffset, size)), size);
+	}
+
+	StrObject *BytecodeImage::ReadStrObject(size_t &offset) const
+	{
+		size_t indexOffset = offset;
+		auto idx = ReadVarUint(indexOffset);
+		if (idx < mStrObjects.size() && mStrObjects[idx])
+		{
+			offset = indexOffset;
+			return mStrObjects[idx];
+		}
+
+		// the constants of the image share their objects with every other compiled or loaded file
+		auto str = Allocator::GetInstance()->InternStr(SourceToString(ReadString(offset)));
+		mStrObjects[idx] = str;
+		return str;
+	}
+
+	Arena &BytecodeImage::GetTokenArena() const
+	{
+		return mTokenArena;
+	}
+
+	void BytecodeImage::SetSourceId(uint32_t sourceId)
+	{
+		mSourceId = sourceId;
+	}
+
+	uint32_t BytecodeImage::GetSourceId() const
+	{
+		return mSourceId;
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "Utils.h"
+#include "Arena.h"
+#include "MappedFile.h"
+
+namespace CynicScript
+{
+	struct FunctionObject;
+	struct StrObject;
+
+	// Binary file layout:
+	//     header(fixed size,integers big endian,see BytecodeHeader)
+	//     the main FunctionObject,nested functions,strings and enums are serialized inline as constants(see Chunk::Serialize)
+	//     string table:every string of the program once,referred to by index
+	//
+	// Counts,lengths,indices and integers are LEB128 varints(integers zigzag encoded),offsets that are filled in
+	// after what they point to is written are fixed u32.The string table may be stored compressed,the rest of the
+	// image never is because opcodes are executed in place from the mapping.
+	struct BytecodeHeader
+	{
+		uint32_t magicNumber{0};
+		uint32_t version{0};
+		uint32_t formatVersion{0};
+		uint64_t sourceHash{0};
+		uint64_t sourceSize{0};
+		uint64_t moduleNameHash{0}; // of the name an imported module was compiled with,0 for a main program
+		uint64_t imageSize{0};
+		uint32_t stringTableOffset{0};
+		uint8_t flags{0};
+		uint64_t imageHash{0}; // of the whole image but this field,the last of the header
+	};
+
+	constexpr size_t BYTECODE_HEADER_SIZE = 4 + 4 + 4 + 8 + 8 + 8 + 8 + 4 + 1 + 8;
+	constexpr uint8_t BYTECODE_FLAG_COMPRESSED_STRING_TABLE = 1 << 0;
+	constexpr uint8_t BYTECODE_FLAG_HEAP_IMAGE = 1 << 1; // a heap image follows the header instead of the main function(see HeapImage.h)
+	constexpr uint8_t BYTECODE_FLAG_MODULE = 1 << 2; // the main function is the body of an imported module,not a program
+
+	// Appends a program to a single growing buffer in one pass,strings are interned into the string table on the way.
+	class CYS_API BytecodeWriter
+	{
+		NON_COPYABLE(BytecodeWriter)
+	public:
+		BytecodeWriter(uint64_t sourceHash, uint64_t sourceSize, bool isStringTableCompressed = false, uint8_t flags = 0, uint64_t moduleNameHash = 0);
+		~BytecodeWriter() = default;
+
+		void WriteU8(uint8_t integer);
+		void WriteU32(uint32_t integer);
+		void WriteU64(uint64_t integer);
+		void WriteVarUint(uint64_t integer);
+		void WriteVarInt(int64_t integer);
+		void WriteBytes(const uint8_t *bytes, size_t size);
+		void WriteString(SOURCE_STRING_VIEW str); // index into the string table
+
+		size_t GetPosition() const;
+		void PatchU32(size_t position, uint32_t integer);
+
+		// pad so that size bytes written next start on a page boundary or fit within one page
+		void AlignToPage(size_t size);
+
+		// append the string table and fill in the header,the writer is spent afterwards
+		std::vector<uint8_t> Finish();
+
+	private:
+		std::vector<uint8_t> mData;
+		bool mIsStringTableCompressed;
+
+		std::unordered_map<SOURCE_STRING, uint32_t> mStringIndices;
+		std::vector<uint32_t> mStringOffsets;
+		std::vector<uint8_t> mStringBytes;
+	};
+
+	// A mapped binary file,chunks bound to it decode their bodies and constants from it on first use,
+	// so it has to outlive every function loaded from it.Reads are bounds checked,errors are fatal.
+	class CYS_API BytecodeImage
+	{
+		NON_COPYABLE(BytecodeImage)
+	public:
+		BytecodeImage() = default;
+		~BytecodeImage() = default;
+
+		// map the file and read its header,false if it cannot be mapped or is too short to hold one
+		bool Open(std::string_view path);
+		// an image already in memory,the data has to outlive the image
+		bool Open(std::span<const uint8_t> data);
+
+		const BytecodeHeader &GetHeader() const;
+		size_t GetSize() const;
+
+		// hash the image and compare it with the header,the only pass over the whole image.
+		// What is decoded lazily afterwards is then known to be what the writer wrote
+		bool IsIntact() const;
+
+		// set up the string table and bind the main function,the header is expected to be validated by the caller
+		FunctionObject *LoadMainFunction();
+		// only set up the string table,for images that do not start with a main function
+		void LoadStringTable();
+
+		uint8_t ReadU8(size_t &offset) const;
+		uint32_t ReadU32(size_t &offset) const;
+		uint64_t ReadU64(size_t &offset) const;
+		uint64_t ReadVarUint(size_t &offset) const;
+		int64_t ReadVarInt(size_t &offset) const;
+		const uint8_t *ReadBytes(size_t &offset, size_t size) const;
+		SOURCE_STRING_VIEW ReadString(size_t &offset) const; // view into the image or the decompressed string table
+		StrObject *ReadStrObject(size_t &offset) const;      // interned,equal strings of every image and compiler share one object
+
+		Arena &GetTokenArena() const; // tokens rebuilt for the chunks bound to the image
+		// carried by the rebuilt tokens,the file they are reported against(see Logger::RecordSourceFile)
+		void SetSourceId(uint32_t sourceId);
+		uint32_t GetSourceId() const;
+
+	private:
+		void ReadHeader();
+
+		MappedFile mFile;
+		std::span<const uint8_t> mData;
+		BytecodeHeader mHeader;
+
+		std::span<const uint8_t> mStringTable;
+		std::vector<uint8_t> mDecompressedStringTable;
+		uint32_t mStringCount{0};
+		mutable std::vector<StrObject *> mStrObjects;
+
+		mutable Arena mTokenArena;
+		uint32_t mSourceId{0};
+	};
+}
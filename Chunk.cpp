@@ -1,10 +1,13 @@
 #include "Chunk.h"
 #include <iomanip>
 #include <sstream>
+#include <unordered_map>
+#include <algorithm>
 #include "Version.h"
 #include "Utils.h"
 #include "Object.h"
 #include "Logger.h"
+#include "BytecodeImage.h"
 namespace CynicScript
 {
 	Chunk::Chunk(const OpCodeList &opcodes, const std::vector<Value> &constants)
@@ -15,78 +18,271 @@ namespace CynicScript
 #ifndef NDEBUG
 	STRING Chunk::ToString() const
 	{
+		// a chunk bound to an image is decoded for printing,which only fills in what it would decode on first use
+		auto self = const_cast<Chunk *>(this);
+
+		// the disassembly reads the constants the opcodes refer to
+		auto opCodes = OpCodeList(self->GetOpCodes(), self->GetOpCodes() + self->GetOpCodeCount());
+		for (size_t i = 0; i < constants.size(); ++i)
+			self->GetConstant(i);
+
 		STRING result;
 		result += OpCodeToString(opCodes);
 		for (const auto &c : constants)
-		{
 			if (CYS_IS_FUNCTION_VALUE(c))
 				result += CYS_TO_FUNCTION_VALUE(c)->ToStringWithChunk();
-		}
 		return result;
 	}
 #endif
 
-	std::vector<uint8_t> Chunk::Serialize() const
+	// chunk layout,offsets are fixed u32 positions in the whole image,everything else is varuint:
+	//     u32 end of chunk
+	//     opcode count,u32 opcode offset
+	//     constant count,u32 constant offsets
+	//     token count,tokens(u8 kind,line,column,pos,literal string index)
+	//     related token count,token indices plus one(0 for none)
+	//     constants,padding,opcodes
+	void Chunk::Serialize(BytecodeWriter &writer) const
 	{
-		std::vector<uint8_t> result;
+		// a chunk bound to an image is written again when a heap image is saved from a run started with one,
+		// decode whatever it hasn't decoded yet first
+		auto self = const_cast<Chunk *>(this);
+		auto opCodeCount = self->GetOpCodeCount();
+		auto opCodesData = self->GetOpCodes();
+		for (size_t i = 0; i < constants.size(); ++i)
+			self->GetConstant(i);
+
+		auto chunkEndPos = writer.GetPosition();
+		writer.WriteU32(0);
+
+		writer.WriteVarUint(opCodeCount);
+		auto opCodesPos = writer.GetPosition();
+		writer.WriteU32(0);
+
+		writer.WriteVarUint(constants.size());
+		auto constantOffsetTablePos = writer.GetPosition();
+		for (size_t i = 0; i < constants.size(); ++i)
+			writer.WriteU32(0);
+
+		// the same token is usually related to several opcodes,store each one once and refer to it by index
+		std::vector<const Token *> tokenTable;
+		std::unordered_map<const Token *, uint32_t> tokenIndices;
+		for (const auto &token : opCodeRelatedTokens)
+			if (token && tokenIndices.try_emplace(token, static_cast<uint32_t>(tokenTable.size())).second)
+				tokenTable.emplace_back(token);
+
+		writer.WriteVarUint(tokenTable.size());
+		for (const auto &token : tokenTable)
+		{
+			writer.WriteU8(static_cast<uint8_t>(token->kind));
+			writer.WriteVarUint(token->sourceLocation.line);
+			writer.WriteVarUint(token->sourceLocation.column);
+			writer.WriteVarUint(token->sourceLocation.pos);
+			writer.WriteString(token->literal);
+		}
 
-		auto magNumberBytes = ByteConverter::ToU32ByteList(CYS_BINARY_FILE_MAGIC_NUMBER);
-		result.insert(result.end(), magNumberBytes.begin(), magNumberBytes.end());
+		writer.WriteVarUint(opCodeRelatedTokens.size());
+		for (const auto &token : opCodeRelatedTokens)
+			writer.WriteVarUint(token ? tokenIndices[token] + 1 : 0);
 
-		auto versionBytes = ByteConverter::ToU32ByteList(CYS_VERSION_BINARY);
-		result.insert(result.end(), versionBytes.begin(), versionBytes.end());
+		for (size_t i = 0; i < constants.size(); ++i)
+		{
+			writer.PatchU32(constantOffsetTablePos + i * 4, static_cast<uint32_t>(writer.GetPosition()));
+			constants[i].Serialize(writer);
+		}
 
-		auto opCodeCount = ByteConverter::ToU32ByteList(opCodes.size());
-		result.insert(result.end(), opCodeCount.begin(), opCodeCount.end());
+		// a page boundary inside the opcodes of a small function would cost a second page fault when it first runs
+		writer.AlignToPage(opCodeCount);
+		writer.PatchU32(opCodesPos, static_cast<uint32_t>(writer.GetPosition()));
+		writer.WriteBytes(opCodesData, opCodeCount);
 
-		result.insert(result.end(), opCodes.begin(), opCodes.end());
+		writer.PatchU32(chunkEndPos, static_cast<uint32_t>(writer.GetPosition()));
+	}
 
-		auto constantsCount = ByteConverter::ToU32ByteList(constants.size());
-		result.insert(result.end(), constantsCount.begin(), constantsCount.end());
+	void Chunk::Deserialize(const BytecodeImage &image, size_t &offset)
+	{
+		size_t chunkEnd = image.ReadU32(offset);
+		if (chunkEnd <= offset || chunkEnd > image.GetSize())
+			CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,chunk end {} out of range"), chunkEnd);
 
-		for (const auto &constant : constants)
-		{
-			auto bytes = constant.Serialize();
+		mImage = &image;
+		mBodyOffset = offset;
+		offset = chunkEnd;
+	}
 
-			auto size = ByteConverter::ToU32ByteList(bytes.size());
-			result.insert(result.end(), size.begin(), size.end());
+	void Chunk::Materialize()
+	{
+		size_t offset = mBodyOffset;
+		mBodyOffset = 0;
+
+		mMappedOpCodeCount = mImage->ReadVarUint(offset);
+		size_t opCodesOffset = mImage->ReadU32(offset);
+		mMappedOpCodes = mImage->ReadBytes(opCodesOffset, mMappedOpCodeCount);
+
+		auto constantsCount = mImage->ReadVarUint(offset);
+		mConstantOffsetTable = offset;
+		mImage->ReadBytes(offset, constantsCount * 4);
+		constants.assign(constantsCount, Value());
+		mPendingConstants.assign(constantsCount, true);
+
+		auto tokenCount = mImage->ReadVarUint(offset);
+		std::vector<const Token *> tokenTable;
+		tokenTable.reserve(tokenCount);
+		for (uint64_t i = 0; i < tokenCount; ++i)
+		{
+			auto kind = static_cast<TokenKind>(mImage->ReadU8(offset));
+			SourceLocation sourceLocation;
+			sourceLocation.line = mImage->ReadVarUint(offset);
+			sourceLocation.column = mImage->ReadVarUint(offset);
+			sourceLocation.pos = mImage->ReadVarUint(offset);
+			auto literal = mImage->ReadString(offset);
+			auto token = mImage->GetTokenArena().New<Token>(kind, literal, sourceLocation);
+			token->sourceId = mImage->GetSourceId();
+			tokenTable.emplace_back(token);
+		}
 
-			result.insert(result.end(), bytes.begin(), bytes.end());
+		auto relatedTokenCount = mImage->ReadVarUint(offset);
+		opCodeRelatedTokens.reserve(relatedTokenCount);
+		for (uint64_t i = 0; i < relatedTokenCount; ++i)
+		{
+			auto idx = mImage->ReadVarUint(offset);
+			if (idx == 0)
+				opCodeRelatedTokens.emplace_back(nullptr);
+			else if (idx <= tokenTable.size())
+				opCodeRelatedTokens.emplace_back(tokenTable[idx - 1]);
+			else
+				CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,token index {} out of range {}"), idx - 1, tokenTable.size());
 		}
 
-		return result;
+		VerifyMappedOpCodes();
 	}
 
-	void Chunk::Deserialize(const std::vector<uint8_t> &data)
+	// The vm reads operands without checking them,so a body decoded from an image is walked once before it first runs:
+	// every instruction and its operands have to fit in the body,token and constant indices have to be in range,
+	// closures have to refer to function constants and jumps have to land inside the body.Local and upvalue slots
+	// depend on the frame the body runs in and are left to the hash of the image
+	void Chunk::VerifyMappedOpCodes()
 	{
-		auto magicNumber = ByteConverter::GetU32Integer(data, 0);
-		if (magicNumber != CYS_BINARY_FILE_MAGIC_NUMBER)
-			CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,cannot deserialize from this file"));
+		const uint8_t *opcodes = mMappedOpCodes;
+		const size_t count = mMappedOpCodeCount;
 
-		auto versionNumber = ByteConverter::GetU32Integer(data, 4);
-		if (versionNumber != CYS_VERSION_BINARY)
-			CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file version of {},current version is {}"), versionNumber, CYS_VERSION_BINARY);
+		size_t i = 0;
+		size_t pos = 0;
+		auto readOperand = [&](size_t size) -> uint32_t
+		{
+			if (size > count - pos)
+				CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,truncated instruction at {}"), i);
+			uint32_t operand = 0;
+			for (size_t k = 0; k < size; ++k)
+				operand = operand << 8 | opcodes[pos++];
+			return operand;
+		};
+
+		bool isWide = false;
+		while (i < count)
+		{
+			auto instruction = opcodes[i];
+			if (instruction > OP_WIDE)
+				CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,unknown opcode {} at {}"), static_cast<uint32_t>(instruction), i);
 
-		auto opCodesCount = ByteConverter::GetU32Integer(data, 8);
+			pos = i + 1;
+			auto tokenIdx = readOperand(2);
+			if (tokenIdx >= opCodeRelatedTokens.size())
+				CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,token index {} out of range {} at {}"), tokenIdx, opCodeRelatedTokens.size(), i);
 
-		opCodes.insert(opCodes.end(), data.begin() + 12, data.begin() + 12 + opCodesCount);
+			const size_t operandSize = isWide ? 2 : 1;
+			switch (instruction)
+			{
+			case OP_CONSTANT:
+			case OP_CONSTANT_LONG:
+			{
+				auto idx = readOperand(instruction == OP_CONSTANT_LONG ? 3 : 1);
+				if (idx >= constants.size())
+					ReportConstantOutOfRange(idx);
+				break;
+			}
+			case OP_CLOSURE:
+			case OP_CLOSURE_LONG:
+			{
+				auto idx = readOperand(instruction == OP_CLOSURE_LONG ? 3 : 1);
+				if (idx >= constants.size())
+					ReportConstantOutOfRange(idx);
+				const auto &function = GetConstant(idx);
+				if (!CYS_IS_FUNCTION_VALUE(function))
+					CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,closure of constant {} that is not a function at {}"), idx, i);
+				for (int32_t j = 0; j < CYS_TO_FUNCTION_VALUE(function)->upValueCount; ++j)
+				{
+					readOperand(operandSize); // slot
+					readOperand(1);			  // depth
+				}
+				break;
+			}
+			case OP_JUMP_IF_FALSE:
+			case OP_JUMP:
+			case OP_LOOP:
+			{
+				auto address = readOperand(isWide ? 4 : 2);
+				if (instruction == OP_LOOP ? address > pos : address > count - pos)
+					CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,jump out of range at {}"), i);
+				break;
+			}
+			case OP_CLASS:
+				for (int32_t j = 0; j < 4; ++j)
+					readOperand(operandSize);
+				break;
+			case OP_MODULE:
+				readOperand(operandSize);
+				readOperand(operandSize);
+				break;
+			// counts the vm reads as one byte whatever the prefix
+			case OP_RETURN:
+			case OP_APPREGATE_RESOLVE:
+			case OP_APPREGATE_RESOLVE_VAR_ARG:
+			case OP_RESET:
+				readOperand(1);
+				break;
+			case OP_ARRAY:
+			case OP_DICT:
+			case OP_SET_GLOBAL:
+			case OP_GET_GLOBAL:
+			case OP_SET_LOCAL:
+			case OP_GET_LOCAL:
+			case OP_SET_UPVALUE:
+			case OP_GET_UPVALUE:
+			case OP_REF_GLOBAL:
+			case OP_REF_LOCAL:
+			case OP_REF_INDEX_GLOBAL:
+			case OP_REF_INDEX_LOCAL:
+			case OP_REF_UPVALUE:
+			case OP_REF_INDEX_UPVALUE:
+			case OP_CALL:
+			case OP_STRUCT:
+				readOperand(operandSize); // global slots fit in the global table even when widened
+				break;
+			default:
+				break;
+			}
 
-		auto idx = 12 + opCodesCount;
+			isWide = instruction == OP_WIDE;
+			i = pos;
+		}
 
-		auto constantsCount = ByteConverter::GetU32Integer(data, idx);
-		idx += 4;
-		for (int32_t i = 0; i < constantsCount; ++i)
-		{
-			auto constantSize = ByteConverter::GetU32Integer(data, idx);
-			idx += 4;
+		if (isWide)
+			CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,OP_WIDE at the end of the opcodes"));
+	}
 
-			std::vector<uint8_t> constantBytes(data.begin() + idx, data.begin() + idx + constantSize);
+	void Chunk::ReportConstantOutOfRange(size_t idx) const
+	{
+		CYS_LOG_ERROR(TEXT("Invalid CynicScript binary file,constant index {} out of range {}"), idx, constants.size());
+	}
 
-			Value v;
-			v.Deserialize(constantBytes);
+	void Chunk::DecodeConstant(size_t idx)
+	{
+		mPendingConstants[idx] = false;
 
-			constants.emplace_back(v);
-		}
+		size_t offsetPos = mConstantOffsetTable + idx * 4;
+		size_t offset = mImage->ReadU32(offsetPos);
+		constants[idx].Deserialize(*mImage, offset);
 	}
 
 	STRING Chunk::OpCodeToString(const OpCodeList &opcodes) const
@@ -94,43 +290,47 @@ namespace CynicScript
 #define CASE(opCode)                                                                                                 \
 	case opCode:                                                                                                     \
 	{                                                                                                                \
-		auto tok = opCodeRelatedTokens[opcodes[i + 1]];                                                              \
+		auto tok = opCodeRelatedTokens[opcodes[i + 1] << 8 | opcodes[i + 2]];                                        \
 		auto tokStr = tok->ToString();                                                                               \
 		STRING tokGap(maxTokenShowSize - tokStr.size(), TCHAR(' '));                                                 \
 		tokStr += tokGap;                                                                                            \
 		stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\t") << TEXT(#opCode) << std::endl; \
-		i += 1;                                                                                                      \
+		i += 2;                                                                                                      \
 		break;                                                                                                       \
 	}
 
 #define CASE_JUMP(opCode, op)                                                                                                                                             \
 	case opCode:                                                                                                                                                          \
 	{                                                                                                                                                                     \
-		auto tok = opCodeRelatedTokens[opcodes[i + 1]];                                                                                                                   \
-		uint16_t addressOffset = opcodes[i + 2] << 8 | opcodes[i + 3];                                                                                                    \
+		auto tok = opCodeRelatedTokens[opcodes[i + 1] << 8 | opcodes[i + 2]];                                                                                             \
+		auto operandSize = isWide ? 4 : 2;                                                                                                                                \
+		uint32_t addressOffset = 0;                                                                                                                                       \
+		for (int32_t j = 0; j < operandSize; ++j)                                                                                                                         \
+			addressOffset = addressOffset << 8 | opcodes[i + 3 + j];                                                                                                      \
 		auto tokStr = tok->ToString();                                                                                                                                    \
 		STRING tokGap(maxTokenShowSize - tokStr.size(), TCHAR(' '));                                                                                                      \
 		tokStr += tokGap;                                                                                                                                                 \
-		stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\t") << TEXT(#opCode) << TEXT("\t") << i << "->" << i op addressOffset + 3 << std::endl; \
-		i += 3;                                                                                                                                                           \
+		stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\t") << TEXT(#opCode) << TEXT("\t") << i << "->" << i op addressOffset + operandSize + 2 << std::endl; \
+		i += operandSize + 2;                                                                                                                                             \
 		break;                                                                                                                                                            \
 	}
 
 #define CASE_1(opCode)                                                                                                                    \
 	case opCode:                                                                                                                          \
 	{                                                                                                                                     \
-		auto tok = opCodeRelatedTokens[opcodes[i + 1]];                                                                                   \
-		auto pos = opcodes[i + 2];                                                                                                        \
+		auto tok = opCodeRelatedTokens[opcodes[i + 1] << 8 | opcodes[i + 2]];                                                             \
+		uint32_t pos = isWide ? (opcodes[i + 3] << 8 | opcodes[i + 4]) : opcodes[i + 3];                                                  \
 		auto tokStr = tok->ToString();                                                                                                    \
 		STRING tokGap(maxTokenShowSize - tokStr.size(), TCHAR(' '));                                                                      \
 		tokStr += tokGap;                                                                                                                 \
 		stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\t") << TEXT(#opCode) << TEXT("\t") << pos << std::endl; \
-		i += 2;                                                                                                                           \
+		i += isWide ? 4 : 3;                                                                                                              \
 		break;                                                                                                                            \
 	}
 
 		const uint32_t maxTokenShowSize = GetBiggestTokenLength() + 4; // 4 for a gap "    "
 		STRING_STREAM stream;
+		bool isWide = false; // set by OP_WIDE for the instruction that follows
 		for (int32_t i = 0; i < opcodes.size(); ++i)
 		{
 			switch (opcodes[i])
@@ -159,6 +359,7 @@ namespace CynicScript
 				CASE(OP_GET_BASE)
 				CASE(OP_SET_PROPERTY)
 				CASE(OP_GET_PROPERTY)
+				CASE(OP_IMPORT)
 				CASE_JUMP(OP_JUMP_IF_FALSE, +)
 				CASE_JUMP(OP_JUMP, +)
 				CASE_JUMP(OP_LOOP, -)
@@ -183,43 +384,49 @@ namespace CynicScript
 				CASE_1(OP_APPREGATE_RESOLVE_VAR_ARG)
 				CASE_1(OP_RESET)
 			case OP_CONSTANT:
+			case OP_CONSTANT_LONG:
 			{
-				auto tok = opCodeRelatedTokens[opcodes[i + 1]];
-				auto pos = opcodes[i + 2];
+				auto isLong = opcodes[i] == OP_CONSTANT_LONG;
+				auto tok = opCodeRelatedTokens[opcodes[i + 1] << 8 | opcodes[i + 2]];
+				uint32_t pos = isLong ? (opcodes[i + 3] << 16 | opcodes[i + 4] << 8 | opcodes[i + 5]) : opcodes[i + 3];
 				STRING constantStr = constants[pos].ToString();
 
 				auto tokStr = tok->ToString();
 				STRING tokGap(maxTokenShowSize - tokStr.size(), TCHAR(' '));
 				tokStr += tokGap;
-				stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\tOP_CONSTANT\t") << pos << TEXT("\t'") << constantStr << TEXT("'") << std::endl;
-				i += 2;
+				stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << (isLong ? TEXT("\tOP_CONSTANT_LONG\t") : TEXT("\tOP_CONSTANT\t")) << pos << TEXT("\t'") << constantStr << TEXT("'") << std::endl;
+				i += isLong ? 5 : 3;
 				break;
 			}
 			case OP_CLASS:
 			{
-				auto tok = opCodeRelatedTokens[opcodes[i + 1]];
-				auto ctorCount = opcodes[i + 2];
-				auto varCount = opcodes[i + 3];
-				auto constCount = opcodes[i + 4];
-				auto parentClassCount = opcodes[i + 5];
+				auto tok = opCodeRelatedTokens[opcodes[i + 1] << 8 | opcodes[i + 2]];
+				auto operandSize = isWide ? 2 : 1;
+				uint32_t counts[4] = {};
+				for (int32_t j = 0; j < 4; ++j)
+					for (int32_t k = 0; k < operandSize; ++k)
+						counts[j] = counts[j] << 8 | opcodes[i + 3 + j * operandSize + k];
 				auto tokStr = tok->ToString();
 				STRING tokGap(maxTokenShowSize - tokStr.size(), TCHAR(' '));
 				tokStr += tokGap;
-				stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\tOP_CLASS\t") << ctorCount << TEXT("\t") << varCount << TEXT("\t") << constCount << TEXT("\t") << parentClassCount << std::endl;
-				i += 5;
+				stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\tOP_CLASS\t") << counts[0] << TEXT("\t") << counts[1] << TEXT("\t") << counts[2] << TEXT("\t") << counts[3] << std::endl;
+				i += 2 + 4 * operandSize;
 				break;
 			}
 			case OP_CLOSURE:
+			case OP_CLOSURE_LONG:
 			{
-				auto tok = opCodeRelatedTokens[opcodes[i + 1]];
-				auto pos = opcodes[i + 2];
+				auto isLong = opcodes[i] == OP_CLOSURE_LONG;
+				auto tok = opCodeRelatedTokens[opcodes[i + 1] << 8 | opcodes[i + 2]];
+				uint32_t pos = isLong ? (opcodes[i + 3] << 16 | opcodes[i + 4] << 8 | opcodes[i + 5]) : opcodes[i + 3];
 				STRING funcStr = (TEXT("<fn ") + CYS_TO_FUNCTION_VALUE(constants[pos])->name + TEXT(":0x") + PointerAddressToString((void *)CYS_TO_FUNCTION_VALUE(constants[pos])) + TEXT(">"));
 
 				auto tokStr = tok->ToString();
 				STRING tokGap(maxTokenShowSize - tokStr.size(), TCHAR(' '));
 				tokStr += tokGap;
 
-				stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\tOP_CLOSURE\t") << pos << TEXT("\t") << funcStr << std::endl;
+				stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << (isLong ? TEXT("\tOP_CLOSURE_LONG\t") : TEXT("\tOP_CLOSURE\t")) << pos << TEXT("\t") << funcStr << std::endl;
+				i += isLong ? 5 : 3;
 
 				auto upvalueCount = CYS_TO_FUNCTION_VALUE(constants[pos])->upValueCount;
 				if (upvalueCount > 0)
@@ -227,29 +434,44 @@ namespace CynicScript
 					stream << TEXT("        upvalues:") << std::endl;
 					for (auto j = 0; j < upvalueCount; ++j)
 					{
-						stream << TEXT("                 location  ") << opcodes[++i];
+						uint32_t location = opcodes[++i];
+						if (isWide)
+							location = location << 8 | opcodes[++i];
+						stream << TEXT("                 location  ") << location;
 						stream << TEXT(" | ");
 						stream << TEXT("depth  ") << opcodes[++i] << std::endl;
 					}
 				}
-				i += 2;
 				break;
 			}
 			case OP_MODULE:
 			{
-				auto tok = opCodeRelatedTokens[opcodes[i + 1]];
-				auto varCount = opcodes[i + 2];
-				auto constCount = opcodes[i + 3];
+				auto tok = opCodeRelatedTokens[opcodes[i + 1] << 8 | opcodes[i + 2]];
+				uint32_t varCount = isWide ? (opcodes[i + 3] << 8 | opcodes[i + 4]) : opcodes[i + 3];
+				uint32_t constCount = isWide ? (opcodes[i + 5] << 8 | opcodes[i + 6]) : opcodes[i + 4];
 				auto tokStr = tok->ToString();
 				STRING tokGap(maxTokenShowSize - tokStr.size(), TCHAR(' '));
 				tokStr += tokGap;
 				stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\tOP_MODULE\t") << varCount << TEXT("\t") << constCount << std::endl;
-				i += 3;
+				i += isWide ? 6 : 4;
 				break;
 			}
+			case OP_WIDE:
+			{
+				auto tok = opCodeRelatedTokens[opcodes[i + 1] << 8 | opcodes[i + 2]];
+				auto tokStr = tok->ToString();
+				STRING tokGap(maxTokenShowSize - tokStr.size(), TCHAR(' '));
+				tokStr += tokGap;
+				stream << tokStr << std::setfill(TCHAR('0')) << std::setw(8) << i << TEXT("\tOP_WIDE") << std::endl;
+				isWide = true;
+				i += 2;
+				continue;
+			}
 			default:
 				break;
 			}
+
+			isWide = false;
 		}
 
 		return stream.str();
@@ -269,12 +491,15 @@ namespace CynicScript
 
 	bool operator==(const Chunk &left, const Chunk &right)
 	{
-		if (left.opCodes != right.opCodes)
+		// chunks bound to an image are compared by what they decode to
+		auto &l = const_cast<Chunk &>(left);
+		auto &r = const_cast<Chunk &>(right);
+		if (l.GetOpCodeCount() != r.GetOpCodeCount() || !std::equal(l.GetOpCodes(), l.GetOpCodes() + l.GetOpCodeCount(), r.GetOpCodes()))
 			return false;
-		if (left.constants.size() != right.constants.size())
+		if (l.constants.size() != r.constants.size())
 			return false;
-		for (int32_t i = 0; i < left.constants.size(); ++i)
-			if (left.constants[i] != right.constants[i])
+		for (size_t i = 0; i < l.constants.size(); ++i)
+			if (l.GetConstant(i) != r.GetConstant(i))
 				return false;
 		return true;
 	}
@@ -7,6 +7,7 @@ namespace CynicScript
     enum OpCode : uint8_t
     {
         OP_CONSTANT,
+        OP_CONSTANT_LONG, // 24-bit constant index,for chunks with more than 256 constants
         OP_NULL,
         OP_ADD,
         OP_SUB,
@@ -54,10 +55,13 @@ namespace CynicScript
         OP_GET_PROPERTY,
         OP_GET_BASE,
         OP_CLOSURE,
+        OP_CLOSURE_LONG,
         OP_APPREGATE_RESOLVE,
         OP_APPREGATE_RESOLVE_VAR_ARG,
         OP_MODULE,
+        OP_IMPORT, // pops the path string of an import statement,pushes the module object(see ModuleManager)
         OP_RESET,
+        OP_WIDE, // prefix,the instruction that follows has 16-bit slot and count operands and a 32-bit jump offset
     };
 
     using OpCodeList = std::vector<uint8_t>;
@@ -71,18 +75,63 @@ namespace CynicScript
 #ifndef NDEBUG
         STRING ToString() const;
 #endif
-        std::vector<uint8_t> Serialize() const;
-        void Deserialize(const std::vector<uint8_t> &data);
+        // the opcodes are aligned so that they start on a page boundary or fit within one page of the image
+        void Serialize(BytecodeWriter &writer) const;
+        // binds the chunk to the image and skips past it,nothing else is read until the chunk is first executed.
+        // The opcodes are executed in place and tokens are rebuilt into the image,so it must outlive the chunk
+        void Deserialize(const BytecodeImage &image, size_t &offset);
 
-        OpCodeList opCodes;
+        const uint8_t *GetOpCodes();
+        size_t GetOpCodeCount();
+        const Value &GetConstant(size_t idx);
+
+        OpCodeList opCodes; // empty for chunks bound to an image
         std::vector<Value> constants;
         std::vector<const Token *> opCodeRelatedTokens;
 
     private:
+        void Materialize();
+        void VerifyMappedOpCodes();
+        void DecodeConstant(size_t idx);
+        void ReportConstantOutOfRange(size_t idx) const;
+
         STRING OpCodeToString(const OpCodeList &opcodes) const;
         uint32_t GetBiggestTokenLength() const;
+
+        const BytecodeImage *mImage{nullptr};
+        size_t mBodyOffset{0}; // start of the not yet decoded body in mImage,0 once materialized or for compiled chunks
+        const uint8_t *mMappedOpCodes{nullptr};
+        size_t mMappedOpCodeCount{0};
+        size_t mConstantOffsetTable{0};
+        std::vector<bool> mPendingConstants; // constants still to decode from the image on first use
     };
 
+    inline const uint8_t *Chunk::GetOpCodes()
+    {
+        if (mBodyOffset != 0)
+            Materialize();
+        return mMappedOpCodes ? mMappedOpCodes : opCodes.data();
+    }
+
+    inline size_t Chunk::GetOpCodeCount()
+    {
+        if (mBodyOffset != 0)
+            Materialize();
+        return mMappedOpCodes ? mMappedOpCodeCount : opCodes.size();
+    }
+
+    inline const Value &Chunk::GetConstant(size_t idx)
+    {
+        if (!mPendingConstants.empty())
+        {
+            if (idx >= mPendingConstants.size())
+                ReportConstantOutOfRange(idx);
+            if (mPendingConstants[idx])
+                DecodeConstant(idx);
+        }
+        return constants[idx];
+    }
+
     bool operator==(const Chunk &left, const Chunk &right);
     bool operator!=(const Chunk &left, const Chunk &right);
 }
\ No newline at end of file
@@ -0,0 +1,504 @@
+#include "CompileServer.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include "MappedFile.h"
+#include "Logger.h"
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#endif
+
+namespace CynicScript
+{
+	CompileServer::CompileServer(CompileFunction compile, RunFunction run)
+		: mCompile(std::move(compile)), mRun(std::move(run))
+	{
+	}
+
+#if defined(_WIN32) || defined(_WIN64)
+	void CompileServer::Serve(std::string_view socketPath)
+	{
+		CYS_LOG_ERROR(TEXT("The compile server relies on unix sockets and fork,not supported on this platform"));
+	}
+
+	uint32_t CompileServer::RequestImage(std::string_view socketPath, std::string_view sourcePath, bool isStringTableCompressed, std::vector<uint8_t> &image)
+	{
+		CYS_LOG_ERROR(TEXT("The compile server relies on unix sockets and fork,not supported on this platform"));
+		return EXIT_FAILURE;
+	}
+
+	uint32_t CompileServer::RequestRun(std::string_view socketPath, std::string_view sourcePath)
+	{
+		CYS_LOG_ERROR(TEXT("The compile server relies on unix sockets and fork,not supported on this platform"));
+		return EXIT_FAILURE;
+	}
+
+	void CompileServer::HandleConnection(int32_t connection)
+	{
+	}
+
+	uint32_t CompileServer::FindOrCompile(const std::string &sourcePath, bool isStringTableCompressed, const int32_t *streams, const std::vector<uint8_t> *&image)
+	{
+		return EXIT_FAILURE;
+	}
+
+	void CompileServer::Evict(size_t size)
+	{
+	}
+#else
+	namespace
+	{
+		constexpr size_t IMAGE_CACHE_CAPACITY = 256 * 1024 * 1024;
+		constexpr uint32_t MAX_SOURCE_PATH_SIZE = 64 * 1024;
+		constexpr size_t REQUEST_HEADER_SIZE = 1 + 1 + 4;
+		constexpr size_t STREAM_COUNT = 3; // stdin,stdout,stderr of the client
+		constexpr int32_t REAP_INTERVAL_MS = 1000; // finished runs are reaped at least this often while no client connects
+
+		bool WriteAll(int32_t fd, const uint8_t *data, size_t size)
+		{
+			while (size > 0)
+			{
+				auto written = write(fd, data, size);
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return false;
+				data += written;
+				size -= written;
+			}
+			return true;
+		}
+
+		bool ReadAll(int32_t fd, uint8_t *data, size_t size)
+		{
+			while (size > 0)
+			{
+				auto count = read(fd, data, size);
+				if (count < 0 && errno == EINTR)
+					continue;
+				if (count <= 0)
+					return false;
+				data += count;
+				size -= count;
+			}
+			return true;
+		}
+
+		void ReadToEnd(int32_t fd, std::vector<uint8_t> &data)
+		{
+			uint8_t buffer[64 * 1024];
+			while (true)
+			{
+				auto count = read(fd, buffer, sizeof(buffer));
+				if (count < 0 && errno == EINTR)
+					continue;
+				if (count <= 0)
+					return;
+				data.insert(data.end(), buffer, buffer + count);
+			}
+		}
+
+		uint32_t WaitForExitStatus(pid_t child)
+		{
+			int status = 0;
+			while (waitpid(child, &status, 0) < 0)
+				if (errno != EINTR)
+					return EXIT_FAILURE;
+
+			if (WIFEXITED(status))
+				return WEXITSTATUS(status);
+			if (WIFSIGNALED(status))
+				return 128 + WTERMSIG(status); // like a shell reports it
+			return EXIT_FAILURE;
+		}
+
+		// exited is the read end of a pipe whose write end only the runner holds,so it hangs up when the runner exits.
+		// A client sends nothing after its request,the connection only turns readable when it hangs up,
+		// the program is killed then as its standard streams are of no use anymore
+		uint32_t WaitForRun(pid_t runner, int32_t exited, int32_t connection)
+		{
+			pollfd events[2] = {{exited, POLLIN, 0}, {connection, POLLIN, 0}};
+			while (poll(events, 2, -1) < 0)
+				if (errno != EINTR)
+					break;
+
+			if (events[0].revents == 0 && events[1].revents != 0)
+				kill(runner, SIGKILL);
+			return WaitForExitStatus(runner);
+		}
+
+		// in a forked child,before it compiles or runs for the client
+		void AttachStreams(const int32_t *streams)
+		{
+			signal(SIGPIPE, SIG_DFL);
+			for (size_t i = 0; i < STREAM_COUNT; ++i)
+			{
+				dup2(streams[i], static_cast<int32_t>(i));
+				close(streams[i]);
+			}
+		}
+
+		// output buffered before a fork would be written by the child again
+		void FlushOutput()
+		{
+			COUT.flush();
+			fflush(nullptr);
+		}
+
+		STRING GetErrorString()
+		{
+			return SourceToString(strerror(errno));
+		}
+
+		int32_t Connect(std::string_view socketPath)
+		{
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			if (socketPath.size() >= sizeof(address.sun_path))
+				CYS_LOG_ERROR(TEXT("Socket path is too long:{}"), SourceToString(socketPath));
+			memcpy(address.sun_path, socketPath.data(), socketPath.size());
+
+			auto connection = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (connection < 0 || connect(connection, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+				CYS_LOG_ERROR(TEXT("Failed to connect to the compile server at {}:{}"), SourceToString(socketPath), GetErrorString());
+			return connection;
+		}
+
+		// the standard streams of the client ride along with the request header
+		int32_t SendRequest(std::string_view socketPath, CompileServer::Command command, std::string_view sourcePath, bool isStringTableCompressed)
+		{
+			auto absolutePath = std::filesystem::absolute(std::filesystem::path(sourcePath)).string();
+			if (absolutePath.size() > MAX_SOURCE_PATH_SIZE)
+				CYS_LOG_ERROR(TEXT("Source path is too long:{}"), SourceToString(absolutePath));
+
+			std::vector<uint8_t> request;
+			ByteConverter::WriteU8(request, static_cast<uint8_t>(command));
+			ByteConverter::WriteU8(request, isStringTableCompressed ? 1 : 0);
+			ByteConverter::WriteU32(request, static_cast<uint32_t>(absolutePath.size()));
+			request.insert(request.end(), absolutePath.begin(), absolutePath.end());
+
+			auto connection = Connect(socketPath);
+
+			iovec header{request.data(), REQUEST_HEADER_SIZE};
+			alignas(cmsghdr) uint8_t control[CMSG_SPACE(sizeof(int32_t) * STREAM_COUNT)] = {};
+			msghdr message{};
+			message.msg_iov = &header;
+			message.msg_iovlen = 1;
+			message.msg_control = control;
+			message.msg_controllen = sizeof(control);
+
+			auto rights = CMSG_FIRSTHDR(&message);
+			rights->cmsg_level = SOL_SOCKET;
+			rights->cmsg_type = SCM_RIGHTS;
+			rights->cmsg_len = CMSG_LEN(sizeof(int32_t) * STREAM_COUNT);
+			const int32_t streams[STREAM_COUNT] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+			memcpy(CMSG_DATA(rights), streams, sizeof(streams));
+
+			ssize_t sent;
+			do
+				sent = sendmsg(connection, &message, MSG_NOSIGNAL);
+			while (sent < 0 && errno == EINTR);
+			if (sent <= 0 || !WriteAll(connection, request.data() + sent, request.size() - sent))
+				CYS_LOG_ERROR(TEXT("Failed to send the request to the compile server:{}"), GetErrorString());
+			return connection;
+		}
+
+		uint32_t ReadExitStatus(int32_t connection)
+		{
+			uint8_t bytes[4];
+			if (!ReadAll(connection, bytes, sizeof(bytes)))
+				CYS_LOG_ERROR(TEXT("The compile server closed the connection without a reply"));
+			size_t offset = 0;
+			return ByteConverter::ReadU32(bytes, offset);
+		}
+
+		struct Request
+		{
+			CompileServer::Command command;
+			bool isStringTableCompressed;
+			std::string sourcePath;
+			int32_t streams[STREAM_COUNT]{-1, -1, -1};
+		};
+
+		// false for a malformed request or a client gone before sending it,streams received are closed by the caller
+		bool ReceiveRequest(int32_t connection, Request &request)
+		{
+			uint8_t header[REQUEST_HEADER_SIZE];
+			iovec headerVector{header, sizeof(header)};
+			alignas(cmsghdr) uint8_t control[CMSG_SPACE(sizeof(int32_t) * STREAM_COUNT)] = {};
+			msghdr message{};
+			message.msg_iov = &headerVector;
+			message.msg_iovlen = 1;
+			message.msg_control = control;
+			message.msg_controllen = sizeof(control);
+
+			ssize_t received;
+			do
+				received = recvmsg(connection, &message, 0);
+			while (received < 0 && errno == EINTR);
+			if (received <= 0)
+				return false;
+
+			for (auto rights = CMSG_FIRSTHDR(&message); rights; rights = CMSG_NXTHDR(&message, rights))
+				if (rights->cmsg_level == SOL_SOCKET && rights->cmsg_type == SCM_RIGHTS && rights->cmsg_len == CMSG_LEN(sizeof(int32_t) * STREAM_COUNT))
+					memcpy(request.streams, CMSG_DATA(rights), sizeof(request.streams));
+			if (request.streams[STREAM_COUNT - 1] < 0 || (message.msg_flags & MSG_CTRUNC))
+				return false;
+
+			if (!ReadAll(connection, header + received, sizeof(header) - received))
+				return false;
+
+			size_t offset = 0;
+			std::span<const uint8_t> headerData(header, sizeof(header));
+			auto command = ByteConverter::ReadU8(headerData, offset);
+			if (command > static_cast<uint8_t>(CompileServer::Command::RUN))
+				return false;
+			request.command = static_cast<CompileServer::Command>(command);
+			request.isStringTableCompressed = ByteConverter::ReadU8(headerData, offset) != 0;
+
+			auto pathSize = ByteConverter::ReadU32(headerData, offset);
+			if (pathSize == 0 || pathSize > MAX_SOURCE_PATH_SIZE)
+				return false;
+			request.sourcePath.resize(pathSize);
+			return ReadAll(connection, reinterpret_cast<uint8_t *>(request.sourcePath.data()), pathSize);
+		}
+	}
+
+	void CompileServer::Serve(std::string_view socketPath)
+	{
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (socketPath.size() >= sizeof(address.sun_path))
+			CYS_LOG_ERROR(TEXT("Socket path is too long:{}"), SourceToString(socketPath));
+		memcpy(address.sun_path, socketPath.data(), socketPath.size());
+
+		mListener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (mListener < 0)
+			CYS_LOG_ERROR(TEXT("Failed to create the compile server socket:{}"), GetErrorString());
+
+		// only a socket left behind by a previous server is replaced,never a file that happens to be at the path
+		struct stat existing;
+		if (lstat(address.sun_path, &existing) == 0)
+		{
+			if (!S_ISSOCK(existing.st_mode))
+				CYS_LOG_ERROR(TEXT("{} exists and is not a socket,refusing to replace it"), SourceToString(socketPath));
+			unlink(address.sun_path);
+		}
+		if (bind(mListener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(mListener, SOMAXCONN) != 0)
+			CYS_LOG_ERROR(TEXT("Failed to listen at {}:{}"), SourceToString(socketPath), GetErrorString());
+
+		// a client leaving early must not take the server down
+		signal(SIGPIPE, SIG_IGN);
+
+		CYS_LOG_INFO(TEXT("Serving at {}"), SourceToString(socketPath));
+		FlushOutput();
+		while (true)
+		{
+			// finished runs,no compile is in flight here
+			while (waitpid(-1, nullptr, WNOHANG) > 0)
+				;
+
+			pollfd listener{mListener, POLLIN, 0};
+			auto ready = poll(&listener, 1, REAP_INTERVAL_MS);
+			if (ready < 0 && errno != EINTR)
+				CYS_LOG_ERROR(TEXT("Failed to wait for a connection:{}"), GetErrorString());
+			if (ready <= 0)
+				continue;
+
+			auto connection = accept(mListener, nullptr, nullptr);
+			if (connection < 0)
+			{
+				if (errno == EINTR || errno == ECONNABORTED)
+					continue;
+				CYS_LOG_ERROR(TEXT("Failed to accept a connection:{}"), GetErrorString());
+			}
+
+			HandleConnection(connection);
+			close(connection);
+		}
+	}
+
+	uint32_t CompileServer::RequestImage(std::string_view socketPath, std::string_view sourcePath, bool isStringTableCompressed, std::vector<uint8_t> &image)
+	{
+		auto connection = SendRequest(socketPath, Command::COMPILE, sourcePath, isStringTableCompressed);
+		auto status = ReadExitStatus(connection);
+		if (status == EXIT_SUCCESS)
+		{
+			uint8_t bytes[8];
+			size_t offset = 0;
+			if (!ReadAll(connection, bytes, sizeof(bytes)))
+				CYS_LOG_ERROR(TEXT("The compile server closed the connection before sending the image"));
+			image.resize(ByteConverter::ReadU64(bytes, offset));
+			if (!ReadAll(connection, image.data(), image.size()))
+				CYS_LOG_ERROR(TEXT("The compile server closed the connection before sending the image"));
+		}
+		close(connection);
+		return status;
+	}
+
+	uint32_t CompileServer::RequestRun(std::string_view socketPath, std::string_view sourcePath)
+	{
+		auto connection = SendRequest(socketPath, Command::RUN, sourcePath, false);
+		auto status = ReadExitStatus(connection);
+		close(connection);
+		return status;
+	}
+
+	void CompileServer::HandleConnection(int32_t connection)
+	{
+		Request request;
+		if (ReceiveRequest(connection, request))
+		{
+			const std::vector<uint8_t> *image = nullptr;
+			auto status = FindOrCompile(request.sourcePath, request.isStringTableCompressed, request.streams, image);
+
+			std::vector<uint8_t> response;
+			if (status != EXIT_SUCCESS || request.command == Command::COMPILE)
+			{
+				ByteConverter::WriteU32(response, status);
+				if (status == EXIT_SUCCESS)
+				{
+					ByteConverter::WriteU64(response, image->size());
+					response.insert(response.end(), image->begin(), image->end());
+				}
+				WriteAll(connection, response.data(), response.size());
+			}
+			else
+			{
+				// the handler waits for the program and replies,so the server goes on accepting
+				FlushOutput();
+				auto handler = fork();
+				if (handler == 0)
+				{
+					close(mListener);
+
+					int32_t exited[2] = {-1, -1};
+					auto runner = pipe(exited) == 0 ? fork() : -1;
+					if (runner == 0)
+					{
+						close(exited[0]);
+						close(connection);
+						AttachStreams(request.streams);
+						mRun(*image, request.sourcePath);
+						exit(EXIT_SUCCESS);
+					}
+
+					close(exited[1]);
+					ByteConverter::WriteU32(response, runner < 0 ? EXIT_FAILURE : WaitForRun(runner, exited[0], connection));
+					WriteAll(connection, response.data(), response.size());
+					_exit(EXIT_SUCCESS);
+				}
+				else if (handler < 0)
+				{
+					ByteConverter::WriteU32(response, EXIT_FAILURE);
+					WriteAll(connection, response.data(), response.size());
+				}
+			}
+		}
+
+		for (auto stream : request.streams)
+			if (stream >= 0)
+				close(stream);
+	}
+
+	uint32_t CompileServer::FindOrCompile(const std::string &sourcePath, bool isStringTableCompressed, const int32_t *streams, const std::vector<uint8_t> *&image)
+	{
+		// the source is read once and the compile works on the bytes that were hashed,
+		// so a file changed in between can't be cached under the key of its old content
+		SOURCE_STRING source;
+		bool isRead = false;
+		{
+			MappedFile file;
+			if (file.Open(sourcePath))
+			{
+				source.assign(reinterpret_cast<const SOURCE_CHAR_T *>(file.GetData()), file.GetSize());
+				isRead = true;
+			}
+		}
+
+		// keyed by content,so the same script reached through different paths is compiled once
+		ImageKey key;
+		if (isRead)
+		{
+			uint8_t flag = isStringTableCompressed ? 1 : 0;
+			key = {HashBytes(&flag, sizeof(flag), HashBytes(source.data(), source.size())), source.size()};
+
+			auto iter = mImages.find(key);
+			if (iter != mImages.end())
+			{
+				image = &iter->second;
+				return EXIT_SUCCESS;
+			}
+		}
+
+		// a source the server can't read is still handed to the compile,which reports it to the client
+		int32_t channel[2];
+		if (pipe(channel) != 0)
+			return EXIT_FAILURE;
+
+		FlushOutput();
+		auto compiler = fork();
+		if (compiler == 0)
+		{
+			close(mListener);
+			close(channel[0]);
+			AttachStreams(streams);
+
+			auto program = mCompile(sourcePath, isRead ? &source : nullptr, isStringTableCompressed);
+			std::vector<uint8_t> result;
+			ByteConverter::WriteU8(result, program.isCacheable ? 1 : 0);
+			result.insert(result.end(), program.image.begin(), program.image.end());
+			exit(WriteAll(channel[1], result.data(), result.size()) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+
+		close(channel[1]);
+		if (compiler < 0)
+		{
+			close(channel[0]);
+			return EXIT_FAILURE;
+		}
+
+		std::vector<uint8_t> result;
+		ReadToEnd(channel[0], result);
+		close(channel[0]);
+
+		auto status = WaitForExitStatus(compiler);
+		if (status != EXIT_SUCCESS)
+			return status;
+		if (result.size() <= 1)
+			return EXIT_FAILURE;
+
+		bool isCacheable = isRead && result[0] != 0 && result.size() - 1 <= IMAGE_CACHE_CAPACITY;
+		result.erase(result.begin());
+		if (!isCacheable)
+		{
+			mUncachedImage = std::move(result);
+			image = &mUncachedImage;
+			return EXIT_SUCCESS;
+		}
+
+		Evict(result.size());
+		mImageBytes += result.size();
+		mImageOrder.emplace_back(key);
+		image = &(mImages[key] = std::move(result));
+		return EXIT_SUCCESS;
+	}
+
+	void CompileServer::Evict(size_t size)
+	{
+		while (!mImageOrder.empty() && mImageBytes + size > IMAGE_CACHE_CAPACITY)
+		{
+			auto iter = mImages.find(mImageOrder.front());
+			mImageBytes -= iter->second.size();
+			mImages.erase(iter);
+			mImageOrder.pop_front();
+		}
+	}
+#endif
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <span>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+#include "Utils.h"
+
+namespace CynicScript
+{
+	// A warm local process that compiles and runs programs for clients connecting over a unix socket,
+	// so short scripts skip starting the interpreter,setting up the libraries and recompiling.
+	//
+	// Compiled images are kept in memory keyed by the hash and the size of the source content.Errors are fatal in the
+	// front end and the vm,so every compile and run happens in a child forked from the server:it inherits the
+	// initialized state,gets the stdin,stdout and stderr of the client passed over the socket,and its exit
+	// status is handed back to the client.Programs run concurrently,compiles are serialized by the server.
+	//
+	// Request:u8 command,u8 string table compression flag,u32 length and utf-8 bytes of the absolute source path,
+	// the client's standard streams attached as SCM_RIGHTS.Response:u32 exit status,for SERVE_COMPILE followed by
+	// u64 size and bytes of the image when the status is 0.Integers are big endian.
+	class CYS_API CompileServer
+	{
+		NON_COPYABLE(CompileServer)
+	public:
+		enum class Command : uint8_t
+		{
+			COMPILE, // return the image
+			RUN,	 // run the program in a forked child
+		};
+
+		struct CompiledProgram
+		{
+			std::vector<uint8_t> image;
+			bool isCacheable{true};
+		};
+
+		// called in forked children,errors may terminate them.The source is the content the server hashed,
+		// nullptr when the server could not read the file
+		using CompileFunction = std::function<CompiledProgram(std::string_view sourcePath, const SOURCE_STRING *source, bool isStringTableCompressed)>;
+		using RunFunction = std::function<void(std::span<const uint8_t> image, std::string_view sourcePath)>;
+
+		CompileServer(CompileFunction compile, RunFunction run);
+		~CompileServer() = default;
+
+		// serve until the process is killed,a stale socket at the path is replaced but any other file is left alone.
+		// Errors setting up the socket are fatal
+		void Serve(std::string_view socketPath);
+
+		// client side,errors reaching the server are fatal.The exit status of the compile or the run is returned
+		static uint32_t RequestImage(std::string_view socketPath, std::string_view sourcePath, bool isStringTableCompressed, std::vector<uint8_t> &image);
+		static uint32_t RequestRun(std::string_view socketPath, std::string_view sourcePath);
+
+	private:
+		// the size is compared along with the hash,so a hash collision alone can't serve the image of another source
+		struct ImageKey
+		{
+			uint64_t hash{0};
+			uint64_t size{0};
+
+			bool operator==(const ImageKey &) const = default;
+		};
+
+		struct ImageKeyHash
+		{
+			size_t operator()(const ImageKey &key) const { return static_cast<size_t>(key.hash); }
+		};
+
+		void HandleConnection(int32_t connection);
+		// the cached image of the source,compiled in a child on a miss.Returns the exit status of the compile
+		uint32_t FindOrCompile(const std::string &sourcePath, bool isStringTableCompressed, const int32_t *streams, const std::vector<uint8_t> *&image);
+		void Evict(size_t size);
+
+		CompileFunction mCompile;
+		RunFunction mRun;
+
+		int32_t mListener{-1};
+
+		std::unordered_map<ImageKey, std::vector<uint8_t>, ImageKeyHash> mImages;
+		std::deque<ImageKey> mImageOrder; // oldest first
+		size_t mImageBytes{0};
+		std::vector<uint8_t> mUncachedImage; // compiled with warnings or from a source the server can't read
+	};
+}
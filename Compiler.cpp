@@ -1,7 +1,13 @@
 #include "Compiler.h"
+#include <bit>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <optional>
 #include "Utils.h"
 #include "Object.h"
 #include "LibraryManager.h"
+#include "Allocator.h"
 #include "Logger.h"
 namespace CynicScript
 {
@@ -15,7 +21,7 @@ namespace CynicScript
 	struct UpValue
 	{
 		uint8_t index = 0;
-		uint8_t location = 0;
+		uint16_t location = 0;
 		uint8_t depth = -1;
 	};
 
@@ -28,15 +34,56 @@ namespace CynicScript
 	struct Symbol
 	{
 		STRING name;
+		Atom atom = NO_ATOM;
 		SymbolLocation location = SymbolLocation::GLOBAL;
 		Permission permission = Permission::IMMUTABLE;
-		uint8_t index = 0;
+		uint32_t index = 0;
 		int8_t scopeDepth = -1;
 		FunctionSymbolInfo functionSymInfo;
 		UpValue upvalue; // available only while type is SymbolLocation::UPVALUE
 		bool isCaptured = false;
 		const Token *relatedToken;
+		int32_t shadowed = -1; // the previous symbol of the same atom in the table,-1 ends the chain
 	};
+
+	namespace
+	{
+		// identifiers come interned by the lexer,names made up by the compiler are interned on the way
+		Atom ToAtom(const STRING &name)
+		{
+			return AtomTable::GetInstance()->Intern(StringToSource(name));
+		}
+
+		Atom ToAtom(const IdentifierExpr *expr)
+		{
+			return expr->tagToken->atom != NO_ATOM ? expr->tagToken->atom : ToAtom(expr->literal);
+		}
+
+		// an error of a deferred body,thrown to CompileDeferredBodies() which reports it from the calling thread
+		struct DeferredBodyError
+		{
+			const Token *token;
+			STRING message;
+		};
+
+		thread_local bool gIsCompilingDeferredBody = false;
+
+		// the compiler cannot go on after an error,on a deferred body the rest of the body is unwound instead of exiting
+		template <typename... Args>
+		[[noreturn]] void ReportError(const Token *token, const STRING &fmt, const Args &...args)
+		{
+			if (gIsCompilingDeferredBody)
+			{
+				STRING_STREAM sstr;
+				Logger::Output(sstr, fmt, args...);
+				throw DeferredBodyError{token, sstr.str()};
+			}
+			CYS_LOG_ERROR_WITH_LOC(token, fmt, args...);
+		}
+	}
+
+	// Symbols are kept in definition order,an atom maps to the latest symbol of that name and each symbol links
+	// to the one it shadows,so lookups only visit symbols of the same name from the innermost outwards.
 	class SymbolTable
 	{
 	public:
@@ -44,8 +91,9 @@ namespace CynicScript
 			: mSymbolCount(0), mGlobalSymbolCount(0), mLocalSymbolCount(0), mUpValueCount(0), enclosing(nullptr), mScopeDepth(0), mTableDepth(0)
 		{
 		}
-		SymbolTable(SymbolTable *enclosing)
-			: mSymbolCount(0), mGlobalSymbolCount(0), mLocalSymbolCount(0), mUpValueCount(0), enclosing(enclosing)
+		// only the first enclosingSymbolCount symbols of enclosing are visible from the table
+		SymbolTable(SymbolTable *enclosing, uint32_t enclosingSymbolCount = UINT32_MAX)
+			: mSymbolCount(0), mGlobalSymbolCount(0), mLocalSymbolCount(0), mUpValueCount(0), enclosing(enclosing), mEnclosingSymbolCount(enclosingSymbolCount)
 		{
 			mScopeDepth = enclosing->mScopeDepth + 1;
 			mTableDepth = enclosing->mTableDepth + 1;
@@ -55,20 +103,30 @@ namespace CynicScript
 			SAFE_DELETE(enclosing);
 		}
 
-		Symbol Define(const Token *relatedToken, Permission permission, const STRING &name, const FunctionSymbolInfo &functionInfo = {})
+		Symbol Define(const Token *relatedToken, Permission permission, Atom atom, const STRING &name, const FunctionSymbolInfo &functionInfo = {})
 		{
-			if (mSymbolCount >= mSymbols.size())
-				CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("Too many symbols in current scope."));
-			for (int16_t i = mSymbolCount - 1; i >= 0; --i)
+			if ((mScopeDepth == 0 ? mGlobalSymbolCount : mLocalSymbolCount) >= UINT16_COUNT)
+				ReportError(relatedToken, TEXT("Too many symbols in current scope."));
+
+			// symbols past the last one of a shallower scope are the ones a new symbol could redefine
+			int32_t boundary = -1;
+			for (auto iter = mDepthStack.rbegin(); iter != mDepthStack.rend(); ++iter)
 			{
-				auto isSameParamCount = (mSymbols[i].functionSymInfo.paramCount < 0 || functionInfo.paramCount < 0) ? true : mSymbols[i].functionSymInfo.paramCount == functionInfo.paramCount;
-				if (mSymbols[i].scopeDepth == -1 || mSymbols[i].scopeDepth < mScopeDepth)
+				if (mSymbols[*iter].scopeDepth < mScopeDepth)
+				{
+					boundary = static_cast<int32_t>(*iter);
 					break;
-				if (mSymbols[i].name == name && isSameParamCount)
-					CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("Redefinition symbol:{}"), name);
+				}
+			}
+
+			for (int32_t i = FindSymbol(atom); i > boundary; i = mSymbols[i].shadowed)
+			{
+				auto isSameParamCount = (mSymbols[i].functionSymInfo.paramCount < 0 || functionInfo.paramCount < 0) ? true : mSymbols[i].functionSymInfo.paramCount == functionInfo.paramCount;
+				if (isSameParamCount)
+					ReportError(relatedToken, TEXT("Redefinition symbol:{}"), name);
 			}
 
-			auto *symbol = &mSymbols[mSymbolCount++];
+			auto *symbol = AddSymbol(atom, mScopeDepth);
 			symbol->name = name;
 			symbol->permission = permission;
 			symbol->functionSymInfo = functionInfo;
@@ -84,25 +142,26 @@ namespace CynicScript
 				symbol->location = SymbolLocation::LOCAL;
 				symbol->index = mLocalSymbolCount++;
 			}
-			symbol->scopeDepth = mScopeDepth;
 			return *symbol;
 		}
 
-		Symbol Resolve(const Token *relatedToken, const STRING &name, int8_t paramCount = -1, int8_t d = 0)
+		Symbol Resolve(const Token *relatedToken, Atom atom, const STRING &name, int8_t paramCount = -1, int8_t d = 0, uint32_t visibleSymbolCount = UINT32_MAX)
 		{
-
-			for (int16_t i = mSymbolCount - 1; i >= 0; --i)
+			for (int32_t i = FindSymbol(atom); i >= 0; i = mSymbols[i].shadowed)
 			{
+				if (static_cast<uint32_t>(i) >= visibleSymbolCount)
+					continue;
+
 				auto isSameParamCount = (mSymbols[i].functionSymInfo.paramCount < 0 || paramCount < 0) ? true : mSymbols[i].functionSymInfo.paramCount == paramCount;
 
-				if (mSymbols[i].name == name && mSymbols[i].scopeDepth <= mScopeDepth)
+				if (mSymbols[i].scopeDepth <= mScopeDepth)
 				{
 					if (isSameParamCount || mSymbols[i].functionSymInfo.varArg > VarArg::NONE)
 					{
 						if (mSymbols[i].scopeDepth == -1)
-							CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("symbol not defined yet!"));
+							ReportError(relatedToken, TEXT("symbol not defined yet!"));
 
-						if (d == 1)
+						if (d == 1 && !mIsShared)
 							mSymbols[i].isCaptured = true;
 
 						return mSymbols[i];
@@ -112,7 +171,7 @@ namespace CynicScript
 
 			if (enclosing)
 			{
-				Symbol result = enclosing->Resolve(relatedToken, name, paramCount, ++d);
+				Symbol result = enclosing->Resolve(relatedToken, atom, name, paramCount, ++d, mEnclosingSymbolCount);
 				if (d > 0 && result.location != SymbolLocation::GLOBAL)
 				{
 					result.location = SymbolLocation::UPVALUE;
@@ -121,20 +180,91 @@ namespace CynicScript
 				return result;
 			}
 
-			CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("No symbol: \"{}\" in current scope."), name);
+			ReportError(relatedToken, TEXT("No symbol: \"{}\" in current scope."), name);
+		}
+
+		// the global of that name,nullptr if there is none
+		const Symbol *FindGlobalSymbol(Atom atom) const
+		{
+			for (int32_t i = FindSymbol(atom); i >= 0; i = mSymbols[i].shadowed)
+				if (mSymbols[i].location == SymbolLocation::GLOBAL && mSymbols[i].scopeDepth == 0)
+					return &mSymbols[i];
+			return nullptr;
+		}
+
+		// drop the locals of the scopes already exited,keeping the symbols visible at the current depth
+		void RemoveClosedScopeSymbols()
+		{
+			uint32_t count = 0;
+			uint32_t localCount = 0;
+			for (uint32_t i = 0; i < mSymbolCount; ++i)
+			{
+				if (mSymbols[i].scopeDepth > mScopeDepth)
+					continue;
+				if (mSymbols[i].location == SymbolLocation::LOCAL)
+					localCount++;
+				mSymbols[count++] = mSymbols[i];
+			}
+
+			for (uint32_t i = count; i < mSymbolCount; ++i)
+				mSymbols[i] = Symbol();
+
+			mSymbolCount = count;
+			mLocalSymbolCount = localCount;
+
+			mSymbolChains.clear();
+			mDepthStack.clear();
+			for (uint32_t i = 0; i < mSymbolCount; ++i)
+				LinkSymbol(i);
+			for (auto &start : mScopeStarts)
+				start = std::min(start, mSymbolCount);
 		}
 
-		std::array<Symbol, UINT8_COUNT> mSymbols;
-		uint8_t mSymbolCount;
-		uint8_t mGlobalSymbolCount;
-		uint8_t mLocalSymbolCount;
+		// slots past mSymbolCount are reused,the table only grows
+		Symbol *AddSymbol(Atom atom, int8_t scopeDepth)
+		{
+			if (mSymbolCount == mSymbols.size())
+				mSymbols.emplace_back();
+
+			auto *symbol = &mSymbols[mSymbolCount];
+			symbol->atom = atom;
+			symbol->scopeDepth = scopeDepth;
+			LinkSymbol(mSymbolCount++);
+			return symbol;
+		}
+
+		std::vector<Symbol> mSymbols;
+		uint32_t mSymbolCount;
+		std::vector<uint32_t> mScopeStarts; // symbol count when each open {} scope was entered
+		uint32_t mGlobalSymbolCount;
+		uint32_t mLocalSymbolCount;
 		std::array<UpValue, UINT8_COUNT> mUpValues;
 		int32_t mUpValueCount;
 		uint8_t mScopeDepth; // Depth of scope nesting(related to code {} scope)
 		SymbolTable *enclosing;
+		uint32_t mEnclosingSymbolCount{UINT32_MAX};
+		bool mIsShared{false}; // read by the workers compiling deferred bodies,captures of its symbols are not recorded then
 
 	private:
-		UpValue AddUpValue(const Token *relatedToken, uint8_t location, uint8_t depth)
+		int32_t FindSymbol(Atom atom) const
+		{
+			auto iter = mSymbolChains.find(atom);
+			return iter == mSymbolChains.end() ? -1 : static_cast<int32_t>(iter->second);
+		}
+
+		void LinkSymbol(uint32_t index)
+		{
+			auto &symbol = mSymbols[index];
+			auto [iter, isNew] = mSymbolChains.try_emplace(symbol.atom, index);
+			symbol.shadowed = isNew ? -1 : static_cast<int32_t>(iter->second);
+			iter->second = index;
+
+			while (!mDepthStack.empty() && mSymbols[mDepthStack.back()].scopeDepth >= symbol.scopeDepth)
+				mDepthStack.pop_back();
+			mDepthStack.emplace_back(index);
+		}
+
+		UpValue AddUpValue(const Token *relatedToken, uint16_t location, uint8_t depth)
 		{
 			for (int32_t i = 0; i < mUpValueCount; ++i)
 			{
@@ -144,7 +274,7 @@ namespace CynicScript
 			}
 
 			if (mUpValueCount == UINT8_COUNT)
-				CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("Too many closure upvalues in function."));
+				ReportError(relatedToken, TEXT("Too many closure upvalues in function."));
 			mUpValues[mUpValueCount].location = location;
 			mUpValues[mUpValueCount].depth = depth;
 			mUpValues[mUpValueCount].index = mUpValueCount;
@@ -152,14 +282,22 @@ namespace CynicScript
 			return mUpValues[mUpValueCount - 1];
 		}
 		uint8_t mTableDepth; // Depth of symbol table nesting(related to symboltable's enclosing)
+
+		std::unordered_map<Atom, uint32_t> mSymbolChains; // latest symbol of each atom
+		std::vector<uint32_t> mDepthStack;				   // symbols of strictly increasing depth,the last symbol shallower than any depth is among them
 	};
 
 	Compiler::Compiler()
-		: mSymbolTable(nullptr)
+		: mSymbolTable(nullptr), mIsForwardJumpWide(false), mIsJumpOverflowed(false)
 	{
 		ResetStatus();
 	}
 
+	Compiler::Compiler(Compiler *owner)
+		: mSymbolTable(nullptr), mCurBreakStmtAddress(-1), mCurContinueStmtAddress(-1), mIsForwardJumpWide(owner->mIsForwardJumpWide), mIsJumpOverflowed(false)
+	{
+	}
+
 	Compiler::~Compiler()
 	{
 		ClearStatus();
@@ -168,21 +306,321 @@ namespace CynicScript
 	FunctionObject *Compiler::Compile(Stmt *stmt)
 	{
 		ResetStatus();
+		return CompileMainFunction(stmt);
+	}
+
+	FunctionObject *Compiler::CompileIncremental(Stmt *stmt)
+	{
+		// every input runs in a fresh main frame,so only the globals and the main function slot carry over
+		mSymbolTable->RemoveClosedScopeSymbols();
+
+		mCurContinueStmtAddress = -1;
+		mCurBreakStmtAddress = -1;
+
+		std::vector<FunctionObject *>().swap(mFunctionList);
+		mFunctionList.emplace_back(new FunctionObject(MAIN_ENTRY_FUNCTION_NAME));
+		mConstantIndices.clear();
 
-		if (stmt->kind == AstKind::ASTSTMTS)
+		return CompileMainFunction(stmt);
+	}
+
+	FunctionObject *Compiler::CompileMainFunction(Stmt *stmt)
+	{
+		// a forward jump whose target ends up more than 64KB away is only noticed when it is patched,
+		// the input is then compiled again from the same globals with every forward jump in its wide form.
+		// Likewise if a deferred body turns out not to match what was emitted for it,the input is compiled
+		// again without deferring anything
+		auto globalSymbolTable = *mSymbolTable;
+		mIsForwardJumpWide = false;
+		auto isDeferring = mParallelWorkerCount != 1;
+		while (true)
 		{
-			auto stmts = ((AstStmts *)stmt)->stmts;
-			for (const auto &s : stmts)
-				CompileDeclAndStmt(s);
+			mIsJumpOverflowed = false;
+			mIsDeferredBodyMismatched = false;
+
+			if (stmt->kind == AstKind::ASTSTMTS)
+			{
+				auto stmts = ((AstStmts *)stmt)->stmts;
+				for (const auto &s : stmts)
+				{
+					if (isDeferring && s->kind == AstKind::FUNCTION)
+						DeferFunctionDecl((FunctionDecl *)s);
+					else if (isDeferring && s->kind == AstKind::MODULE)
+						DeferModuleDecl((ModuleDecl *)s);
+					else
+						CompileDeclAndStmt(s);
+				}
+				CompileDeferredBodies();
+			}
+			else
+				CompileDeclAndStmt(stmt);
+
+			EmitReturn(0, stmt->tagToken);
+
+			if (!mIsJumpOverflowed && !mIsDeferredBodyMismatched)
+				break;
+
+			if (mIsJumpOverflowed)
+				mIsForwardJumpWide = true;
+			if (mIsDeferredBodyMismatched)
+				isDeferring = false;
+
+			*mSymbolTable = globalSymbolTable;
+			mCurContinueStmtAddress = -1;
+			mCurBreakStmtAddress = -1;
+			std::vector<FunctionObject *>().swap(mFunctionList);
+			mFunctionList.emplace_back(new FunctionObject(MAIN_ENTRY_FUNCTION_NAME));
+			mConstantIndices.clear();
 		}
-		else
-			CompileDeclAndStmt(stmt);
 
-		EmitReturn(0, stmt->tagToken);
+		AstArena::GetInstance()->Release();
 
 		return CurFunction();
 	}
 
+	FunctionObject *Compiler::CompileModule(Stmt *stmt, STRING_VIEW name)
+	{
+		ResetStatus();
+
+		auto moduleDecl = new ModuleDecl(stmt->tagToken);
+		moduleDecl->name = new IdentifierExpr(stmt->tagToken, name);
+		for (const auto &s : ((AstStmts *)stmt)->stmts)
+		{
+			switch (s->kind)
+			{
+			case AstKind::VAR:
+				moduleDecl->varItems.emplace_back((VarDecl *)s);
+				break;
+			case AstKind::FUNCTION:
+				moduleDecl->functionItems.emplace_back((FunctionDecl *)s);
+				break;
+			case AstKind::CLASS:
+				moduleDecl->classItems.emplace_back((ClassDecl *)s);
+				break;
+			case AstKind::ENUM:
+				moduleDecl->enumItems.emplace_back((EnumDecl *)s);
+				break;
+			case AstKind::MODULE:
+				moduleDecl->moduleItems.emplace_back((ModuleDecl *)s);
+				break;
+			case AstKind::IMPORT:
+				moduleDecl->importItems.emplace_back((ImportDecl *)s);
+				break;
+			default:
+				CYS_LOG_ERROR_WITH_LOC(s->tagToken, TEXT("Only let,const,function,class,enum,module and import is available in an imported file"));
+			}
+		}
+
+		// compiled like the function of a module declaration,again with wide forward jumps if one overflows
+		auto globalSymbolTable = *mSymbolTable;
+		mIsForwardJumpWide = false;
+		while (true)
+		{
+			mIsJumpOverflowed = false;
+
+			mFunctionList.emplace_back(new FunctionObject(name));
+			mSymbolTable = new SymbolTable(mSymbolTable);
+
+			CompileModuleBody(moduleDecl);
+
+			mSymbolTable = mSymbolTable->enclosing;
+			auto function = mFunctionList.back();
+			mFunctionList.pop_back();
+
+			if (!mIsJumpOverflowed)
+			{
+				AstArena::GetInstance()->Release();
+				return function;
+			}
+
+			mIsForwardJumpWide = true;
+			*mSymbolTable = globalSymbolTable;
+			mConstantIndices.clear();
+		}
+	}
+
+	std::vector<GlobalSymbol> Compiler::GetGlobalSymbols() const
+	{
+		std::vector<GlobalSymbol> result(mSymbolTable->mGlobalSymbolCount);
+		for (uint32_t i = 0; i < mSymbolTable->mSymbolCount; ++i)
+		{
+			const auto &symbol = mSymbolTable->mSymbols[i];
+			if (symbol.location != SymbolLocation::GLOBAL || symbol.scopeDepth != 0)
+				continue;
+			auto importPath = mImportPaths.find(symbol.index);
+			result[symbol.index] = {symbol.name, symbol.permission, symbol.functionSymInfo.paramCount, symbol.functionSymInfo.varArg, importPath != mImportPaths.end() ? importPath->second : STRING()};
+		}
+		return result;
+	}
+
+	void Compiler::RestoreGlobalSymbols(const std::vector<GlobalSymbol> &symbols)
+	{
+		ResetStatus();
+
+		// defined in slot order,each one gets the slot it had
+		const auto &libraries = LibraryManager::GetInstance()->GetLibraries();
+		if (symbols.size() < libraries.size())
+			CYS_LOG_ERROR(TEXT("Cannot restore {} globals,the interpreter has {} libraries"), symbols.size(), libraries.size());
+		for (size_t i = 0; i < libraries.size(); ++i)
+			if (symbols[i].name != libraries[i]->name)
+				CYS_LOG_ERROR(TEXT("Cannot restore globals of other libraries,global {} is {} instead of {}"), i, symbols[i].name, libraries[i]->name);
+
+		// the globals were defined by an earlier session,there is no source to point at
+		static const Token restoredToken;
+		for (size_t i = libraries.size(); i < symbols.size(); ++i)
+		{
+			const auto &symbol = symbols[i];
+			auto restored = mSymbolTable->Define(&restoredToken, symbol.permission, ToAtom(symbol.name), symbol.name, {symbol.paramCount, symbol.varArg});
+			if (!symbol.importPath.empty())
+				mImportPaths[restored.index] = symbol.importPath;
+		}
+	}
+
+	void Compiler::SetParallelWorkerCount(size_t count)
+	{
+		mParallelWorkerCount = count;
+	}
+
+	// A top level function only sees globals and the main function slot,so the main chunk does not depend on its
+	// body unless the body captures that slot.The closure is emitted without upvalues and the body is left for later.
+	void Compiler::DeferFunctionDecl(FunctionDecl *decl)
+	{
+		auto varArg = GetVarArgFromParameterList(decl->parameters);
+		auto symbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(decl->name), decl->name->literal, FunctionSymbolInfo{(int8_t)decl->parameters.size(), varArg});
+
+		auto function = new FunctionObject(decl->name->literal);
+		mDeferredBodies.emplace_back(DeferredBody{decl, function, mSymbolTable->mSymbolCount, 0});
+
+		EmitClosure(function, nullptr, decl->tagToken);
+		EmitSymbol(symbol);
+	}
+
+	// the main chunk only needs the symbol count of a module table,which follows from its items
+	void Compiler::DeferModuleDecl(ModuleDecl *decl)
+	{
+		auto symbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(decl->name), decl->name->literal);
+
+		auto function = new FunctionObject(decl->name->literal);
+		auto symbolCount = CountModuleSymbols(decl);
+		mDeferredBodies.emplace_back(DeferredBody{decl, function, mSymbolTable->mSymbolCount, symbolCount});
+
+		EmitModuleCall(function, symbolCount, decl->tagToken);
+		EmitSymbol(symbol);
+	}
+
+	uint32_t Compiler::CountModuleSymbols(ModuleDecl *decl)
+	{
+		// the unnamed slot of the module function and one symbol per item,see CompileModuleBody() and CompileVars()
+		uint32_t count = 1 + decl->enumItems.size() + decl->functionItems.size() + decl->classItems.size() + decl->moduleItems.size() + decl->importItems.size();
+		for (const auto &varStmt : decl->varItems)
+		{
+			for (const auto &[k, v] : varStmt->variables)
+			{
+				if (k->kind == AstKind::VAR_DESC)
+				{
+					count++;
+					continue;
+				}
+
+				if (k->kind != AstKind::ARRAY)
+					continue;
+				for (const auto &element : ((ArrayExpr *)k)->elements)
+				{
+					auto name = ((VarDescExpr *)element)->name;
+					if (name->kind == AstKind::IDENTIFIER || (name->kind == AstKind::VAR_ARG && ((VarArgExpr *)name)->argName))
+						count++;
+				}
+			}
+		}
+		return count;
+	}
+
+	// Deferred bodies only read the global symbol table and write their own FunctionObjects,so they are compiled by
+	// workers in any order and the result does not depend on the schedule.Names are interned process wide(see Allocator::InternStr).
+	void Compiler::CompileDeferredBodies()
+	{
+		if (mDeferredBodies.empty())
+			return;
+
+		size_t workerCount = mParallelWorkerCount != 0 ? mParallelWorkerCount : std::max(1u, std::thread::hardware_concurrency());
+		workerCount = std::min(workerCount, mDeferredBodies.size());
+
+		std::vector<std::unique_ptr<Compiler>> workers;
+		for (size_t i = 0; i < workerCount; ++i)
+			workers.emplace_back(new Compiler(this));
+
+		// bodies are handed out in order and none after an error,so every body before the first failed one is compiled
+		// and the error reported is the one compiling them in place would report
+		std::atomic<size_t> nextBody{0};
+		std::vector<std::optional<DeferredBodyError>> errors(mDeferredBodies.size());
+		auto compileBodies = [this, &nextBody, &errors](Compiler *worker)
+		{
+			gIsCompilingDeferredBody = true;
+			for (size_t i = nextBody++; i < mDeferredBodies.size(); i = nextBody++)
+			{
+				try
+				{
+					worker->CompileDeferredBody(mDeferredBodies[i], mSymbolTable);
+				}
+				catch (DeferredBodyError &error)
+				{
+					errors[i] = std::move(error);
+					nextBody = mDeferredBodies.size();
+				}
+			}
+			gIsCompilingDeferredBody = false;
+		};
+
+		mSymbolTable->mIsShared = true;
+		if (workerCount == 1)
+			compileBodies(workers[0].get());
+		else
+		{
+			std::vector<std::thread> threads;
+			for (const auto &worker : workers)
+				threads.emplace_back(compileBodies, worker.get());
+			for (auto &thread : threads)
+				thread.join();
+		}
+		mSymbolTable->mIsShared = false;
+
+		// the process exits here,what the failed bodies left behind is not cleaned up
+		for (const auto &error : errors)
+			if (error)
+				CYS_LOG_ERROR_WITH_LOC(error->token, error->message);
+
+		for (const auto &worker : workers)
+		{
+			mIsJumpOverflowed |= worker->mIsJumpOverflowed;
+			mIsDeferredBodyMismatched |= worker->mIsDeferredBodyMismatched;
+		}
+		mDeferredBodies.clear();
+	}
+
+	void Compiler::CompileDeferredBody(const DeferredBody &body, SymbolTable *globalSymbolTable)
+	{
+		mFunctionList.emplace_back(body.function);
+		mSymbolTable = new SymbolTable(globalSymbolTable, body.visibleSymbolCount);
+
+		if (body.decl->kind == AstKind::FUNCTION)
+		{
+			CompileFunctionBody((FunctionDecl *)body.decl, ClassDecl::FunctionKind::NONE);
+			if (body.function->upValueCount != 0)
+				mIsDeferredBodyMismatched = true;
+		}
+		else
+		{
+			CompileModuleBody((ModuleDecl *)body.decl);
+			if (mSymbolTable->mSymbolCount != body.symbolCount)
+				mIsDeferredBodyMismatched = true;
+		}
+
+		mSymbolTable->enclosing = nullptr;
+		SAFE_DELETE(mSymbolTable);
+		mFunctionList.pop_back();
+		mConstantIndices.clear();
+	}
+
 	void Compiler::ResetStatus()
 	{
 		ClearStatus();
@@ -194,15 +632,14 @@ namespace CynicScript
 
 		mSymbolTable = new SymbolTable();
 
-		auto symbol = &mSymbolTable->mSymbols[mSymbolTable->mSymbolCount++];
+		auto symbol = mSymbolTable->AddSymbol(ToAtom(MAIN_ENTRY_FUNCTION_NAME), 0);
 		symbol->location = SymbolLocation::LOCAL;
 		symbol->index = mSymbolTable->mLocalSymbolCount++;
 		symbol->permission = Permission::IMMUTABLE;
-		symbol->scopeDepth = 0;
 		symbol->name = MAIN_ENTRY_FUNCTION_NAME;
 
 		for (const auto &lib : LibraryManager::GetInstance()->GetLibraries())
-			mSymbolTable->Define(new Token(), Permission::IMMUTABLE, lib->name);
+			mSymbolTable->Define(new Token(), Permission::IMMUTABLE, ToAtom(lib->name), lib->name);
 	}
 
 	void Compiler::CompileDecl(Decl *decl)
@@ -224,6 +661,11 @@ namespace CynicScript
 		case AstKind::MODULE:
 			CompileModuleDecl((ModuleDecl *)decl);
 			break;
+		case AstKind::IMPORT:
+			if (mSymbolTable->mScopeDepth != 0)
+				ReportError(decl->tagToken, TEXT("Import is only available at the top level of a file."));
+			CompileImportDecl((ImportDecl *)decl);
+			break;
 		default:
 			break;
 		}
@@ -267,92 +709,151 @@ namespace CynicScript
 				}
 			}
 			else
-				CYS_LOG_ERROR_WITH_LOC(v->tagToken, TEXT("Enum value only integer num,floating point num,boolean or string is available."));
+				ReportError(v->tagToken, TEXT("Enum value only integer num,floating point num,boolean or string is available."));
 
 			pairs[k->literal] = enumValue;
 		}
 
 		EmitConstant(new EnumObject(decl->name->literal, pairs), decl->name->tagToken);
-		auto symbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, decl->name->literal);
+		auto symbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(decl->name), decl->name->literal);
 		EmitSymbol(symbol);
 	}
 
 	void Compiler::CompileModuleDecl(ModuleDecl *decl)
 	{
-		auto symbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, decl->name->literal);
+		auto symbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(decl->name), decl->name->literal);
 
 		mFunctionList.emplace_back(new FunctionObject(decl->name->literal));
 
 		mSymbolTable = new SymbolTable(mSymbolTable);
 
-		mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, TEXT(""));
+		CompileModuleBody(decl);
+
+		auto symbolCount = mSymbolTable->mSymbolCount;
+
+		mSymbolTable = mSymbolTable->enclosing;
+
+		auto function = mFunctionList.back();
+		mFunctionList.pop_back();
+
+		EmitModuleCall(function, symbolCount, decl->tagToken);
 
-		uint8_t constCount = 0;
-		uint8_t varCount = 0;
+		EmitSymbol(symbol);
+	}
+
+	void Compiler::CompileModuleBody(ModuleDecl *decl)
+	{
+		mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(TEXT("")), TEXT(""));
+
+		// lets and consts are declared before the other items so functions and classes of the module can refer to them,
+		// each slot is written when its initializer runs
+		for (const auto &varStmt : decl->varItems)
+		{
+			if (varStmt->permission == Permission::IMMUTABLE)
+				DeclareVars(varStmt);
+		}
+
+		for (const auto &varStmt : decl->varItems)
+		{
+			if (varStmt->permission == Permission::MUTABLE)
+				DeclareVars(varStmt);
+		}
+
+		uint32_t constCount = 0;
+		uint32_t varCount = 0;
+
+		for (const auto &importStmt : decl->importItems)
+		{
+			CompileImportDecl(importStmt);
+			EmitConstant(InternStr(importStmt->name->literal), importStmt->tagToken);
+			constCount++;
+		}
 
 		for (const auto &enumStmt : decl->enumItems)
 		{
 			CompileEnumDecl(enumStmt);
-			EmitConstant(new StrObject(enumStmt->name->literal), enumStmt->tagToken);
+			EmitConstant(InternStr(enumStmt->name->literal), enumStmt->tagToken);
 			constCount++;
 		}
 
 		for (const auto &fnStmt : decl->functionItems)
 		{
 			CompileFunctionDecl(fnStmt);
-			EmitConstant(new StrObject(fnStmt->name->literal), fnStmt->tagToken);
+			EmitConstant(InternStr(fnStmt->name->literal), fnStmt->tagToken);
 			constCount++;
 		}
 
 		for (const auto &classStmt : decl->classItems)
 		{
 			CompileClassDecl(classStmt);
-			EmitConstant(new StrObject(classStmt->name), classStmt->tagToken);
+			EmitConstant(InternStr(classStmt->name), classStmt->tagToken);
 			constCount++;
 		}
 
 		for (const auto &moduleStmt : decl->moduleItems)
 		{
 			CompileModuleDecl(moduleStmt);
-			EmitConstant(new StrObject(moduleStmt->name->literal), moduleStmt->tagToken);
+			EmitConstant(InternStr(moduleStmt->name->literal), moduleStmt->tagToken);
 			constCount++;
 		}
 
 		for (const auto &varStmt : decl->varItems)
 		{
 			if (varStmt->permission == Permission::IMMUTABLE)
-				constCount += CompileVars(varStmt, true);
+				constCount += CompileVars(varStmt, true, true);
 		}
 
 		for (const auto &varStmt : decl->varItems)
 		{
 			if (varStmt->permission == Permission::MUTABLE)
-				varCount += CompileVars(varStmt, true);
+				varCount += CompileVars(varStmt, true, true);
 		}
 
-		EmitConstant(new StrObject(symbol.name), symbol.relatedToken);
+		EmitConstant(InternStr(decl->name->literal), decl->tagToken);
 
-		EmitOpCode(OP_MODULE, decl->tagToken);
-		Emit(varCount);
-		Emit(constCount);
+		EmitOpCode(OP_MODULE, {varCount, constCount}, decl->tagToken);
 
 		EmitReturn(1, decl->tagToken);
 
-		auto function = mFunctionList.back();
-		function->arity = mSymbolTable->mSymbolCount;
+		CurFunction()->arity = mSymbolTable->mSymbolCount;
+	}
 
-		mFunctionList.pop_back();
+	// the module function takes a null argument per symbol of its table and is called right away
+	void Compiler::EmitModuleCall(FunctionObject *function, uint32_t symbolCount, const Token *token)
+	{
+		EmitClosure(function, nullptr, token);
 
-		EmitClosure(function, decl->tagToken);
+		for (uint32_t i = 0; i < symbolCount; ++i)
+			EmitOpCode(OP_NULL, token);
 
-		for (int32_t i = 0; i < mSymbolTable->mSymbolCount; ++i)
-			EmitOpCode(OP_NULL, decl->tagToken);
+		EmitOpCode(OP_CALL, symbolCount, token);
+	}
 
-		EmitOpCode(OP_CALL, decl->tagToken);
-		Emit(mSymbolTable->mSymbolCount);
+	// the module is loaded when the import runs,so the chunk stays valid whatever the file turns into
+	void Compiler::CompileImportDecl(ImportDecl *decl)
+	{
+		EmitConstant(InternStr(decl->path), decl->tagToken);
+		EmitOpCode(OP_IMPORT, decl->tagToken);
 
-		mSymbolTable = mSymbolTable->enclosing;
+		// a top level import of a file imported before,by an earlier input of the repl or the session of a heap image,
+		// binds the global it already has.The module is only loaded once(see OP_IMPORT)
+		if (mSymbolTable->mScopeDepth == 0)
+		{
+			auto global = mSymbolTable->FindGlobalSymbol(ToAtom(decl->name));
+			if (global)
+			{
+				auto iter = mImportPaths.find(global->index);
+				if (iter != mImportPaths.end() && iter->second == decl->path)
+				{
+					EmitSymbol(*global);
+					return;
+				}
+			}
+		}
 
+		auto symbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(decl->name), decl->name->literal);
+		if (symbol.location == SymbolLocation::GLOBAL)
+			mImportPaths[symbol.index] = decl->path;
 		EmitSymbol(symbol);
 	}
 
@@ -375,6 +876,11 @@ namespace CynicScript
 		case AstKind::MODULE:
 			CompileModuleDecl((ModuleDecl *)stmt);
 			break;
+		case AstKind::IMPORT:
+			if (mSymbolTable->mScopeDepth != 0)
+				ReportError(stmt->tagToken, TEXT("Import is only available at the top level of a file."));
+			CompileImportDecl((ImportDecl *)stmt);
+			break;
 		default:
 			CompileStmt((Stmt *)stmt);
 			break;
@@ -615,7 +1121,7 @@ namespace CynicScript
 
 				CompileExpr(expr->right);
 
-				uint64_t appregateOpCodeAddress = EmitOpCode((OpCode)0xFF, assignee->tagToken) - 1;
+				uint64_t appregateOpCodeAddress = EmitOpCode((OpCode)0xFF, assignee->tagToken);
 				uint64_t resolveAddress = Emit((OpCode)0xFF);
 
 				uint8_t resolveCount = static_cast<uint8_t>(assignee->elements.size());
@@ -788,6 +1294,7 @@ namespace CynicScript
 			EmitConstant(expr->boolean, expr->tagToken);
 			break;
 		case TypeKind::STR:
+			// not interned,the literal may be changed in place(see OP_SET_INDEX)
 			EmitConstant(new StrObject(expr->str), expr->tagToken);
 			break;
 		case TypeKind::CHAR:
@@ -824,7 +1331,7 @@ namespace CynicScript
 			CompileExpr(expr->right, RWState::WRITE);
 		}
 		else
-			CYS_LOG_ERROR_WITH_LOC(expr->tagToken, TEXT("No prefix op:{}"), expr->op);
+			ReportError(expr->tagToken, TEXT("No prefix op:{}"), expr->op);
 	}
 	void Compiler::CompilePostfixExpr(PostfixExpr *expr, const RWState &state, bool isDelayCompile)
 	{
@@ -837,7 +1344,7 @@ namespace CynicScript
 			else if (expr->op == TEXT("--"))
 				EmitOpCode(OP_SUB, expr->tagToken);
 			else
-				CYS_LOG_ERROR_WITH_LOC(expr->tagToken, TEXT("No postfix op:{}"), expr->op);
+				ReportError(expr->tagToken, TEXT("No postfix op:{}"), expr->op);
 			CompileExpr(expr->left, RWState::WRITE);
 			EmitOpCode(OP_POP, expr->tagToken);
 		}
@@ -872,20 +1379,14 @@ namespace CynicScript
 	{
 		for (const auto &elementExpr : expr->elements)
 			CompileExpr(elementExpr);
-		EmitOpCode(OP_ARRAY, expr->tagToken);
-
-		uint8_t pos = (uint8_t)expr->elements.size();
-		Emit(pos);
+		EmitOpCode(OP_ARRAY, static_cast<uint32_t>(expr->elements.size()), expr->tagToken);
 	}
 
 	void Compiler::CompileAppregateExpr(AppregateExpr *expr)
 	{
 		for (int32_t i = (int32_t)expr->exprs.size() - 1; i >= 0; --i)
 			CompileExpr(expr->exprs[i]);
-		EmitOpCode(OP_ARRAY, expr->tagToken);
-
-		uint8_t pos = (uint8_t)expr->exprs.size();
-		Emit(pos);
+		EmitOpCode(OP_ARRAY, static_cast<uint32_t>(expr->exprs.size()), expr->tagToken);
 	}
 
 	void Compiler::CompileDictExpr(DictExpr *expr)
@@ -895,9 +1396,7 @@ namespace CynicScript
 			CompileExpr(expr->elements[i].first);
 			CompileExpr(expr->elements[i].second);
 		}
-		EmitOpCode(OP_DICT, expr->tagToken);
-		uint8_t pos = static_cast<uint8_t>(expr->elements.size());
-		Emit(pos);
+		EmitOpCode(OP_DICT, static_cast<uint32_t>(expr->elements.size()), expr->tagToken);
 	}
 
 	void Compiler::CompileIndexExpr(IndexExpr *expr, const RWState &state)
@@ -914,32 +1413,33 @@ namespace CynicScript
 	{
 		auto callee = (CallExpr *)expr->callee;
 		CompileExpr(callee->callee, RWState::READ);
-		EmitOpCode(OP_CALL, expr->callee->tagToken);
-		Emit(0);
+		EmitOpCode(OP_CALL, 0, expr->callee->tagToken);
 		for (const auto &arg : callee->arguments)
 			CompileExpr(arg);
-		EmitOpCode(OP_CALL, expr->callee->tagToken);
-		Emit(static_cast<uint8_t>(callee->arguments.size()));
+		EmitOpCode(OP_CALL, static_cast<uint32_t>(callee->arguments.size()), expr->callee->tagToken);
 	}
 
 	void Compiler::CompileThisExpr(ThisExpr *expr)
 	{
-		auto identExpr = new IdentifierExpr(expr->tagToken, TEXT("this"));
-		CompileExpr(identExpr);
+		CompileIdentifier(expr->tagToken, ToAtom(TEXT("this")), TEXT("this"), RWState::READ);
 	}
 
 	void Compiler::CompileBaseExpr(BaseExpr *expr)
 	{
-		auto identExpr = new IdentifierExpr(expr->tagToken, TEXT("this"));
-		CompileExpr(identExpr);
-		EmitConstant(new StrObject(expr->callMember->ToString()), expr->tagToken);
+		CompileIdentifier(expr->tagToken, ToAtom(TEXT("this")), TEXT("this"), RWState::READ);
+		EmitConstant(InternStr(expr->callMember->ToString()), expr->tagToken);
 		EmitOpCode(OP_GET_BASE, expr->callMember->tagToken);
 	}
 
 	void Compiler::CompileIdentifierExpr(IdentifierExpr *expr, const RWState &state, int8_t paramCount)
+	{
+		CompileIdentifier(expr->tagToken, ToAtom(expr), expr->literal, state, paramCount);
+	}
+
+	void Compiler::CompileIdentifier(Token *tagToken, Atom atom, const STRING &name, const RWState &state, int8_t paramCount)
 	{
 		OpCode getOp, setOp;
-		auto symbol = mSymbolTable->Resolve(expr->tagToken, expr->literal, paramCount);
+		auto symbol = mSymbolTable->Resolve(tagToken, atom, name, paramCount);
 		if (symbol.location == SymbolLocation::GLOBAL)
 		{
 			getOp = OP_GET_GLOBAL;
@@ -960,22 +1460,14 @@ namespace CynicScript
 		{
 			if (symbol.permission == Permission::MUTABLE)
 			{
-				EmitOpCode(setOp, expr->tagToken);
-				if (symbol.location == SymbolLocation::UPVALUE)
-					Emit(symbol.upvalue.index);
-				else
-					Emit(symbol.index);
+				EmitOpCode(setOp, symbol.location == SymbolLocation::UPVALUE ? symbol.upvalue.index : symbol.index, tagToken);
 			}
 			else
-				CYS_LOG_ERROR_WITH_LOC(expr->tagToken, TEXT("{} is a constant,which cannot be assigned!"), expr->ToString());
+				ReportError(tagToken, TEXT("{} is a constant,which cannot be assigned!"), name);
 		}
 		else
 		{
-			EmitOpCode(getOp, expr->tagToken);
-			if (symbol.location == SymbolLocation::UPVALUE)
-				Emit(symbol.upvalue.index);
-			else
-				Emit(symbol.index);
+			EmitOpCode(getOp, symbol.location == SymbolLocation::UPVALUE ? symbol.upvalue.index : symbol.index, tagToken);
 		}
 	}
 	void Compiler::CompileLambdaExpr(LambdaExpr *expr)
@@ -983,23 +1475,23 @@ namespace CynicScript
 		mFunctionList.emplace_back(new FunctionObject());
 		mSymbolTable = new SymbolTable(mSymbolTable);
 
-		mSymbolTable->Define(expr->tagToken, Permission::IMMUTABLE, TEXT(""));
+		mSymbolTable->Define(expr->tagToken, Permission::IMMUTABLE, ToAtom(TEXT("")), TEXT(""));
 
 		auto varArg = GetVarArgFromParameterList(expr->parameters);
 
-		CurFunction()->arity = static_cast<uint8_t>(expr->parameters.size());
+		CurFunction()->arity = static_cast<uint16_t>(expr->parameters.size());
 		CurFunction()->varArg = varArg;
 
 		for (const auto &param : expr->parameters)
 		{
 			auto varDescExpr = (VarDescExpr *)param;
 			if (varDescExpr->name->kind == AstKind::IDENTIFIER)
-				mSymbolTable->Define(varDescExpr->tagToken, Permission::MUTABLE, ((IdentifierExpr *)((VarDescExpr *)param)->name)->literal);
+				mSymbolTable->Define(varDescExpr->tagToken, Permission::MUTABLE, ToAtom((IdentifierExpr *)varDescExpr->name), ((IdentifierExpr *)varDescExpr->name)->literal);
 			else if (varDescExpr->name->kind == AstKind::VAR_ARG)
 			{
 				auto varArg = ((VarArgExpr *)varDescExpr->name);
 				if (varArg->argName)
-					mSymbolTable->Define(varArg->tagToken, Permission::MUTABLE, varArg->argName->literal);
+					mSymbolTable->Define(varArg->tagToken, Permission::MUTABLE, ToAtom(varArg->argName), varArg->argName->literal);
 			}
 		}
 
@@ -1015,7 +1507,7 @@ namespace CynicScript
 		auto function = mFunctionList.back();
 		mFunctionList.pop_back();
 
-		EmitClosure(function, expr->tagToken);
+		EmitClosure(function, nullptr, expr->tagToken);
 	}
 
 	void Compiler::CompileCompoundExpr(CompoundExpr *expr)
@@ -1032,13 +1524,12 @@ namespace CynicScript
 		CompileExpr(expr->callee, RWState::READ, static_cast<int8_t>(expr->arguments.size()));
 		for (const auto &arg : expr->arguments)
 			CompileExpr(arg);
-		EmitOpCode(OP_CALL, expr->callee->tagToken);
-		Emit(static_cast<uint8_t>(expr->arguments.size()));
+		EmitOpCode(OP_CALL, static_cast<uint32_t>(expr->arguments.size()), expr->callee->tagToken);
 	}
 	void Compiler::CompileDotExpr(DotExpr *expr, const RWState &state)
 	{
 		CompileExpr(expr->callee);
-		EmitConstant(new StrObject(expr->callMember->literal), expr->callee->tagToken);
+		EmitConstant(InternStr(expr->callMember->literal), expr->callee->tagToken);
 		if (state == RWState::WRITE)
 			EmitOpCode(OP_SET_PROPERTY, expr->callMember->tagToken);
 		else
@@ -1051,40 +1542,34 @@ namespace CynicScript
 		{
 			auto refIdxExpr = ((IndexExpr *)expr->refExpr);
 			CompileExpr(refIdxExpr->index);
-			symbol = mSymbolTable->Resolve(refIdxExpr->ds->tagToken, refIdxExpr->ds->ToString());
+			symbol = mSymbolTable->Resolve(refIdxExpr->ds->tagToken, ToAtom(refIdxExpr->ds->ToString()), refIdxExpr->ds->ToString());
 			if (symbol.location == SymbolLocation::GLOBAL)
 			{
-				EmitOpCode(OP_REF_INDEX_GLOBAL, symbol.relatedToken);
-				Emit(symbol.index);
+				EmitOpCode(OP_REF_INDEX_GLOBAL, symbol.index, symbol.relatedToken);
 			}
 			else if (symbol.location == SymbolLocation::LOCAL)
 			{
-				EmitOpCode(OP_REF_INDEX_LOCAL, symbol.relatedToken);
-				Emit(symbol.index);
+				EmitOpCode(OP_REF_INDEX_LOCAL, symbol.index, symbol.relatedToken);
 			}
 			else if (symbol.location == SymbolLocation::UPVALUE)
 			{
-				EmitOpCode(OP_REF_INDEX_UPVALUE, symbol.relatedToken);
-				Emit(symbol.upvalue.index);
+				EmitOpCode(OP_REF_INDEX_UPVALUE, symbol.upvalue.index, symbol.relatedToken);
 			}
 		}
 		else
 		{
-			symbol = mSymbolTable->Resolve(expr->refExpr->tagToken, expr->refExpr->ToString());
+			symbol = mSymbolTable->Resolve(expr->refExpr->tagToken, ToAtom(expr->refExpr->ToString()), expr->refExpr->ToString());
 			if (symbol.location == SymbolLocation::GLOBAL)
 			{
-				EmitOpCode(OP_REF_GLOBAL, symbol.relatedToken);
-				Emit(symbol.index);
+				EmitOpCode(OP_REF_GLOBAL, symbol.index, symbol.relatedToken);
 			}
 			else if (symbol.location == SymbolLocation::LOCAL)
 			{
-				EmitOpCode(OP_REF_LOCAL, symbol.relatedToken);
-				Emit(symbol.index);
+				EmitOpCode(OP_REF_LOCAL, symbol.index, symbol.relatedToken);
 			}
 			else if (symbol.location == SymbolLocation::UPVALUE)
 			{
-				EmitOpCode(OP_REF_UPVALUE, symbol.relatedToken);
-				Emit(symbol.upvalue.index);
+				EmitOpCode(OP_REF_UPVALUE, symbol.upvalue.index, symbol.relatedToken);
 			}
 		}
 	}
@@ -1094,11 +1579,9 @@ namespace CynicScript
 		for (auto [k, v] : expr->elements)
 		{
 			CompileExpr(v);
-			EmitConstant(new StrObject(k), v->tagToken);
+			EmitConstant(InternStr(k), v->tagToken);
 		}
-		EmitOpCode(OP_STRUCT, expr->tagToken);
-		uint8_t pos = static_cast<uint8_t>(expr->elements.size());
-		Emit(pos);
+		EmitOpCode(OP_STRUCT, static_cast<uint32_t>(expr->elements.size()), expr->tagToken);
 	}
 
 	void Compiler::CompileVarArgExpr(VarArgExpr *expr, const RWState &state)
@@ -1117,29 +1600,47 @@ namespace CynicScript
 	{
 		auto varArg = GetVarArgFromParameterList(decl->parameters);
 
-		auto functionSymbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, decl->name->literal, FunctionSymbolInfo{(int8_t)decl->parameters.size(), varArg});
+		auto functionSymbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(decl->name), decl->name->literal, FunctionSymbolInfo{(int8_t)decl->parameters.size(), varArg});
 
 		mFunctionList.emplace_back(new FunctionObject(decl->name->literal));
 		mSymbolTable = new SymbolTable(mSymbolTable);
 
+		CompileFunctionBody(decl, kind);
+
+		auto upvalues = mSymbolTable->mUpValues;
+
+		mSymbolTable = mSymbolTable->enclosing;
+
+		auto function = mFunctionList.back();
+		mFunctionList.pop_back();
+
+		EmitClosure(function, upvalues.data(), decl->tagToken);
+
+		return functionSymbol;
+	}
+
+	void Compiler::CompileFunctionBody(FunctionDecl *decl, ClassDecl::FunctionKind kind)
+	{
+		auto varArg = GetVarArgFromParameterList(decl->parameters);
+
 		STRING symbolName = decl->name->literal;
 		if (kind == ClassDecl::FunctionKind::MEMBER || kind == ClassDecl::FunctionKind::CONSTRUCTOR)
 			symbolName = TEXT("this");
-		mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, symbolName);
+		mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(symbolName), symbolName);
 
-		CurFunction()->arity = static_cast<uint8_t>(decl->parameters.size());
+		CurFunction()->arity = static_cast<uint16_t>(decl->parameters.size());
 		CurFunction()->varArg = varArg;
 
 		for (const auto &param : decl->parameters)
 		{
 			auto varDescExpr = (VarDescExpr *)param;
 			if (varDescExpr->name->kind == AstKind::IDENTIFIER)
-				mSymbolTable->Define(varDescExpr->tagToken, Permission::MUTABLE, ((IdentifierExpr *)((VarDescExpr *)param)->name)->literal);
+				mSymbolTable->Define(varDescExpr->tagToken, Permission::MUTABLE, ToAtom((IdentifierExpr *)varDescExpr->name), ((IdentifierExpr *)varDescExpr->name)->literal);
 			else if (varDescExpr->name->kind == AstKind::VAR_ARG)
 			{
 				auto varArg = ((VarArgExpr *)varDescExpr->name);
 				if (varArg->argName)
-					mSymbolTable->Define(varArg->argName->tagToken, Permission::MUTABLE, varArg->argName->literal);
+					mSymbolTable->Define(varArg->argName->tagToken, Permission::MUTABLE, ToAtom(varArg->argName), varArg->argName->literal);
 			}
 		}
 
@@ -1155,27 +1656,43 @@ namespace CynicScript
 		}
 
 		mFunctionList.back()->upValueCount = mSymbolTable->mUpValueCount;
+	}
 
-		auto upvalues = mSymbolTable->mUpValues;
-
-		mSymbolTable = mSymbolTable->enclosing;
-
-		auto function = mFunctionList.back();
-		mFunctionList.pop_back();
-
-		EmitClosure(function, decl->tagToken);
+	void Compiler::DeclareVars(VarDecl *decl)
+	{
+		auto declare = [this, decl](IdentifierExpr *name)
+		{
+			mSymbolTable->Define(name->tagToken, decl->permission, ToAtom(name), name->literal);
+		};
 
-		for (int32_t i = 0; i < function->upValueCount; ++i)
+		for (const auto &[k, v] : decl->variables)
 		{
-			Emit(upvalues[i].location);
-			Emit(upvalues[i].depth);
+			if (k->kind == AstKind::VAR_DESC)
+			{
+				auto name = ((VarDescExpr *)k)->name;
+				declare(name->kind == AstKind::VAR_ARG ? ((VarArgExpr *)name)->argName : (IdentifierExpr *)name);
+			}
+			else if (k->kind == AstKind::ARRAY)
+			{
+				for (const auto &element : ((ArrayExpr *)k)->elements)
+				{
+					auto name = ((VarDescExpr *)element)->name;
+					if (name->kind == AstKind::IDENTIFIER)
+						declare((IdentifierExpr *)name);
+					else if (name->kind == AstKind::VAR_ARG && ((VarArgExpr *)name)->argName)
+						declare(((VarArgExpr *)name)->argName);
+				}
+			}
 		}
-
-		return functionSymbol;
 	}
 
-	uint32_t Compiler::CompileVars(VarDecl *decl, bool IsInClassOrModuleScope)
+	uint32_t Compiler::CompileVars(VarDecl *decl, bool IsInClassOrModuleScope, bool isDeclared)
 	{
+		auto defineOrResolve = [this, decl, isDeclared](const Token *token, Atom atom, const STRING &literal)
+		{
+			return isDeclared ? mSymbolTable->Resolve(token, atom, literal) : mSymbolTable->Define(token, decl->permission, atom, literal);
+		};
+
 		uint32_t varCount = 0;
 
 		auto postfixExprs = StatsPostfixExprs(decl);
@@ -1196,36 +1713,42 @@ namespace CynicScript
 					{
 						CompileExpr(v);
 
-						appregateOpCodeAddress = EmitOpCode((OpCode)0xFF, arrayExpr->tagToken) - static_cast<uint64_t>(1);
+						appregateOpCodeAddress = EmitOpCode((OpCode)0xFF, arrayExpr->tagToken);
 						resolveAddress = Emit((OpCode)0xFF);
 					}
 
 					int32_t resolveCount = 0;
+					std::vector<std::pair<Symbol, STRING>> declaredSymbols; // pushed again with their names once every slot is written
 
+					// reversed on a copy,the ast is compiled again when the program is recompiled
+					auto elements = arrayExpr->elements;
 					if (mSymbolTable->enclosing == nullptr && mSymbolTable->mScopeDepth > 0) // local scope
-						std::reverse(arrayExpr->elements.begin(), arrayExpr->elements.end());
+						std::reverse(elements.begin(), elements.end());
 
-					for (int32_t i = 0; i < arrayExpr->elements.size(); ++i)
+					for (int32_t i = 0; i < elements.size(); ++i)
 					{
 						Symbol symbol;
 						STRING literal;
+						Atom atom = NO_ATOM;
 						Token *token = nullptr;
 
-						if (((VarDescExpr *)arrayExpr->elements[i])->name->kind == AstKind::IDENTIFIER)
+						if (((VarDescExpr *)elements[i])->name->kind == AstKind::IDENTIFIER)
 						{
-							literal = ((IdentifierExpr *)((VarDescExpr *)arrayExpr->elements[i])->name)->literal;
-							token = ((IdentifierExpr *)((VarDescExpr *)arrayExpr->elements[i])->name)->tagToken;
-							symbol = mSymbolTable->Define(token, decl->permission, literal);
+							literal = ((IdentifierExpr *)((VarDescExpr *)elements[i])->name)->literal;
+							atom = ToAtom((IdentifierExpr *)((VarDescExpr *)elements[i])->name);
+							token = ((IdentifierExpr *)((VarDescExpr *)elements[i])->name)->tagToken;
+							symbol = defineOrResolve(token, atom, literal);
 							resolveCount++;
 						}
-						else if (((VarDescExpr *)arrayExpr->elements[i])->name->kind == AstKind::VAR_ARG)
+						else if (((VarDescExpr *)elements[i])->name->kind == AstKind::VAR_ARG)
 						{
 							// varArg with name like:let [x,y,...args] (means IdentifierExpr* in VarDescExpr* not nullptr)
-							if (((VarArgExpr *)((VarDescExpr *)arrayExpr->elements[i])->name)->argName)
+							if (((VarArgExpr *)((VarDescExpr *)elements[i])->name)->argName)
 							{
-								literal = ((VarArgExpr *)((VarDescExpr *)arrayExpr->elements[i])->name)->argName->literal;
-								token = ((VarArgExpr *)((VarDescExpr *)arrayExpr->elements[i])->name)->argName->tagToken;
-								symbol = mSymbolTable->Define(token, decl->permission, literal);
+								literal = ((VarArgExpr *)((VarDescExpr *)elements[i])->name)->argName->literal;
+								atom = ToAtom(((VarArgExpr *)((VarDescExpr *)elements[i])->name)->argName);
+								token = ((VarArgExpr *)((VarDescExpr *)elements[i])->name)->argName->tagToken;
+								symbol = defineOrResolve(token, atom, literal);
 								resolveCount++;
 								appregateOpCode = OP_APPREGATE_RESOLVE_VAR_ARG;
 							}
@@ -1235,13 +1758,18 @@ namespace CynicScript
 
 						if (symbol.location == SymbolLocation::GLOBAL)
 						{
-							EmitOpCode(OP_SET_GLOBAL, symbol.relatedToken);
-							Emit(symbol.index);
+							EmitOpCode(OP_SET_GLOBAL, symbol.index, symbol.relatedToken);
 							EmitOpCode(OP_POP, symbol.relatedToken);
 						}
+						else if (isDeclared)
+						{
+							EmitOpCode(OP_SET_LOCAL, symbol.index, token);
+							EmitOpCode(OP_POP, token);
+							declaredSymbols.emplace_back(symbol, literal);
+						}
 						else if (IsInClassOrModuleScope)
 						{
-							EmitConstant(new StrObject(literal), token);
+							EmitConstant(InternStr(literal), token);
 						}
 						varCount++;
 					}
@@ -1249,7 +1777,15 @@ namespace CynicScript
 					CurOpCodeList()[appregateOpCodeAddress] = appregateOpCode;
 					CurOpCodeList()[resolveAddress] = resolveCount;
 
-					if (IsInClassOrModuleScope)
+					if (isDeclared)
+					{
+						for (const auto &[symbol, literal] : declaredSymbols)
+						{
+							EmitOpCode(OP_GET_LOCAL, symbol.index, symbol.relatedToken);
+							EmitConstant(InternStr(literal), symbol.relatedToken);
+						}
+					}
+					else if (IsInClassOrModuleScope)
 					{
 						EmitOpCode(OP_RESET, decl->tagToken);
 						Emit(varCount);
@@ -1260,35 +1796,39 @@ namespace CynicScript
 					CompileExpr(v);
 
 					STRING literal;
+					Atom atom = NO_ATOM;
 					Token *token = nullptr;
 
 					if (((VarDescExpr *)k)->name->kind == AstKind::IDENTIFIER)
 					{
 						literal = ((IdentifierExpr *)(((VarDescExpr *)k)->name))->literal;
+						atom = ToAtom((IdentifierExpr *)(((VarDescExpr *)k)->name));
 						token = ((IdentifierExpr *)(((VarDescExpr *)k)->name))->tagToken;
 					}
 
 					else if (((VarDescExpr *)k)->name->kind == AstKind::VAR_ARG)
 					{
 						literal = ((VarArgExpr *)((VarDescExpr *)k)->name)->argName->literal;
+						atom = ToAtom(((VarArgExpr *)((VarDescExpr *)k)->name)->argName);
 						token = ((VarArgExpr *)((VarDescExpr *)k)->name)->argName->tagToken;
 					}
 
-					auto symbol = mSymbolTable->Define(token, decl->permission, literal);
+					auto symbol = defineOrResolve(token, atom, literal);
 					if (symbol.location == SymbolLocation::GLOBAL)
 					{
-						EmitOpCode(OP_SET_GLOBAL, symbol.relatedToken);
-						Emit(symbol.index);
+						EmitOpCode(OP_SET_GLOBAL, symbol.index, symbol.relatedToken);
 						EmitOpCode(OP_POP, symbol.relatedToken);
 					}
 					else if (IsInClassOrModuleScope)
 					{
-						EmitConstant(new StrObject(literal), token);
+						if (isDeclared)
+							EmitOpCode(OP_SET_LOCAL, symbol.index, token);
+						EmitConstant(InternStr(literal), token);
 					}
 					varCount++;
 				}
 				else
-					CYS_LOG_ERROR_WITH_LOC(k->tagToken, TEXT("Unknown variable:{}"), k->ToString());
+					ReportError(k->tagToken, TEXT("Unknown variable:{}"), k->ToString());
 			}
 		}
 
@@ -1303,22 +1843,22 @@ namespace CynicScript
 
 	Symbol Compiler::CompileClass(ClassDecl *decl)
 	{
-		auto symbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, decl->name);
+		auto symbol = mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(decl->name), decl->name);
 
 		mFunctionList.emplace_back(new FunctionObject(decl->name));
 		mSymbolTable = new SymbolTable(mSymbolTable);
 
-		mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, TEXT(""));
+		mSymbolTable->Define(decl->tagToken, Permission::IMMUTABLE, ToAtom(TEXT("")), TEXT(""));
 
-		int8_t varCount = 0;
-		int8_t constCount = 0;
-		int8_t constructorCount = 0;
+		uint32_t varCount = 0;
+		uint32_t constCount = 0;
+		uint32_t constructorCount = 0;
 
 		for (const auto &enumeration : decl->enumerations)
 		{
 			auto decl = enumeration.second;
 			CompileEnumDecl(decl);
-			EmitConstant(new StrObject(decl->name->literal), decl->tagToken);
+			EmitConstant(InternStr(decl->name->literal), decl->tagToken);
 			constCount++;
 		}
 
@@ -1328,7 +1868,7 @@ namespace CynicScript
 			if (functionMember.kind == ClassDecl::FunctionKind::MEMBER)
 			{
 				CompileFunction(functionMember.decl, ClassDecl::FunctionKind::MEMBER);
-				EmitConstant(new StrObject(functionMember.decl->name->literal), decl->tagToken);
+				EmitConstant(InternStr(functionMember.decl->name->literal), decl->tagToken);
 				constCount++;
 			}
 		}
@@ -1350,9 +1890,8 @@ namespace CynicScript
 		for (const auto &parent : decl->parents)
 		{
 			CompileIdentifierExpr(parent.second, RWState::READ);
-			EmitOpCode(OP_CALL, parent.second->tagToken);
-			Emit(0);
-			EmitConstant(new StrObject(parent.second->literal), parent.second->tagToken);
+			EmitOpCode(OP_CALL, 0, parent.second->tagToken);
+			EmitConstant(InternStr(parent.second->literal), parent.second->tagToken);
 		}
 
 		for (const auto &functionMember : decl->functions)
@@ -1365,12 +1904,8 @@ namespace CynicScript
 			}
 		}
 
-		EmitConstant(new StrObject(decl->name), decl->tagToken);
-		EmitOpCode(OP_CLASS, decl->tagToken);
-		Emit(constructorCount);
-		Emit(varCount);
-		Emit(constCount);
-		Emit(static_cast<uint8_t>(decl->parents.size()));
+		EmitConstant(InternStr(decl->name), decl->tagToken);
+		EmitOpCode(OP_CLASS, {constructorCount, varCount, constCount, static_cast<uint32_t>(decl->parents.size())}, decl->tagToken);
 
 		EmitReturn(1, decl->tagToken);
 
@@ -1379,19 +1914,57 @@ namespace CynicScript
 		auto function = mFunctionList.back();
 		mFunctionList.pop_back();
 
-		EmitClosure(function, decl->tagToken);
+		EmitClosure(function, nullptr, decl->tagToken);
 
 		return symbol;
 	}
 
+	// every opcode is followed by the 16-bit index of its token,consecutive instructions of the same token share one entry
 	uint64_t Compiler::EmitOpCode(OpCode opCode, const Token *token)
 	{
-		Emit((uint8_t)opCode);
+		auto address = Emit((uint8_t)opCode);
+
+		auto &relatedTokens = CurChunk().opCodeRelatedTokens;
+		if (relatedTokens.empty() || relatedTokens.back() != token)
+		{
+			if (relatedTokens.size() == UINT16_COUNT)
+				ReportError(token, TEXT("Function too large,at most {} instruction tokens are available."), UINT16_COUNT);
+			relatedTokens.emplace_back(token);
+		}
+
+		auto tokenIndex = relatedTokens.size() - 1;
+		Emit((tokenIndex >> 8) & 0xFF);
+		Emit(tokenIndex & 0xFF);
+
+		return address;
+	}
+
+	uint64_t Compiler::EmitOpCode(OpCode opCode, uint32_t operand, const Token *token)
+	{
+		return EmitOpCode(opCode, {operand}, token);
+	}
 
-		CurChunk().opCodeRelatedTokens.emplace_back(token);
+	// all operands of the instruction take the wide form if one of them does not fit in 8 bits
+	uint64_t Compiler::EmitOpCode(OpCode opCode, std::initializer_list<uint32_t> operands, const Token *token)
+	{
+		bool isWide = false;
+		for (const auto &operand : operands)
+		{
+			if (operand >= UINT16_COUNT)
+				ReportError(token, TEXT("Operand {} out of range,at most {} is available."), operand, UINT16_MAX);
+			isWide |= operand >= UINT8_COUNT;
+		}
 
-		Emit(static_cast<uint8_t>(CurChunk().opCodeRelatedTokens.size() - 1));
+		if (isWide)
+			EmitOpCode(OP_WIDE, token);
+		EmitOpCode(opCode, token);
 
+		for (const auto &operand : operands)
+		{
+			if (isWide)
+				Emit((operand >> 8) & 0xFF);
+			Emit(operand & 0xFF);
+		}
 		return CurOpCodeList().size() - 1;
 	}
 
@@ -1403,17 +1976,45 @@ namespace CynicScript
 
 	uint64_t Compiler::EmitConstant(const Value &value, const Token *token)
 	{
-		EmitOpCode(OP_CONSTANT, token);
-		uint8_t pos = AddConstant(value);
-		Emit(pos);
+		auto pos = AddConstant(value, token);
+		EmitConstantIndex(OP_CONSTANT, OP_CONSTANT_LONG, pos, token);
 		return CurOpCodeList().size() - 1;
 	}
 
-	uint64_t Compiler::EmitClosure(FunctionObject *function, const Token *token)
+	void Compiler::EmitConstantIndex(OpCode opCode, OpCode longOpCode, uint32_t pos, const Token *token)
+	{
+		if (pos < UINT8_COUNT)
+		{
+			EmitOpCode(opCode, token);
+			Emit(static_cast<uint8_t>(pos));
+		}
+		else
+		{
+			EmitOpCode(longOpCode, token);
+			Emit((pos >> 16) & 0xFF);
+			Emit((pos >> 8) & 0xFF);
+			Emit(pos & 0xFF);
+		}
+	}
+
+	uint64_t Compiler::EmitClosure(FunctionObject *function, const UpValue *upvalues, const Token *token)
 	{
-		uint8_t pos = AddConstant(function);
-		EmitOpCode(OP_CLOSURE, token);
-		Emit(pos);
+		auto upvalueCount = upvalues ? function->upValueCount : 0;
+		auto isWide = std::any_of(upvalues, upvalues + upvalueCount, [](const UpValue &upvalue)
+								  { return upvalue.location >= UINT8_COUNT; });
+		if (isWide)
+			EmitOpCode(OP_WIDE, token);
+
+		auto pos = AddConstant(function, token);
+		EmitConstantIndex(OP_CLOSURE, OP_CLOSURE_LONG, pos, token);
+
+		for (int32_t i = 0; i < upvalueCount; ++i)
+		{
+			if (isWide)
+				Emit((upvalues[i].location >> 8) & 0xFF);
+			Emit(upvalues[i].location & 0xFF);
+			Emit(upvalues[i].depth);
+		}
 		return CurOpCodeList().size() - 1;
 	}
 
@@ -1426,58 +2027,119 @@ namespace CynicScript
 
 	uint64_t Compiler::EmitJump(OpCode opcode, const Token *token)
 	{
+		if (mIsForwardJumpWide)
+			EmitOpCode(OP_WIDE, token);
 		EmitOpCode(opcode, token);
-		Emit(0xFF);
-		Emit(0xFF);
-		return CurOpCodeList().size() - 2;
+
+		auto operandSize = mIsForwardJumpWide ? 4 : 2;
+		for (int32_t i = 0; i < operandSize; ++i)
+			Emit(0xFF);
+		return CurOpCodeList().size() - operandSize;
 	}
 
-	void Compiler::EmitLoop(uint16_t opcode, const Token *token)
+	void Compiler::EmitLoop(uint64_t loopStart, const Token *token)
 	{
-		EmitOpCode(OP_LOOP, token);
-		uint16_t offset = static_cast<uint16_t>(CurOpCodeList().size()) - opcode + 2;
+		// the distance is known here,only loops over more than 64KB take the wide form
+		uint64_t offset = CurOpCodeList().size() + 5 - loopStart; // opcode,token index and offset
+		if (offset <= UINT16_MAX)
+		{
+			EmitOpCode(OP_LOOP, token);
+			Emit((offset >> 8) & 0xFF);
+			Emit(offset & 0xFF);
+			return;
+		}
 
-		Emit((offset >> 8) & 0xFF);
-		Emit(offset & 0xFF);
+		EmitOpCode(OP_WIDE, token);
+		EmitOpCode(OP_LOOP, token);
+		offset = CurOpCodeList().size() + 4 - loopStart;
+		for (int32_t shift = 24; shift >= 0; shift -= 8)
+			Emit((offset >> shift) & 0xFF);
 	}
 
 	void Compiler::PatchJump(uint64_t offset)
 	{
-		uint16_t jumpOffset = static_cast<uint16_t>(CurOpCodeList().size() - offset - 2);
-		CurOpCodeList()[offset] = (jumpOffset >> 8) & 0xFF;
-		CurOpCodeList()[offset + 1] = (jumpOffset)&0xFF;
+		auto operandSize = mIsForwardJumpWide ? 4 : 2;
+		uint64_t jumpOffset = CurOpCodeList().size() - offset - operandSize;
+		if (!mIsForwardJumpWide && jumpOffset > UINT16_MAX)
+			mIsJumpOverflowed = true; // recompiled with wide forward jumps
+
+		for (int32_t i = 0; i < operandSize; ++i)
+			CurOpCodeList()[offset + i] = (jumpOffset >> ((operandSize - 1 - i) * 8)) & 0xFF;
+	}
+
+	uint32_t Compiler::AddConstant(const Value &value, const Token *token)
+	{
+		ConstantKey key{value.kind, 0};
+		switch (value.kind)
+		{
+		case ValueKind::INT:
+			key.bits = static_cast<uint64_t>(value.integer);
+			break;
+		case ValueKind::REAL:
+			key.bits = std::bit_cast<uint64_t>(value.realnum);
+			break;
+		case ValueKind::BOOL:
+			key.bits = value.boolean;
+			break;
+		case ValueKind::OBJECT:
+			key.bits = reinterpret_cast<uintptr_t>(value.object);
+			break;
+		default:
+			break;
+		}
+
+		auto &chunk = CurChunk();
+		auto [iter, isNew] = mConstantIndices[&chunk].try_emplace(key, static_cast<uint32_t>(chunk.constants.size()));
+		if (isNew)
+		{
+			if (chunk.constants.size() >= UINT24_COUNT)
+				ReportError(token, TEXT("Too many constants in function."));
+			chunk.constants.emplace_back(value);
+		}
+		return iter->second;
+	}
+
+	StrObject *Compiler::InternStr(STRING_VIEW str)
+	{
+		return Allocator::GetInstance()->InternStr(str);
 	}
 
-	uint8_t Compiler::AddConstant(const Value &value)
+	size_t Compiler::ConstantKeyHash::operator()(const ConstantKey &key) const
 	{
-		CurChunk().constants.emplace_back(value);
-		return static_cast<uint8_t>(CurChunk().constants.size()) - 1;
+		return std::hash<uint64_t>()(key.bits) ^ key.kind;
 	}
 
 	void Compiler::EmitSymbol(const Symbol &symbol)
 	{
 		if (symbol.location == SymbolLocation::GLOBAL)
 		{
-			EmitOpCode(OP_SET_GLOBAL, symbol.relatedToken);
-			Emit(symbol.index);
+			EmitOpCode(OP_SET_GLOBAL, symbol.index, symbol.relatedToken);
 			EmitOpCode(OP_POP, symbol.relatedToken);
 		}
 		else if (symbol.location == SymbolLocation::LOCAL)
 		{
-			EmitOpCode(OP_SET_LOCAL, symbol.relatedToken);
-			Emit(symbol.index);
+			EmitOpCode(OP_SET_LOCAL, symbol.index, symbol.relatedToken);
 		}
 	}
 
 	void Compiler::EnterScope()
 	{
 		mSymbolTable->mScopeDepth++;
+		mSymbolTable->mScopeStarts.emplace_back(mSymbolTable->mSymbolCount);
 	}
 	void Compiler::ExitScope()
 	{
 		mSymbolTable->mScopeDepth--;
 
-		for (int32_t i = 0; i < mSymbolTable->mSymbols.size(); ++i)
+		// only symbols defined since the scope was entered can still be live locals of it
+		uint32_t start = 0;
+		if (!mSymbolTable->mScopeStarts.empty())
+		{
+			start = mSymbolTable->mScopeStarts.back();
+			mSymbolTable->mScopeStarts.pop_back();
+		}
+
+		for (uint32_t i = start; i < mSymbolTable->mSymbolCount; ++i)
 		{
 			Symbol *symbol = &mSymbolTable->mSymbols[i];
 			if (symbol->location == SymbolLocation::LOCAL &&
@@ -1726,5 +2388,8 @@ namespace CynicScript
 	{
 		SAFE_DELETE(mSymbolTable);
 		std::vector<FunctionObject *>().swap(mFunctionList);
+		mConstantIndices.clear();
+		mDeferredBodies.clear();
+		mImportPaths.clear();
 	}
 }
\ No newline at end of file
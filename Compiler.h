@@ -1,4 +1,5 @@
 #pragma once
+#include <initializer_list>
 #include "Chunk.h"
 #include "Ast.h"
 #include "Object.h"
@@ -6,7 +7,19 @@
 namespace CynicScript
 {
 	struct Symbol;
+	struct UpValue;
 	class SymbolTable;
+
+	// a global symbol as later compilations see it,its slot is its position among the globals
+	struct GlobalSymbol
+	{
+		STRING name;
+		Permission permission{Permission::IMMUTABLE};
+		int8_t paramCount{-1}; // functions are overloaded by parameter count
+		VarArg varArg{VarArg::NONE};
+		STRING importPath; // as written,for the module of a top level import
+	};
+
 	class CYS_API Compiler
 	{
 	public:
@@ -14,10 +27,27 @@ namespace CynicScript
 		~Compiler();
 
 		FunctionObject *Compile(Stmt *stmt);
+		// compile stmt on top of the globals defined by the previous compilations instead of starting over,the repl compiles each input this way
+		FunctionObject *CompileIncremental(Stmt *stmt);
 
 		void ResetStatus();
 
+		// the module function of an imported file(see ModuleManager),the file may only hold what a module declaration
+		// holds and imports.Like a module declaration the function takes a null per symbol and returns the module object
+		FunctionObject *CompileModule(Stmt *stmt, STRING_VIEW name);
+
+		// the globals defined so far in slot order,the libraries first
+		std::vector<GlobalSymbol> GetGlobalSymbols() const;
+		// start over with the globals of an earlier session(see HeapImage),continue with CompileIncremental()
+		void RestoreGlobalSymbols(const std::vector<GlobalSymbol> &symbols);
+
+		// bodies of top level functions and modules are compiled on this many threads,the result is the same as
+		// compiling them in place.1 compiles everything on the calling thread,0 uses one thread per hardware thread
+		void SetParallelWorkerCount(size_t count);
+
 	private:
+		Compiler(Compiler *owner); // compiles bodies deferred by owner
+
 		enum class RWState // read write state
 		{
 			READ,
@@ -30,6 +60,7 @@ namespace CynicScript
 		void CompileClassDecl(ClassDecl *decl);
 		void CompileEnumDecl(EnumDecl *decl);
 		void CompileModuleDecl(ModuleDecl *decl);
+		void CompileImportDecl(ImportDecl *decl);
 
 		void CompileDeclAndStmt(Stmt *stmt);
 
@@ -57,6 +88,7 @@ namespace CynicScript
 		void CompileThisExpr(ThisExpr *expr);
 		void CompileBaseExpr(BaseExpr *expr);
 		void CompileIdentifierExpr(IdentifierExpr *expr, const RWState &state, int8_t paramCount = -1);
+		void CompileIdentifier(Token *tagToken, Atom atom, const STRING &name, const RWState &state, int8_t paramCount = -1);
 		void CompileLambdaExpr(LambdaExpr *expr);
 		void CompileCompoundExpr(CompoundExpr *expr);
 		void CompileCallExpr(CallExpr *expr);
@@ -67,18 +99,27 @@ namespace CynicScript
 		void CompileFactorialExpr(FactorialExpr *expr, const RWState &state = RWState::READ);
 
 		Symbol CompileFunction(FunctionDecl *decl, ClassDecl::FunctionKind kind = ClassDecl::FunctionKind::NONE);
-		uint32_t CompileVars(VarDecl *decl, bool IsInClassOrModuleScope);
+		void CompileFunctionBody(FunctionDecl *decl, ClassDecl::FunctionKind kind);
+		void CompileModuleBody(ModuleDecl *decl);
+		// isDeclared:the symbols were defined by DeclareVars(),only their slots are written
+		uint32_t CompileVars(VarDecl *decl, bool IsInClassOrModuleScope, bool isDeclared = false);
+		void DeclareVars(VarDecl *decl);
 		Symbol CompileClass(ClassDecl *decl);
 
 		uint64_t EmitOpCode(OpCode opCode, const Token *token);
+		uint64_t EmitOpCode(OpCode opCode, uint32_t operand, const Token *token);
+		uint64_t EmitOpCode(OpCode opCode, std::initializer_list<uint32_t> operands, const Token *token);
 		uint64_t Emit(uint8_t opcode);
 		uint64_t EmitConstant(const Value &value, const Token *token);
-		uint64_t EmitClosure(FunctionObject *function, const Token *token);
+		void EmitConstantIndex(OpCode opCode, OpCode longOpCode, uint32_t pos, const Token *token);
+		uint64_t EmitClosure(FunctionObject *function, const UpValue *upvalues, const Token *token);
+		void EmitModuleCall(FunctionObject *function, uint32_t symbolCount, const Token *token);
 		uint64_t EmitReturn(uint8_t retCount, const Token *token);
 		uint64_t EmitJump(OpCode opcode, const Token *token);
-		void EmitLoop(uint16_t opcode, const Token *token);
+		void EmitLoop(uint64_t loopStart, const Token *token);
 		void PatchJump(uint64_t offset);
-		uint8_t AddConstant(const Value &value);
+		uint32_t AddConstant(const Value &value, const Token *token);
+		StrObject *InternStr(STRING_VIEW str);
 
 		void EmitSymbol(const Symbol &symbol);
 
@@ -93,11 +134,53 @@ namespace CynicScript
 
 		std::vector<Expr *> StatsPostfixExprs(AstNode *astNode);
 
+		FunctionObject *CompileMainFunction(Stmt *stmt);
+
+		// a body left to be compiled after the main function,see CompileDeferredBodies()
+		struct DeferredBody
+		{
+			Stmt *decl;
+			FunctionObject *function;
+			uint32_t visibleSymbolCount; // globals defined before the body
+			uint32_t symbolCount;		 // expected symbol count of a module table
+		};
+
+		void DeferFunctionDecl(FunctionDecl *decl);
+		void DeferModuleDecl(ModuleDecl *decl);
+		static uint32_t CountModuleSymbols(ModuleDecl *decl);
+		void CompileDeferredBodies();
+		void CompileDeferredBody(const DeferredBody &body, SymbolTable *globalSymbolTable);
+
 		void ClearStatus();
 
 		std::vector<FunctionObject *> mFunctionList;
 		SymbolTable *mSymbolTable;
 
 		int64_t mCurBreakStmtAddress, mCurContinueStmtAddress;
+
+		// forward jumps are emitted before their distance is known,see CompileMainFunction()
+		bool mIsForwardJumpWide;
+		bool mIsJumpOverflowed;
+
+		// identical constants share one slot per chunk,names share one object across all chunks(see Allocator::InternStr)
+		struct ConstantKey
+		{
+			ValueKind kind;
+			uint64_t bits; // the integer,the bit pattern of the real number,the boolean or the object address
+
+			bool operator==(const ConstantKey &other) const = default;
+		};
+
+		struct ConstantKeyHash
+		{
+			size_t operator()(const ConstantKey &key) const;
+		};
+
+		std::unordered_map<const Chunk *, std::unordered_map<ConstantKey, uint32_t, ConstantKeyHash>> mConstantIndices;
+
+		size_t mParallelWorkerCount{0};
+		std::vector<DeferredBody> mDeferredBodies;
+		std::unordered_map<uint32_t, STRING> mImportPaths; // of the globals bound by top level imports,by slot
+		bool mIsDeferredBodyMismatched{false};
 	};
 }
\ No newline at end of file
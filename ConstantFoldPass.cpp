@@ -212,7 +212,6 @@ namespace CynicScript
 		{
 			auto literalExpr = (LiteralExpr *)expr->expr;
 			auto intExpr = new LiteralExpr(expr->tagToken, Factorial(literalExpr->i64Value));
-			SAFE_DELETE(expr);
 			return intExpr;
 		}
 		else
@@ -252,7 +251,6 @@ namespace CynicScript
 			{
 				Expr *newExpr = infix;
 				auto tagToken = infix->tagToken;
-				bool needToDelete = true;
 
 				auto leftLiteral = ((LiteralExpr *)infix->left);
 				auto rightLiteral = ((LiteralExpr *)infix->right);
@@ -273,10 +271,7 @@ namespace CynicScript
 					else BIN_EXPR(>=);
 					else BIN_EXPR(<);
 					else BIN_EXPR(<=);
-					else needToDelete = false;
 #undef BIN_EXPR
-					if (needToDelete)
-						SAFE_DELETE(infix);
 					return newExpr;
 				}
 				else if (leftLiteral->type.IsInteger() && rightLiteral->type.IsInteger())
@@ -301,10 +296,7 @@ namespace CynicScript
 					else BIN_EXPR(<=);
 					else BIN_EXPR(<<);
 					else BIN_EXPR(>>);
-					else needToDelete = false;
 #undef BIN_EXPR
-					if (needToDelete)
-						SAFE_DELETE(infix);
 					return newExpr;
 				}
 				else if (leftLiteral->type.IsInteger() && rightLiteral->type.IsFloating())
@@ -323,10 +315,7 @@ namespace CynicScript
 					else BIN_EXPR(>=);
 					else BIN_EXPR(<);
 					else BIN_EXPR(<=);
-					else needToDelete = false;
 #undef BIN_EXPR
-					if (needToDelete)
-						SAFE_DELETE(infix);
 					return newExpr;
 				}
 				else if (leftLiteral->type.IsFloating() && rightLiteral->type.IsInteger())
@@ -346,16 +335,12 @@ namespace CynicScript
 					else BIN_EXPR(>=);
 					else BIN_EXPR(<);
 					else BIN_EXPR(<=);
-					else needToDelete = false;
 #undef BIN_EXPR
-					if (needToDelete)
-						SAFE_DELETE(infix);
 					return newExpr;
 				}
 				else if (leftLiteral->type.Is(TypeKind::STR) && rightLiteral->type.Is(TypeKind::STR))
 				{
 					auto strExpr = new LiteralExpr(infix->tagToken, leftLiteral->str + rightLiteral->str);
-					SAFE_DELETE(infix);
 					return strExpr;
 				}
 			}
@@ -370,25 +355,21 @@ namespace CynicScript
 				if (rightLiteralExpr->type.IsFloating() && prefix->op == TEXT("-"))
 				{
 					auto numExpr = new LiteralExpr(prefix->tagToken, -rightLiteralExpr->f64Value);
-					SAFE_DELETE(prefix);
 					return numExpr;
 				}
 				else if (rightLiteralExpr->type.IsInteger() && prefix->op == TEXT("-"))
 				{
 					auto numExpr = new LiteralExpr(prefix->tagToken, -rightLiteralExpr->i64Value);
-					SAFE_DELETE(prefix);
 					return numExpr;
 				}
 				else if (rightLiteralExpr->type.Is(TypeKind::BOOL) && prefix->op == TEXT("!"))
 				{
 					auto boolExpr = new LiteralExpr(prefix->tagToken, !rightLiteralExpr->boolean);
-					SAFE_DELETE(prefix);
 					return boolExpr;
 				}
 				else if (rightLiteralExpr->type.IsInteger() && prefix->op == TEXT("~"))
 				{
 					auto numExpr = new LiteralExpr(prefix->tagToken, ~rightLiteralExpr->i64Value);
-					SAFE_DELETE(prefix);
 					return numExpr;
 				}
 			}
@@ -402,7 +383,6 @@ namespace CynicScript
 				if (postfix->op == TEXT("!"))
 				{
 					auto numExpr = new LiteralExpr(postfix->tagToken, Factorial(leftLiteralExpr->i64Value));
-					SAFE_DELETE(postfix);
 					return numExpr;
 				}
 			}
@@ -1,5 +1,10 @@
 #include <string>
+#include <vector>
+#include <memory>
+#include <span>
+#include <clocale>
 #include <string_view>
+#include <filesystem>
 #include "CynicScript.h"
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -17,11 +22,29 @@ CynicScript::AstOptimizePassManager *gAstOptimizePassManager;
 CynicScript::Compiler *gCompiler{nullptr};
 CynicScript::VM *gVm{nullptr};
 
+CynicScript::BytecodeCache *gBytecodeCache{nullptr};
+CynicScript::BytecodeCache *gModuleBytecodeCache{nullptr}; // the cache keeps the source of its last load mapped,imported files must not unmap the one of the main script
+CynicScript::Compiler *gModuleCompiler{nullptr};
+CynicScript::HeapImage *gHeapImage{nullptr};
+
 struct Config
 {
 	std::string_view sourceFilePath;
 	bool isSerializeBinaryChunk{false};
 	std::string_view serializeBinaryFilePath;
+	bool isCompressBinaryChunk{false};
+	bool isBytecodeCacheEnabled{true};
+	std::string_view bytecodeCacheDirectory;
+	std::string_view heapSnapshotPath;
+	std::string_view heapDiffBeforePath;
+	std::string_view heapDiffAfterPath;
+	std::string_view serveSocketPath;
+	std::string_view connectSocketPath;
+	std::string_view heapImagePath;
+	std::string_view saveHeapImagePath;
+#ifdef CYS_HEAP_PROFILE
+	std::string_view heapProfilePath;
+#endif
 } gConfig;
 
 int32_t PrintVersion()
@@ -36,14 +59,26 @@ int32_t PrintUsage()
 	CYS_LOG_INFO(TEXT("-h or --help:show usage info."));
 	CYS_LOG_INFO(TEXT("-v or --version:show current CynicScript version"));
 	CYS_LOG_INFO(TEXT("-s or --serialize: serialize source file as bytecode binary file"));
-	CYS_LOG_INFO(TEXT("-f or --file:run source file with a valid file path,like : CynicScript -f examples/array.cd."));
-	CYS_LOG_INFO(TEXT("In REPL mode, you can input '{}' to clear the REPL history, and '{}' to exit the REPL."), CYS_REPL_CLEAR, CYS_REPL_EXIT);
+	CYS_LOG_INFO(TEXT("--compress:compress the string table of the binary file written by -s,smaller file at a little extra load time."));
+	CYS_LOG_INFO(TEXT("-f or --file:run source file with a valid file path,like : CynicScript -f examples/array.cd.Files ending with {} are loaded as bytecode binary files."), CYS_BINARY_FILE_EXTENSION);
+	CYS_LOG_INFO(TEXT("--cache-dir:directory the compiled bytecode of source files is cached in,default is $XDG_CACHE_HOME/CynicScript or ~/.cache/CynicScript,only used if it is private to the current user."));
+	CYS_LOG_INFO(TEXT("--no-cache:always compile source files,neither read nor write the bytecode cache."));
+	CYS_LOG_INFO(TEXT("--heap-snapshot:write a heap snapshot of the objects still reachable on exit,like : CynicScript -f examples/array.cd --heap-snapshot array.heapsnapshot."));
+	CYS_LOG_INFO(TEXT("--serve:keep a warm process serving compiles and runs at a unix socket,compiled programs are kept in memory,like : CynicScript --serve /tmp/CynicScript.sock."));
+	CYS_LOG_INFO(TEXT("--connect:have the source file of -f compiled and run by the server at the socket,with -s the binary file is compiled there,like : CynicScript --connect /tmp/CynicScript.sock -f examples/array.cd."));
+	CYS_LOG_INFO(TEXT("--save-image:write the globals left by the run and the objects they reach to a heap image,like : CynicScript -f rules.cd --save-image rules.cysi."));
+	CYS_LOG_INFO(TEXT("--image:start from the globals of a heap image instead of an empty state,the source file or the REPL inputs see them,like : CynicScript --image rules.cysi -f request.cd."));
+	CYS_LOG_INFO(TEXT("--heap-diff:compare two heap snapshots and print the changed objects and the largest retained-size dominators,like : CynicScript --heap-diff before.heapsnapshot after.heapsnapshot."));
+#ifdef CYS_HEAP_PROFILE
+	CYS_LOG_INFO(TEXT("--heap-profile:write sampled allocation reports to <prefix>.alloc.folded and <prefix>.live.folded on exit,like : CynicScript -f examples/array.cd --heap-profile heap."));
+	CYS_LOG_INFO(TEXT("--heap-profile-interval:sample an allocation every N bytes,default is {}."), HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL);
+#endif
+	CYS_LOG_INFO(TEXT("In REPL mode, you can input '{}' to forget the variables defined so far, and '{}' to exit the REPL."), CYS_REPL_CLEAR, CYS_REPL_EXIT);
 	return EXIT_FAILURE;
 }
 
-void Run(STRING_VIEW content)
+CynicScript::FunctionObject *Compile(const std::vector<CynicScript::Token *> &tokens, bool isIncremental = false)
 {
-	auto tokens = gLexer->ScanTokens(content);
 #ifndef NDEBUG
 	for (const auto &token : tokens)
 		CynicScript::Logger::Println(TEXT("{}"), *token);
@@ -55,8 +90,11 @@ void Run(STRING_VIEW content)
 #ifndef NDEBUG
 	CynicScript::Logger::Println(TEXT("{}"), stmt->ToString());
 #endif
-	auto mainFunc = gCompiler->Compile(stmt);
+	return isIncremental ? gCompiler->CompileIncremental(stmt) : gCompiler->Compile(stmt);
+}
 
+void Execute(CynicScript::FunctionObject *mainFunc)
+{
 #ifndef NDEBUG
 	auto str = mainFunc->ToStringWithChunk();
 	CynicScript::Logger::Println(TEXT("{}"), str);
@@ -64,7 +102,7 @@ void Run(STRING_VIEW content)
 
 	if (gConfig.isSerializeBinaryChunk)
 	{
-		auto data = mainFunc->chunk.Serialize();
+		auto data = CynicScript::BytecodeCache::Serialize(mainFunc, 0, 0, gConfig.isCompressBinaryChunk);
 		CynicScript::WriteBinaryFile(gConfig.serializeBinaryFilePath, data);
 	}
 	else
@@ -76,17 +114,20 @@ void Run(STRING_VIEW content)
 void Repl()
 {
 	STRING line;
-	STRING allLines;
+	// only the new input is compiled and run,the chunks of earlier inputs keep pointing at their tokens,so each input is scanned by its own lexer kept for the session
+	std::vector<std::unique_ptr<CynicScript::Lexer>> inputLexers;
 
 	PrintVersion();
 
 	CynicScript::Logger::Print(TEXT(">> "));
 	while (getline(CIN, line))
 	{
-		allLines += line;
 		if (line == CYS_REPL_CLEAR)
 		{
-			allLines.clear();
+			// the chunks of earlier inputs are dropped with the compiler status,so are their global slots,objects and tokens
+			gCompiler->ResetStatus();
+			CynicScript::Allocator::GetInstance()->ResetStatus();
+			inputLexers.clear();
 		}
 		else if (line == CYS_REPL_EXIT)
 		{
@@ -95,7 +136,8 @@ void Repl()
 		}
 		else
 		{
-			Run(allLines);
+			auto lexer = inputLexers.emplace_back(std::make_unique<CynicScript::Lexer>()).get();
+			Execute(Compile(lexer->ScanTokens(CynicScript::StringToSource(line)), true));
 		}
 
 		CynicScript::Logger::Print(TEXT(">> "));
@@ -104,8 +146,97 @@ void Repl()
 
 void RunFile(std::string_view path)
 {
-	STRING content = CynicScript::ReadFile(path);
-	Run(content);
+	if (path.ends_with(CYS_BINARY_FILE_EXTENSION))
+	{
+		Execute(gBytecodeCache->LoadProgram(path));
+		return;
+	}
+
+	// a program being serialized is always compiled,so -s never picks up a stale cache entry.
+	// Programs depend on the globals of a heap image,and saving one needs the globals named by the compiler
+	bool isCacheUsed = gConfig.isBytecodeCacheEnabled && !gConfig.isSerializeBinaryChunk && gConfig.heapImagePath.empty() && gConfig.saveHeapImagePath.empty();
+	if (isCacheUsed)
+	{
+		if (auto mainFunc = gBytecodeCache->Load(path))
+		{
+			Execute(mainFunc);
+			return;
+		}
+	}
+
+	// warnings of the front end are not replayed on a cache hit,so programs compiled with warnings are not cached
+	uint64_t warningCount = CynicScript::Logger::Record::mWarningCount;
+	auto mainFunc = Compile(gLexer->ScanFile(path), !gConfig.heapImagePath.empty());
+	if (isCacheUsed && warningCount == CynicScript::Logger::Record::mWarningCount)
+		gBytecodeCache->Store(mainFunc);
+	Execute(mainFunc);
+}
+
+CynicScript::FunctionObject *LoadModule(std::string_view path)
+{
+	// the tokens of a compiled module are kept by its chunks,like the inputs of the REPL
+	static std::vector<std::unique_ptr<CynicScript::Lexer>> moduleLexers;
+
+	// errors are reported against the imported file while it is loaded,the importer is what runs afterwards
+	auto importerFilePath = CynicScript::Logger::Record::mCurFilePath;
+	auto importerSourceCode = CynicScript::Logger::Record::mSourceCode;
+
+	auto moduleName = CynicScript::SourceToString(std::filesystem::path(path).stem().string());
+	CynicScript::FunctionObject *moduleFunc = gConfig.isBytecodeCacheEnabled ? gModuleBytecodeCache->Load(path, moduleName) : nullptr;
+	if (!moduleFunc)
+	{
+		uint64_t warningCount = CynicScript::Logger::Record::mWarningCount;
+
+		auto lexer = moduleLexers.emplace_back(std::make_unique<CynicScript::Lexer>()).get();
+		auto stmt = gParser->Parse(lexer->ScanFile(path));
+		gAstOptimizePassManager->Execute(stmt);
+		moduleFunc = gModuleCompiler->CompileModule(stmt, moduleName);
+
+		if (gConfig.isBytecodeCacheEnabled && warningCount == CynicScript::Logger::Record::mWarningCount)
+			gModuleBytecodeCache->Store(moduleFunc);
+	}
+
+	CynicScript::Logger::Record::mCurFilePath = importerFilePath;
+	CynicScript::Logger::Record::mSourceCode = importerSourceCode;
+	return moduleFunc;
+}
+
+CynicScript::CompileServer::CompiledProgram CompileForServer(std::string_view path, const SOURCE_STRING *source, bool isStringTableCompressed)
+{
+	uint64_t warningCount = CynicScript::Logger::Record::mWarningCount;
+	CynicScript::FunctionObject *mainFunc = nullptr;
+	if (source)
+	{
+		// the content the server hashed,not the file as it is now
+		SOURCE_STRING_VIEW content = *source;
+		if (content.starts_with(UTF8_BOM))
+			content.remove_prefix(UTF8_BOM.size());
+		CynicScript::Logger::RecordFilePath(path);
+		mainFunc = Compile(gLexer->ScanTokens(content));
+	}
+	else
+		mainFunc = Compile(gLexer->ScanFile(path)); // reports the file can't be read
+	// like the bytecode cache,warnings would not be reported again when the program is served from memory
+	return {CynicScript::BytecodeCache::Serialize(mainFunc, 0, 0, isStringTableCompressed), warningCount == CynicScript::Logger::Record::mWarningCount};
+}
+
+void RunForServer(std::span<const uint8_t> image, std::string_view path)
+{
+	CynicScript::ModuleManager::GetInstance()->SetSearchDirectory(std::filesystem::path(path).parent_path().string());
+	gVm->Run(gBytecodeCache->LoadImage(image, path));
+}
+
+int32_t RunOnServer()
+{
+	if (gConfig.isSerializeBinaryChunk)
+	{
+		std::vector<uint8_t> image;
+		auto status = CynicScript::CompileServer::RequestImage(gConfig.connectSocketPath, gConfig.sourceFilePath, gConfig.isCompressBinaryChunk, image);
+		if (status == EXIT_SUCCESS)
+			CynicScript::WriteBinaryFile(gConfig.serializeBinaryFilePath, image);
+		return status;
+	}
+	return CynicScript::CompileServer::RequestRun(gConfig.connectSocketPath, gConfig.sourceFilePath);
 }
 
 int32_t ParseArgs(int32_t argc, const char *argv[])
@@ -131,6 +262,89 @@ int32_t ParseArgs(int32_t argc, const char *argv[])
 				return PrintUsage();
 		}
 
+		if (strcmp(argv[i], "--compress") == 0)
+			gConfig.isCompressBinaryChunk = true;
+
+		if (strcmp(argv[i], "--cache-dir") == 0)
+		{
+			if (i + 1 < argc)
+				gConfig.bytecodeCacheDirectory = argv[++i];
+			else
+				return PrintUsage();
+		}
+
+		if (strcmp(argv[i], "--no-cache") == 0)
+			gConfig.isBytecodeCacheEnabled = false;
+
+		if (strcmp(argv[i], "--heap-snapshot") == 0)
+		{
+			if (i + 1 < argc)
+				gConfig.heapSnapshotPath = argv[++i];
+			else
+				return PrintUsage();
+		}
+
+		if (strcmp(argv[i], "--serve") == 0)
+		{
+			if (i + 1 < argc)
+				gConfig.serveSocketPath = argv[++i];
+			else
+				return PrintUsage();
+		}
+
+		if (strcmp(argv[i], "--connect") == 0)
+		{
+			if (i + 1 < argc)
+				gConfig.connectSocketPath = argv[++i];
+			else
+				return PrintUsage();
+		}
+
+		if (strcmp(argv[i], "--image") == 0)
+		{
+			if (i + 1 < argc)
+				gConfig.heapImagePath = argv[++i];
+			else
+				return PrintUsage();
+		}
+
+		if (strcmp(argv[i], "--save-image") == 0)
+		{
+			if (i + 1 < argc)
+				gConfig.saveHeapImagePath = argv[++i];
+			else
+				return PrintUsage();
+		}
+
+		if (strcmp(argv[i], "--heap-diff") == 0)
+		{
+			if (i + 2 < argc)
+			{
+				gConfig.heapDiffBeforePath = argv[++i];
+				gConfig.heapDiffAfterPath = argv[++i];
+			}
+			else
+				return PrintUsage();
+		}
+
+#ifdef CYS_HEAP_PROFILE
+		if (strcmp(argv[i], "--heap-profile") == 0)
+		{
+			if (i + 1 < argc)
+				gConfig.heapProfilePath = argv[++i];
+			else
+				return PrintUsage();
+		}
+
+		if (strcmp(argv[i], "--heap-profile-interval") == 0)
+		{
+			if (i + 1 < argc)
+				CynicScript::HeapProfiler::GetInstance()->SetSampleInterval(std::strtoull(argv[++i], nullptr, 10));
+			else
+				return PrintUsage();
+		}
+#endif
+
 		if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0)
 			return PrintUsage();
 
@@ -145,31 +359,93 @@ int32_t main(int32_t argc, const char *argv[])
 {
 #if defined(_WIN32) || defined(_WIN64)
 	system("chcp 65001");
+#elif defined(CYS_UTF8_ENCODE)
+	std::setlocale(LC_CTYPE, "C.UTF-8"); // the wide console streams convert through the c locale,make it utf-8
 #endif
 	if (ParseArgs(argc, argv) == EXIT_FAILURE)
 		return EXIT_FAILURE;
 
+	if (!gConfig.heapDiffBeforePath.empty())
+	{
+		auto before = CynicScript::HeapSnapshot::Load(gConfig.heapDiffBeforePath);
+		auto after = CynicScript::HeapSnapshot::Load(gConfig.heapDiffAfterPath);
+		CynicScript::Logger::Print(TEXT("{}"), CynicScript::HeapSnapshot::Diff(before, after));
+		return EXIT_SUCCESS;
+	}
+
+	// the client does no work of its own,the server is already warmed up
+	if (!gConfig.connectSocketPath.empty())
+	{
+		if (gConfig.sourceFilePath.empty() || gConfig.sourceFilePath.ends_with(CYS_BINARY_FILE_EXTENSION))
+			return PrintUsage();
+		return RunOnServer();
+	}
+
 	gLexer = new CynicScript::Lexer();
 	gParser = new CynicScript::Parser();
 	gAstOptimizePassManager = new CynicScript::AstOptimizePassManager();
 	gCompiler = new CynicScript::Compiler();
 	gVm = new CynicScript::VM();
+	gBytecodeCache = new CynicScript::BytecodeCache();
+	gModuleBytecodeCache = new CynicScript::BytecodeCache();
+	gModuleCompiler = new CynicScript::Compiler();
+
+	if (!gConfig.bytecodeCacheDirectory.empty())
+	{
+		gBytecodeCache->SetDirectory(gConfig.bytecodeCacheDirectory);
+		gModuleBytecodeCache->SetDirectory(gConfig.bytecodeCacheDirectory);
+	}
+
+	CynicScript::ModuleManager::GetInstance()->SetLoader(LoadModule);
+	if (!gConfig.sourceFilePath.empty())
+		CynicScript::ModuleManager::GetInstance()->SetSearchDirectory(std::filesystem::path(gConfig.sourceFilePath).parent_path().string());
 
 	gAstOptimizePassManager
 		->Add<CynicScript::ConstantFoldPass>()
 		->Add<CynicScript::SyntaxCheckPass>()
 		->Add<CynicScript::TypeCheckAndResolvePass>();
 
-	if (!gConfig.sourceFilePath.empty())
+	// globals of a binary file are not named,an image could not be used by anything
+	if (!gConfig.saveHeapImagePath.empty() && gConfig.sourceFilePath.ends_with(CYS_BINARY_FILE_EXTENSION))
+		return PrintUsage();
+
+	if (!gConfig.heapImagePath.empty())
+	{
+		gHeapImage = new CynicScript::HeapImage();
+		gCompiler->RestoreGlobalSymbols(gHeapImage->Load(gConfig.heapImagePath));
+	}
+
+	if (!gConfig.serveSocketPath.empty())
+	{
+		CynicScript::LibraryManager::GetInstance();
+		CynicScript::CompileServer server(CompileForServer, RunForServer);
+		server.Serve(gConfig.serveSocketPath);
+	}
+	else if (!gConfig.sourceFilePath.empty())
 		RunFile(gConfig.sourceFilePath);
 	else
 		Repl();
 
+	if (!gConfig.saveHeapImagePath.empty())
+		CynicScript::HeapImage::Save(gConfig.saveHeapImagePath, gCompiler->GetGlobalSymbols());
+
+	if (!gConfig.heapSnapshotPath.empty())
+		CynicScript::HeapSnapshot::Capture().Save(gConfig.heapSnapshotPath);
+
+#ifdef CYS_HEAP_PROFILE
+	if (!gConfig.heapProfilePath.empty())
+		CynicScript::HeapProfiler::GetInstance()->WriteReports(gConfig.heapProfilePath);
+#endif
+
 	SAFE_DELETE(gLexer);
 	SAFE_DELETE(gParser);
 	SAFE_DELETE(gAstOptimizePassManager);
 	SAFE_DELETE(gCompiler);
 	SAFE_DELETE(gVm);
+	SAFE_DELETE(gBytecodeCache);
+	SAFE_DELETE(gModuleBytecodeCache);
+	SAFE_DELETE(gModuleCompiler);
+	SAFE_DELETE(gHeapImage);
 
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
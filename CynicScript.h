@@ -12,4 +12,11 @@
 #include "TypeCheckAndResolvePass.h"
 #include "SyntaxCheckPass.h"
 #include "Compiler.h"
-#include "VM.h"
\ No newline at end of file
+#include "VM.h"
+#include "Allocator.h"
+#include "BytecodeCache.h"
+#include "CompileServer.h"
+#include "HeapProfiler.h"
+#include "HeapSnapshot.h"
+#include "HeapImage.h"
+#include "ModuleManager.h"
\ No newline at end of file
@@ -0,0 +1,734 @@
+#include "HeapImage.h"
+#include <unordered_map>
+#include <unordered_set>
+#include "Version.h"
+#include "Allocator.h"
+#include "LibraryManager.h"
+#include "Logger.h"
+
+namespace CynicScript
+{
+#define HEAP_IMAGE_EXTERNAL 0xFF
+
+    enum class HeapImageRefKind : uint8_t
+    {
+        GLOBAL,
+        UPVALUE,
+        ARRAY_ELEMENT,
+        DICT_ELEMENT,
+    };
+
+    namespace
+    {
+        struct ExternalObject
+        {
+            uint32_t library;
+            STRING member; // empty for the library class itself
+        };
+
+        // where a ref points into,see WriteRefTarget()
+        struct RefTarget
+        {
+            HeapImageRefKind kind;
+            Object *object;
+            const Value *key{nullptr}; // of a dict element
+        };
+
+        // assigns the object indices and writes the objects in that order
+        class HeapImageWriter
+        {
+        public:
+            HeapImageWriter(BytecodeWriter &writer, const Value *globals)
+                : mWriter(writer), mGlobals(globals)
+            {
+                const auto &libraries = LibraryManager::GetInstance()->GetLibraries();
+                for (uint32_t i = 0; i < libraries.size(); ++i)
+                {
+                    mExternals.try_emplace(libraries[i], ExternalObject{i, STRING()});
+                    // members of a library that was never loaded can't be reached
+                    for (const auto &[name, member] : libraries[i]->members)
+                        if (CYS_IS_OBJECT_VALUE(member))
+                            mExternals.try_emplace(member.object, ExternalObject{i, name});
+                }
+            }
+
+            void AddRoot(const Value &value)
+            {
+                Visit(value);
+            }
+
+            void WriteObjects()
+            {
+                // the list grows while objects are traced
+                for (size_t i = 0; i < mObjects.size(); ++i)
+                    Trace(mObjects[i]);
+
+                mWriter.WriteVarUint(mObjects.size());
+                for (const auto object : mObjects)
+                {
+                    auto iter = mExternals.find(object);
+                    if (iter != mExternals.end())
+                    {
+                        mWriter.WriteU8(HEAP_IMAGE_EXTERNAL);
+                        mWriter.WriteVarUint(iter->second.library);
+                        mWriter.WriteString(StringToSource(iter->second.member));
+                    }
+                    else
+                    {
+                        mWriter.WriteU8(object->kind);
+                        // read along with the kind,so a name is looked up in the intern table before anything refers to it
+                        if (CYS_IS_STR_OBJ(object))
+                        {
+                            mWriter.WriteU8(Allocator::GetInstance()->IsInterned(CYS_TO_STR_OBJ(object)) ? 1 : 0);
+                            mWriter.WriteString(StringToSource(CYS_TO_STR_OBJ(object)->value));
+                        }
+                    }
+                }
+
+                // refs point into the other objects,so those are complete by the time refs are read
+                for (const auto object : mObjects)
+                    if (!mExternals.contains(object) && !CYS_IS_STR_OBJ(object) && !CYS_IS_REF_OBJ(object))
+                        WriteFields(object);
+                for (const auto object : mObjects)
+                    if (!mExternals.contains(object) && CYS_IS_REF_OBJ(object))
+                        WriteFields(object);
+            }
+
+            void WriteValue(const Value &value)
+            {
+                mWriter.WriteU8(value.kind | (static_cast<uint8_t>(value.permission) << 4));
+                if (CYS_IS_BOOL_VALUE(value))
+                    mWriter.WriteU8(value.boolean ? 1 : 0);
+                else if (CYS_IS_INT_VALUE(value))
+                    mWriter.WriteVarInt(value.integer);
+                else if (CYS_IS_REAL_VALUE(value))
+                    mWriter.WriteU64(value.integer);
+                else if (CYS_IS_OBJECT_VALUE(value))
+                    WriteObject(value.object);
+            }
+
+        private:
+            void Visit(const Value &value)
+            {
+                if (CYS_IS_OBJECT_VALUE(value))
+                    Visit(value.object);
+            }
+
+            void Visit(Object *object)
+            {
+                if (object && mIndices.try_emplace(object, static_cast<uint32_t>(mObjects.size())).second)
+                    mObjects.emplace_back(object);
+            }
+
+            void Trace(Object *object)
+            {
+                if (mExternals.contains(object))
+                    return;
+
+                switch (object->kind)
+                {
+                case ObjectKind::ARRAY:
+                    for (const auto &element : CYS_TO_ARRAY_OBJ(object)->elements)
+                        Visit(element);
+                    break;
+                case ObjectKind::DICT:
+                    for (const auto &[key, value] : CYS_TO_TABLE_OBJ(object)->elements)
+                    {
+                        Visit(key);
+                        Visit(value);
+                    }
+                    break;
+                case ObjectKind::STRUCT:
+                    for (const auto &[name, value] : CYS_TO_STRUCT_OBJ(object)->elements)
+                        Visit(value);
+                    break;
+                case ObjectKind::UPVALUE:
+                    Visit(*CYS_TO_UPVALUE_OBJ(object)->location);
+                    break;
+                case ObjectKind::CLOSURE:
+                    Visit(CYS_TO_CLOSURE_OBJ(object)->function);
+                    for (const auto upvalue : CYS_TO_CLOSURE_OBJ(object)->upvalues)
+                        Visit(upvalue);
+                    break;
+                case ObjectKind::NATIVE_FUNCTION:
+                    CYS_LOG_ERROR(TEXT("Cannot store a native function that is not a library member into a heap image"));
+                    break;
+                case ObjectKind::CLASS:
+                {
+                    auto classObj = CYS_TO_CLASS_OBJ(object);
+                    for (const auto &[argCount, constructor] : classObj->constructors)
+                        Visit(constructor);
+                    for (const auto &[name, member] : classObj->members)
+                        Visit(member);
+                    for (const auto &[name, parent] : classObj->parents)
+                        Visit(parent);
+                    break;
+                }
+                case ObjectKind::CLASS_CLOSURE_BIND:
+                    Visit(CYS_TO_CLASS_CLOSURE_BIND_OBJ(object)->receiver);
+                    Visit(CYS_TO_CLASS_CLOSURE_BIND_OBJ(object)->closure);
+                    break;
+                case ObjectKind::ENUM:
+                    for (const auto &[name, value] : CYS_TO_ENUM_OBJ(object)->pairs)
+                        Visit(value);
+                    break;
+                case ObjectKind::MODULE:
+                    for (const auto &[name, value] : CYS_TO_MODULE_OBJ(object)->values)
+                        Visit(value);
+                    break;
+                default: // strings and functions refer to nothing on the heap,weak refs and refs don't keep their targets
+                    break;
+                }
+            }
+
+            void WriteObject(Object *object)
+            {
+                mWriter.WriteVarUint(mIndices.at(object));
+            }
+
+            // a weak ref only keeps its target if something else stored it
+            void WriteWeakTarget(Object *target)
+            {
+                auto iter = target ? mIndices.find(target) : mIndices.end();
+                mWriter.WriteVarUint(iter == mIndices.end() ? 0 : iter->second + 1);
+            }
+
+            void WriteRefTarget(const Value *pointer)
+            {
+                if (pointer >= mGlobals && pointer < mGlobals + GLOBAL_VARIABLE_MAX)
+                {
+                    mWriter.WriteU8(static_cast<uint8_t>(HeapImageRefKind::GLOBAL));
+                    mWriter.WriteVarUint(pointer - mGlobals);
+                    return;
+                }
+
+                if (mRefTargets.empty())
+                    CollectRefTargets();
+
+                auto iter = mRefTargets.find(pointer);
+                if (iter == mRefTargets.end())
+                    CYS_LOG_ERROR(TEXT("Cannot store a reference to a value outside of the globals and the stored objects into a heap image"));
+
+                const auto &target = iter->second;
+                mWriter.WriteU8(static_cast<uint8_t>(target.kind));
+                WriteObject(target.object);
+                if (target.kind == HeapImageRefKind::ARRAY_ELEMENT)
+                    mWriter.WriteVarUint(pointer - CYS_TO_ARRAY_OBJ(target.object)->elements.data());
+                else if (target.kind == HeapImageRefKind::DICT_ELEMENT)
+                    WriteValue(*target.key);
+            }
+
+            // every value a ref could point to in the stored objects,collected once when the first ref is written
+            void CollectRefTargets()
+            {
+                for (const auto object : mObjects)
+                {
+                    if (mExternals.contains(object))
+                        continue;
+
+                    if (CYS_IS_UPVALUE_OBJ(object))
+                        mRefTargets.try_emplace(CYS_TO_UPVALUE_OBJ(object)->location, RefTarget{HeapImageRefKind::UPVALUE, object});
+                    else if (CYS_IS_ARRAY_OBJ(object))
+                    {
+                        for (const auto &element : CYS_TO_ARRAY_OBJ(object)->elements)
+                            mRefTargets.try_emplace(&element, RefTarget{HeapImageRefKind::ARRAY_ELEMENT, object});
+                    }
+                    else if (CYS_IS_TABLE_OBJ(object))
+                    {
+                        for (const auto &[key, value] : CYS_TO_TABLE_OBJ(object)->elements)
+                            mRefTargets.try_emplace(&value, RefTarget{HeapImageRefKind::DICT_ELEMENT, object, &key});
+                    }
+                }
+            }
+
+            void WriteFields(Object *object)
+            {
+                switch (object->kind)
+                {
+                case ObjectKind::ARRAY:
+                {
+                    const auto &elements = CYS_TO_ARRAY_OBJ(object)->elements;
+                    mWriter.WriteVarUint(elements.size());
+                    for (const auto &element : elements)
+                        WriteValue(element);
+                    break;
+                }
+                case ObjectKind::DICT:
+                {
+                    auto dict = CYS_TO_TABLE_OBJ(object);
+                    mWriter.WriteU8(dict->weakKeys ? 1 : 0);
+                    mWriter.WriteVarUint(dict->elements.size());
+                    for (const auto &[key, value] : dict->elements)
+                    {
+                        WriteValue(key);
+                        WriteValue(value);
+                    }
+                    break;
+                }
+                case ObjectKind::STRUCT:
+                {
+                    const auto &elements = CYS_TO_STRUCT_OBJ(object)->elements;
+                    mWriter.WriteVarUint(elements.size());
+                    for (const auto &[name, value] : elements)
+                    {
+                        mWriter.WriteString(StringToSource(name));
+                        WriteValue(value);
+                    }
+                    break;
+                }
+                case ObjectKind::FUNCTION:
+                    CYS_TO_FUNCTION_OBJ(object)->Serialize(mWriter);
+                    break;
+                case ObjectKind::UPVALUE:
+                    // every upvalue is closed once the run is over,the value is stored in any case
+                    WriteValue(*CYS_TO_UPVALUE_OBJ(object)->location);
+                    break;
+                case ObjectKind::CLOSURE:
+                {
+                    auto closure = CYS_TO_CLOSURE_OBJ(object);
+                    WriteObject(closure->function);
+                    mWriter.WriteVarUint(closure->upvalues.size());
+                    for (const auto upvalue : closure->upvalues)
+                        WriteObject(upvalue);
+                    break;
+                }
+                case ObjectKind::REF:
+                    WriteRefTarget(CYS_TO_REF_OBJ(object)->pointer);
+                    break;
+                case ObjectKind::CLASS:
+                {
+                    auto classObj = CYS_TO_CLASS_OBJ(object);
+                    mWriter.WriteString(StringToSource(classObj->name));
+                    mWriter.WriteVarUint(classObj->constructors.size());
+                    for (const auto &[argCount, constructor] : classObj->constructors)
+                    {
+                        mWriter.WriteVarInt(argCount);
+                        WriteObject(constructor);
+                    }
+                    mWriter.WriteVarUint(classObj->members.size());
+                    for (const auto &[name, member] : classObj->members)
+                    {
+                        mWriter.WriteString(StringToSource(name));
+                        WriteValue(member);
+                    }
+                    mWriter.WriteVarUint(classObj->parents.size());
+                    for (const auto &[name, parent] : classObj->parents)
+                    {
+                        mWriter.WriteString(StringToSource(name));
+                        WriteObject(parent);
+                    }
+                    break;
+                }
+                case ObjectKind::CLASS_CLOSURE_BIND:
+                    WriteValue(CYS_TO_CLASS_CLOSURE_BIND_OBJ(object)->receiver);
+                    WriteObject(CYS_TO_CLASS_CLOSURE_BIND_OBJ(object)->closure);
+                    break;
+                case ObjectKind::ENUM:
+                case ObjectKind::MODULE:
+                {
+                    const auto &name = CYS_IS_ENUM_OBJ(object) ? CYS_TO_ENUM_OBJ(object)->name : CYS_TO_MODULE_OBJ(object)->name;
+                    const auto &values = CYS_IS_ENUM_OBJ(object) ? CYS_TO_ENUM_OBJ(object)->pairs : CYS_TO_MODULE_OBJ(object)->values;
+                    mWriter.WriteString(StringToSource(name));
+                    mWriter.WriteVarUint(values.size());
+                    for (const auto &[key, value] : values)
+                    {
+                        mWriter.WriteString(StringToSource(key));
+                        WriteValue(value);
+                    }
+                    break;
+                }
+                case ObjectKind::WEAK_REF:
+                    WriteWeakTarget(CYS_TO_WEAK_REF_OBJ(object)->target);
+                    break;
+                default:
+                    break;
+                }
+            }
+
+            BytecodeWriter &mWriter;
+            const Value *mGlobals;
+            std::unordered_map<Object *, ExternalObject> mExternals;
+            std::unordered_map<Object *, uint32_t> mIndices;
+            std::vector<Object *> mObjects;
+            std::unordered_map<const Value *, RefTarget> mRefTargets;
+        };
+
+        class HeapImageReader
+        {
+        public:
+            HeapImageReader(const BytecodeImage &image, size_t &offset)
+                : mImage(image), mOffset(offset)
+            {
+            }
+
+            void ReadObjects()
+            {
+                auto count = mImage.ReadVarUint(mOffset);
+                mObjects.reserve(count);
+                for (uint64_t i = 0; i < count; ++i)
+                    mObjects.emplace_back(CreateObject());
+
+                for (const auto object : mObjects)
+                    if (!mExternals.contains(object) && !CYS_IS_STR_OBJ(object) && !CYS_IS_REF_OBJ(object))
+                        ReadFields(object);
+                for (const auto object : mObjects)
+                    if (!mExternals.contains(object) && CYS_IS_REF_OBJ(object))
+                        ReadFields(object);
+            }
+
+            Value ReadValue()
+            {
+                Value value;
+                auto kindAndPermission = mImage.ReadU8(mOffset);
+                value.kind = static_cast<ValueKind>(kindAndPermission & 0x0F);
+                value.permission = static_cast<Permission>(kindAndPermission >> 4);
+                if (CYS_IS_BOOL_VALUE(value))
+                    value.boolean = mImage.ReadU8(mOffset) != 0;
+                else if (CYS_IS_INT_VALUE(value))
+                    value.integer = mImage.ReadVarInt(mOffset);
+                else if (CYS_IS_REAL_VALUE(value))
+                    value.integer = mImage.ReadU64(mOffset);
+                else if (CYS_IS_OBJECT_VALUE(value))
+                    value.object = ReadObject();
+                else if (!CYS_IS_NULL_VALUE(value))
+                    CYS_LOG_ERROR(TEXT("Invalid heap image,unknown value kind {}"), static_cast<uint32_t>(value.kind));
+                return value;
+            }
+
+        private:
+            template <class T>
+            T *ReadObjectOf(ObjectKind kind)
+            {
+                auto object = ReadObject();
+                if (object->kind != kind)
+                    CYS_LOG_ERROR(TEXT("Invalid heap image,expect {} but got {}"), ObjectKindToString(kind), ObjectKindToString(static_cast<ObjectKind>(object->kind)));
+                return static_cast<T *>(object);
+            }
+
+            Object *ReadObject()
+            {
+                auto index = mImage.ReadVarUint(mOffset);
+                if (index >= mObjects.size())
+                    CYS_LOG_ERROR(TEXT("Invalid heap image,object index {} out of range {}"), index, mObjects.size());
+                return mObjects[index];
+            }
+
+            STRING ReadName()
+            {
+                return SourceToString(mImage.ReadString(mOffset));
+            }
+
+            Object *CreateObject()
+            {
+                auto allocator = Allocator::GetInstance();
+                auto kind = mImage.ReadU8(mOffset);
+                switch (kind)
+                {
+                case ObjectKind::STR:
+                {
+                    // a name is the same object as equal names compiled later,other strings may be changed in place
+                    auto isInterned = mImage.ReadU8(mOffset) != 0;
+                    return isInterned ? allocator->InternStr(ReadName()) : allocator->CreateObject<StrObject>(ReadName());
+                }
+                case ObjectKind::ARRAY:
+                    return allocator->CreateObject<ArrayObject>();
+                case ObjectKind::DICT:
+                    return allocator->CreateObject<DictObject>();
+                case ObjectKind::STRUCT:
+                    return allocator->CreateObject<StructObject>();
+                case ObjectKind::FUNCTION:
+                    return new FunctionObject(); // outside the gc like functions loaded from bytecode files
+                case ObjectKind::UPVALUE:
+                    return allocator->CreateObject<UpValueObject>();
+                case ObjectKind::CLOSURE:
+                    return allocator->CreateObject<ClosureObject>();
+                case ObjectKind::REF:
+                    return allocator->CreateObject<RefObject>(nullptr);
+                case ObjectKind::CLASS:
+                    return allocator->CreateObject<ClassObject>();
+                case ObjectKind::CLASS_CLOSURE_BIND:
+                    return allocator->CreateObject<ClassClosureBindObject>();
+                case ObjectKind::ENUM:
+                    return allocator->CreateObject<EnumObject>();
+                case ObjectKind::MODULE:
+                    return allocator->CreateObject<ModuleObject>();
+                case ObjectKind::WEAK_REF:
+                    return allocator->CreateObject<WeakRefObject>();
+                case HEAP_IMAGE_EXTERNAL:
+                {
+                    const auto &libraries = LibraryManager::GetInstance()->GetLibraries();
+                    auto library = mImage.ReadVarUint(mOffset);
+                    auto member = ReadName();
+                    if (library >= libraries.size())
+                        CYS_LOG_ERROR(TEXT("Invalid heap image,library index {} out of range {}"), library, libraries.size());
+
+                    Object *object = libraries[library];
+                    if (!member.empty())
+                    {
+                        libraries[library]->LoadMembers();
+                        auto iter = libraries[library]->members.find(member);
+                        if (iter == libraries[library]->members.end() || !CYS_IS_OBJECT_VALUE(iter->second))
+                            CYS_LOG_ERROR(TEXT("Heap image refers to {}.{},which the library doesn't have"), libraries[library]->name, member);
+                        object = iter->second.object;
+                    }
+                    mExternals.emplace(object);
+                    return object;
+                }
+                default:
+                    CYS_LOG_ERROR(TEXT("Invalid heap image,unknown object kind {}"), kind);
+                    return nullptr;
+                }
+            }
+
+            Value *ReadRefTarget()
+            {
+                auto kind = static_cast<HeapImageRefKind>(mImage.ReadU8(mOffset));
+                switch (kind)
+                {
+                case HeapImageRefKind::GLOBAL:
+                {
+                    auto index = mImage.ReadVarUint(mOffset);
+                    if (index >= GLOBAL_VARIABLE_MAX)
+                        CYS_LOG_ERROR(TEXT("Invalid heap image,global index {} out of range"), index);
+                    return GET_GLOBAL_VARIABLE(index);
+                }
+                case HeapImageRefKind::UPVALUE:
+                    return ReadObjectOf<UpValueObject>(ObjectKind::UPVALUE)->location;
+                case HeapImageRefKind::ARRAY_ELEMENT:
+                {
+                    auto array = ReadObjectOf<ArrayObject>(ObjectKind::ARRAY);
+                    auto index = mImage.ReadVarUint(mOffset);
+                    if (index >= array->elements.size())
+                        CYS_LOG_ERROR(TEXT("Invalid heap image,element index {} out of range {}"), index, array->elements.size());
+                    return &array->elements[index];
+                }
+                case HeapImageRefKind::DICT_ELEMENT:
+                {
+                    auto dict = ReadObjectOf<DictObject>(ObjectKind::DICT);
+                    return &dict->elements[ReadValue()];
+                }
+                default:
+                    CYS_LOG_ERROR(TEXT("Invalid heap image,unknown reference kind {}"), static_cast<uint32_t>(kind));
+                    return nullptr;
+                }
+            }
+
+            void ReadFields(Object *object)
+            {
+                switch (object->kind)
+                {
+                case ObjectKind::ARRAY:
+                {
+                    auto &elements = CYS_TO_ARRAY_OBJ(object)->elements;
+                    auto count = mImage.ReadVarUint(mOffset);
+                    elements.resize(count);
+                    for (auto &element : elements)
+                        element = ReadValue();
+                    break;
+                }
+                case ObjectKind::DICT:
+                {
+                    auto dict = CYS_TO_TABLE_OBJ(object);
+                    dict->weakKeys = mImage.ReadU8(mOffset) != 0;
+                    auto count = mImage.ReadVarUint(mOffset);
+                    for (uint64_t i = 0; i < count; ++i)
+                    {
+                        auto key = ReadValue();
+                        dict->elements[key] = ReadValue();
+                    }
+                    break;
+                }
+                case ObjectKind::STRUCT:
+                {
+                    auto count = mImage.ReadVarUint(mOffset);
+                    for (uint64_t i = 0; i < count; ++i)
+                    {
+                        auto name = ReadName();
+                        CYS_TO_STRUCT_OBJ(object)->elements[name] = ReadValue();
+                    }
+                    break;
+                }
+                case ObjectKind::FUNCTION:
+                    CYS_TO_FUNCTION_OBJ(object)->Deserialize(mImage, mOffset);
+                    break;
+                case ObjectKind::UPVALUE:
+                {
+                    auto upvalue = CYS_TO_UPVALUE_OBJ(object);
+                    upvalue->closed = ReadValue();
+                    upvalue->location = &upvalue->closed;
+                    break;
+                }
+                case ObjectKind::CLOSURE:
+                {
+                    auto closure = CYS_TO_CLOSURE_OBJ(object);
+                    closure->function = ReadObjectOf<FunctionObject>(ObjectKind::FUNCTION);
+                    closure->upvalues.resize(mImage.ReadVarUint(mOffset));
+                    for (auto &upvalue : closure->upvalues)
+                        upvalue = ReadObjectOf<UpValueObject>(ObjectKind::UPVALUE);
+                    break;
+                }
+                case ObjectKind::REF:
+                    CYS_TO_REF_OBJ(object)->pointer = ReadRefTarget();
+                    break;
+                case ObjectKind::CLASS:
+                {
+                    auto classObj = CYS_TO_CLASS_OBJ(object);
+                    classObj->name = ReadName();
+                    auto count = mImage.ReadVarUint(mOffset);
+                    for (uint64_t i = 0; i < count; ++i)
+                    {
+                        auto argCount = static_cast<int32_t>(mImage.ReadVarInt(mOffset));
+                        classObj->constructors[argCount] = ReadObjectOf<ClosureObject>(ObjectKind::CLOSURE);
+                    }
+                    count = mImage.ReadVarUint(mOffset);
+                    for (uint64_t i = 0; i < count; ++i)
+                    {
+                        auto name = ReadName();
+                        classObj->members[name] = ReadValue();
+                    }
+                    count = mImage.ReadVarUint(mOffset);
+                    for (uint64_t i = 0; i < count; ++i)
+                    {
+                        auto name = ReadName();
+                        classObj->parents[name] = ReadObjectOf<ClassObject>(ObjectKind::CLASS);
+                    }
+                    break;
+                }
+                case ObjectKind::CLASS_CLOSURE_BIND:
+                    CYS_TO_CLASS_CLOSURE_BIND_OBJ(object)->receiver = ReadValue();
+                    CYS_TO_CLASS_CLOSURE_BIND_OBJ(object)->closure = ReadObjectOf<ClosureObject>(ObjectKind::CLOSURE);
+                    break;
+                case ObjectKind::ENUM:
+                case ObjectKind::MODULE:
+                {
+                    auto &name = CYS_IS_ENUM_OBJ(object) ? CYS_TO_ENUM_OBJ(object)->name : CYS_TO_MODULE_OBJ(object)->name;
+                    auto &values = CYS_IS_ENUM_OBJ(object) ? CYS_TO_ENUM_OBJ(object)->pairs : CYS_TO_MODULE_OBJ(object)->values;
+                    name = ReadName();
+                    auto count = mImage.ReadVarUint(mOffset);
+                    for (uint64_t i = 0; i < count; ++i)
+                    {
+                        auto key = ReadName();
+                        values[key] = ReadValue();
+                    }
+                    break;
+                }
+                case ObjectKind::WEAK_REF:
+                {
+                    auto index = mImage.ReadVarUint(mOffset);
+                    if (index > mObjects.size())
+                        CYS_LOG_ERROR(TEXT("Invalid heap image,object index {} out of range {}"), index - 1, mObjects.size());
+                    CYS_TO_WEAK_REF_OBJ(object)->target = index == 0 ? nullptr : mObjects[index - 1];
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+
+            const BytecodeImage &mImage;
+            size_t &mOffset;
+            std::vector<Object *> mObjects;
+            std::unordered_set<Object *> mExternals;
+        };
+    }
+
+    void HeapImage::Save(std::string_view path, const std::vector<GlobalSymbol> &symbols)
+    {
+        auto libraryCount = LibraryManager::GetInstance()->GetLibraries().size();
+
+        BytecodeWriter writer(0, 0, false, BYTECODE_FLAG_HEAP_IMAGE);
+        HeapImageWriter heapWriter(writer, Allocator::GetInstance()->mGlobalVariableList);
+        auto allocator = Allocator::GetInstance();
+        for (size_t i = libraryCount; i < symbols.size(); ++i)
+            heapWriter.AddRoot(*GET_GLOBAL_VARIABLE(i));
+        for (const auto &[importPath, moduleObj] : allocator->mImportedModules)
+            heapWriter.AddRoot(moduleObj);
+        heapWriter.WriteObjects();
+
+        writer.WriteVarUint(symbols.size());
+        for (const auto &symbol : symbols)
+        {
+            writer.WriteString(StringToSource(symbol.name));
+            writer.WriteU8(static_cast<uint8_t>(symbol.permission));
+            writer.WriteVarInt(symbol.paramCount);
+            writer.WriteU8(static_cast<uint8_t>(symbol.varArg));
+            writer.WriteString(StringToSource(symbol.importPath));
+        }
+        for (size_t i = libraryCount; i < symbols.size(); ++i)
+            heapWriter.WriteValue(*GET_GLOBAL_VARIABLE(i));
+
+        // an import of a file imported during the saved run gets the module it left behind instead of running the file again
+        writer.WriteVarUint(allocator->mImportedModules.size());
+        for (const auto &[importPath, moduleObj] : allocator->mImportedModules)
+        {
+            writer.WriteString(importPath);
+            heapWriter.WriteValue(moduleObj);
+        }
+
+        WriteBinaryFile(path, writer.Finish());
+    }
+
+    std::vector<GlobalSymbol> HeapImage::Load(std::string_view path)
+    {
+        if (!mImage.Open(path))
+            CYS_LOG_ERROR(TEXT("Failed to open heap image:{}"), SourceToString(path));
+
+        const auto &header = mImage.GetHeader();
+        if (header.magicNumber != CYS_BINARY_FILE_MAGIC_NUMBER || !(header.flags & BYTECODE_FLAG_HEAP_IMAGE))
+            CYS_LOG_ERROR(TEXT("Not a heap image:{}"), SourceToString(path));
+        if (header.version != CYS_VERSION_BINARY || header.formatVersion != CYS_BINARY_FORMAT_VERSION)
+            CYS_LOG_ERROR(TEXT("Heap image {} was made by another version of the interpreter"), SourceToString(path));
+        if (header.imageSize != mImage.GetSize())
+            CYS_LOG_ERROR(TEXT("Truncated heap image:{},expect {} bytes but got {}"), SourceToString(path), header.imageSize, mImage.GetSize());
+        if (!mImage.IsIntact())
+            CYS_LOG_ERROR(TEXT("Corrupted heap image:{}"), SourceToString(path));
+
+        mImage.LoadStringTable();
+
+        // none of the objects is reachable before the globals are set
+        auto allocator = Allocator::GetInstance();
+        allocator->mIsGCPaused = true;
+
+        size_t offset = BYTECODE_HEADER_SIZE;
+        HeapImageReader reader(mImage, offset);
+        reader.ReadObjects();
+
+        auto symbolCount = mImage.ReadVarUint(offset);
+        if (symbolCount > GLOBAL_VARIABLE_MAX)
+            CYS_LOG_ERROR(TEXT("Invalid heap image,{} globals out of range {}"), symbolCount, GLOBAL_VARIABLE_MAX);
+
+        std::vector<GlobalSymbol> symbols(symbolCount);
+        for (auto &symbol : symbols)
+        {
+            symbol.name = SourceToString(mImage.ReadString(offset));
+            symbol.permission = static_cast<Permission>(mImage.ReadU8(offset));
+            symbol.paramCount = static_cast<int8_t>(mImage.ReadVarInt(offset));
+            symbol.varArg = static_cast<VarArg>(mImage.ReadU8(offset));
+            symbol.importPath = SourceToString(mImage.ReadString(offset));
+        }
+
+        // the library slots are not in the image,the values of the other globals follow them
+        const auto &libraries = LibraryManager::GetInstance()->GetLibraries();
+        if (symbols.size() < libraries.size())
+            CYS_LOG_ERROR(TEXT("Invalid heap image,{} globals but the interpreter has {} libraries"), symbols.size(), libraries.size());
+        for (size_t i = 0; i < libraries.size(); ++i)
+            if (symbols[i].name != libraries[i]->name)
+                CYS_LOG_ERROR(TEXT("Invalid heap image,global {} is {} instead of library {}"), i, symbols[i].name, libraries[i]->name);
+
+        for (size_t i = libraries.size(); i < symbols.size(); ++i)
+            allocator->SetGlobalVariable(i, reader.ReadValue());
+
+        auto importCount = mImage.ReadVarUint(offset);
+        for (uint64_t i = 0; i < importCount; ++i)
+        {
+            std::string importPath(mImage.ReadString(offset));
+            auto moduleValue = reader.ReadValue();
+            if (!CYS_IS_MODULE_VALUE(moduleValue))
+                CYS_LOG_ERROR(TEXT("Invalid heap image,the import of {} is not a module"), SourceToString(importPath));
+            allocator->SetImportedModule(importPath, CYS_TO_MODULE_VALUE(moduleValue));
+        }
+
+        allocator->mIsGCPaused = false;
+        return symbols;
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <string_view>
+#include "Compiler.h"
+#include "BytecodeImage.h"
+#include "Utils.h"
+
+namespace CynicScript
+{
+    // A heap image keeps the globals a run left behind together with every object reachable from them,so later
+    // processes start from that state instead of running the initialization again:loading decodes the objects
+    // once and links them up,function bodies are decoded from the file when first called like bytecode files.
+    //
+    // The file is a bytecode binary file flagged with BYTECODE_FLAG_HEAP_IMAGE,after the header:
+    //     varuint object count
+    //     per object:u8 kind followed by u8 interned and the content for a string(see Allocator::InternStr),
+    //     or HEAP_IMAGE_EXTERNAL followed by the varuint library index and the member name for an object owned by
+    //     a library(native functions can't be stored,they are looked up again)
+    //     per object that is neither a string nor external:its fields,objects referred to by index,refs come after the other objects
+    //     varuint global count,per global:name,u8 permission,varint parameter count,u8 var arg,import path(see GlobalSymbol)
+    //     per global past the libraries:its value
+    //     varuint imported file count,per imported file:absolute path and its module object(see Allocator::GetImportedModule)
+    class CYS_API HeapImage
+    {
+        NON_COPYABLE(HeapImage)
+    public:
+        HeapImage() = default;
+        ~HeapImage() = default;
+
+        // the globals named by symbols(see Compiler::GetGlobalSymbols()) and what they reach,errors are fatal
+        static void Save(std::string_view path, const std::vector<GlobalSymbol> &symbols);
+
+        // restore the objects and globals into the allocator and return the symbols to restore into the compiler.
+        // Functions are bound to the file,so the image has to outlive them.Errors are fatal
+        std::vector<GlobalSymbol> Load(std::string_view path);
+
+    private:
+        BytecodeImage mImage;
+    };
+}
@@ -0,0 +1,114 @@
+#include "HeapProfiler.h"
+#ifdef CYS_HEAP_PROFILE
+#include <algorithm>
+#include <vector>
+#include "Allocator.h"
+#include "Logger.h"
+
+namespace CynicScript
+{
+    SINGLETON_IMPL(HeapProfiler)
+
+    void HeapProfiler::SetSampleInterval(size_t bytes)
+    {
+        if (bytes == 0)
+            CYS_LOG_ERROR(TEXT("Heap profile sample interval must be greater than 0."));
+
+        mSampleInterval = bytes;
+        mBytesUntilNextSample = bytes;
+    }
+
+    size_t HeapProfiler::GetSampleInterval() const
+    {
+        return mSampleInterval;
+    }
+
+    void HeapProfiler::RecordAllocation(Object *object, size_t bytes)
+    {
+        if (bytes < mBytesUntilNextSample)
+        {
+            mBytesUntilNextSample -= bytes;
+            return;
+        }
+
+        // an allocation may cross more than one interval,each sample stands for mSampleInterval bytes
+        size_t sampleCount = 1 + (bytes - mBytesUntilNextSample) / mSampleInterval;
+        mBytesUntilNextSample = mSampleInterval - (bytes - mBytesUntilNextSample) % mSampleInterval;
+
+        size_t weight = sampleCount * mSampleInterval;
+
+        auto &site = mSites[CollectStack(object)];
+        site.totalBytes += weight;
+        site.totalCount++;
+        site.liveBytes += weight;
+        site.liveCount++;
+
+        mSampledObjects[object] = {&site, weight};
+    }
+
+    void HeapProfiler::RecordFree(Object *object)
+    {
+        auto iter = mSampledObjects.find(object);
+        if (iter == mSampledObjects.end())
+            return;
+
+        iter->second.site->liveBytes -= iter->second.bytes;
+        iter->second.site->liveCount--;
+        mSampledObjects.erase(iter);
+    }
+
+    STRING HeapProfiler::GetReport(bool live) const
+    {
+        std::vector<std::pair<STRING, size_t>> lines;
+        for (const auto &[stack, site] : mSites)
+        {
+            size_t bytes = live ? site.liveBytes : site.totalBytes;
+            if (bytes > 0)
+                lines.emplace_back(stack, bytes);
+        }
+
+        std::sort(lines.begin(), lines.end());
+
+        STRING result;
+        for (const auto &[stack, bytes] : lines)
+            result += stack + TEXT(" ") + CYS_TO_STRING(bytes) + TEXT("\n");
+        return result;
+    }
+
+    void HeapProfiler::WriteReports(std::string_view pathPrefix) const
+    {
+        for (bool live : {false, true})
+        {
+#ifdef CYS_UTF8_ENCODE
+            auto content = Utf8::Encode(GetReport(live));
+#else
+            auto content = GetReport(live);
+#endif
+            auto path = std::string(pathPrefix) + (live ? ".live.folded" : ".alloc.folded");
+            WriteBinaryFile(path, std::vector<uint8_t>(content.begin(), content.end()));
+        }
+    }
+
+    STRING HeapProfiler::CollectStack(const Object *object) const
+    {
+        STRING stack;
+        for (int32_t i = (int32_t)CALL_FRAME_COUNT() - 1; i >= 0; --i)
+        {
+            CallFrame *frame = PEEK_CALL_FRAME(i);
+            if (!stack.empty())
+                stack += TEXT(";");
+
+            stack += frame->closure->function->name;
+            if (frame->relatedToken)
+                stack += TEXT(":") + CYS_TO_STRING(frame->relatedToken->sourceLocation.line) + TEXT(":") + CYS_TO_STRING(frame->relatedToken->sourceLocation.column);
+        }
+
+        if (stack.empty())
+            stack = TEXT("<native>");
+
+        // the leaf frame is the kind of allocated object
+        stack += TEXT(";[") + STRING(ObjectKindToString((ObjectKind)object->kind)) + TEXT("]");
+        return stack;
+    }
+}
+#endif
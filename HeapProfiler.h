@@ -0,0 +1,57 @@
+#pragma once
+#ifdef CYS_HEAP_PROFILE
+#include <unordered_map>
+#include <string_view>
+#include "Object.h"
+#include "Utils.h"
+
+namespace CynicScript
+{
+    // Sampling allocation profiler,every time the allocated bytes cross the sample interval,
+    // the allocating bytecode location and the script call stack are recorded.
+    // Reports are written in folded stacks format(one "frame;frame;frame bytes" line per stack),
+    // which can be fed to flamegraph.pl,speedscope or inferno directly.
+    class CYS_API HeapProfiler
+    {
+    public:
+        SINGLETON_DECL(HeapProfiler)
+
+        void SetSampleInterval(size_t bytes);
+        size_t GetSampleInterval() const;
+
+        void RecordAllocation(Object *object, size_t bytes);
+        void RecordFree(Object *object);
+
+        // live:only count the sampled objects not yet collected,otherwise count all sampled allocations
+        STRING GetReport(bool live) const;
+        // write <pathPrefix>.alloc.folded(all sampled bytes) and <pathPrefix>.live.folded(sampled bytes still alive)
+        void WriteReports(std::string_view pathPrefix) const;
+
+    private:
+        HeapProfiler() = default;
+        ~HeapProfiler() = default;
+
+        struct AllocationSite
+        {
+            size_t totalBytes{0};
+            size_t totalCount{0};
+            size_t liveBytes{0};
+            size_t liveCount{0};
+        };
+
+        struct SampledObject
+        {
+            AllocationSite *site{nullptr};
+            size_t bytes{0};
+        };
+
+        STRING CollectStack(const Object *object) const;
+
+        size_t mSampleInterval{HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL};
+        size_t mBytesUntilNextSample{HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL};
+
+        std::unordered_map<STRING, AllocationSite> mSites;
+        std::unordered_map<Object *, SampledObject> mSampledObjects;
+    };
+}
+#endif
@@ -0,0 +1,527 @@
+#include "HeapSnapshot.h"
+#include <unordered_map>
+#include <algorithm>
+#include <deque>
+#include <cstdlib>
+#include "Allocator.h"
+#include "Logger.h"
+
+namespace CynicScript
+{
+#define HEAP_SNAPSHOT_VERSION 1
+#define HEAP_SNAPSHOT_NAME_MAX 32
+
+    static STRING DescribeObject(const Object *object)
+    {
+        STRING result;
+        switch (object->kind)
+        {
+        case ObjectKind::STR:
+            result = CYS_TO_STR_OBJ(object)->value;
+            if (result.size() > HEAP_SNAPSHOT_NAME_MAX)
+                result = result.substr(0, HEAP_SNAPSHOT_NAME_MAX) + TEXT("...");
+            break;
+        case ObjectKind::FUNCTION:
+            result = CYS_TO_FUNCTION_OBJ(object)->name;
+            break;
+        case ObjectKind::CLOSURE:
+            result = CYS_TO_CLOSURE_OBJ(object)->function->name;
+            break;
+        case ObjectKind::CLASS:
+            result = CYS_TO_CLASS_OBJ(object)->name;
+            break;
+        case ObjectKind::CLASS_CLOSURE_BIND:
+            result = CYS_TO_CLASS_CLOSURE_BIND_OBJ(object)->closure->function->name;
+            break;
+        case ObjectKind::ENUM:
+            result = CYS_TO_ENUM_OBJ(object)->name;
+            break;
+        case ObjectKind::MODULE:
+            result = CYS_TO_MODULE_OBJ(object)->name;
+            break;
+        default:
+            break;
+        }
+
+        for (auto &c : result)
+            if (c == TCHAR('\t') || c == TCHAR('\n') || c == TCHAR('\r'))
+                c = TCHAR(' ');
+        return result;
+    }
+
+    static std::vector<STRING> Split(const STRING &str, CHAR_T separator)
+    {
+        std::vector<STRING> result;
+        size_t start = 0;
+        while (true)
+        {
+            auto end = str.find(separator, start);
+            if (end == STRING::npos)
+            {
+                result.emplace_back(str.substr(start));
+                break;
+            }
+            result.emplace_back(str.substr(start, end - start));
+            start = end + 1;
+        }
+        return result;
+    }
+
+    // fields of a snapshot file are user input,anything malformed is reported with its line instead of being trusted
+    static uint64_t ParseNumber(const STRING &field, size_t lineIdx, uint32_t base = 10)
+    {
+        // at most 19 decimal or 16 hexadecimal digits,so the value cannot overflow
+        if (field.empty() || field.size() > (base == 16 ? 16 : 19))
+            CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:bad number '{}' at line {}."), field, lineIdx);
+
+        uint64_t result = 0;
+        for (const auto &c : field)
+        {
+            uint32_t digit = 0;
+            if (c >= TCHAR('0') && c <= TCHAR('9'))
+                digit = c - TCHAR('0');
+            else if (base == 16 && c >= TCHAR('a') && c <= TCHAR('f'))
+                digit = c - TCHAR('a') + 10;
+            else if (base == 16 && c >= TCHAR('A') && c <= TCHAR('F'))
+                digit = c - TCHAR('A') + 10;
+            else
+                CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:bad number '{}' at line {}."), field, lineIdx);
+            result = result * base + digit;
+        }
+        return result;
+    }
+
+    // a node or root index,-1 for none
+    static int64_t ParseIndex(const STRING &field, size_t lineIdx)
+    {
+        return field == TEXT("-1") ? -1 : static_cast<int64_t>(ParseNumber(field, lineIdx));
+    }
+
+    static std::vector<size_t> ParseIds(const STRING &str, size_t lineIdx)
+    {
+        std::vector<size_t> result;
+        for (const auto &id : Split(str, TCHAR(' ')))
+            if (!id.empty())
+                result.emplace_back(ParseNumber(id, lineIdx));
+        return result;
+    }
+
+    static size_t ParseCount(const STRING &line, const STRING &label, size_t lineIdx)
+    {
+        auto fields = Split(line, TCHAR(' '));
+        if (fields.size() != 2 || fields[0] != label)
+            CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:expect '{} <count>' at line {}."), label, lineIdx);
+        return ParseNumber(fields[1], lineIdx);
+    }
+
+    HeapSnapshot HeapSnapshot::Capture()
+    {
+        auto allocator = Allocator::GetInstance();
+
+        HeapSnapshot snapshot;
+        std::unordered_map<Object *, size_t> ids;
+        std::vector<Object *> objects;
+        std::deque<size_t> pending;
+
+        auto visit = [&](Object *object, int64_t root, int64_t parent) -> size_t
+        {
+            auto iter = ids.find(object);
+            if (iter != ids.end())
+                return iter->second;
+
+            size_t id = snapshot.mNodes.size();
+            ids[object] = id;
+            objects.emplace_back(object);
+
+            Node node;
+            node.address = (uint64_t)object;
+            node.kind = ObjectKindToString((ObjectKind)object->kind);
+            node.size = SizeOfObject(object);
+            node.root = root;
+            node.parent = parent;
+            node.name = DescribeObject(object);
+            snapshot.mNodes.emplace_back(node);
+
+            pending.emplace_back(id);
+            return id;
+        };
+
+        auto addRoot = [&](const STRING &label, const Value &value)
+        {
+            if (!CYS_IS_OBJECT_VALUE(value))
+                return;
+            Root root;
+            root.label = label;
+            snapshot.mRoots.emplace_back(root);
+            auto rootIdx = (int64_t)snapshot.mRoots.size() - 1;
+            snapshot.mRoots.back().references.emplace_back(visit(value.object, rootIdx, -1));
+        };
+
+        for (Value *slot = allocator->mValueStack; slot < allocator->mStackTop; ++slot)
+            addRoot(TEXT("stack[") + CYS_TO_STRING(slot - allocator->mValueStack) + TEXT("]"), *slot);
+        for (CallFrame *slot = allocator->mCallFrameStack; slot < allocator->mCallFrameTop; ++slot)
+            addRoot(TEXT("frame[") + CYS_TO_STRING(slot - allocator->mCallFrameStack) + TEXT("]"), slot->closure);
+        size_t upvalueIdx = 0;
+        for (UpValueObject *upvalue = allocator->mOpenUpValues; upvalue != nullptr; upvalue = upvalue->nextUpValue)
+            addRoot(TEXT("upvalue[") + CYS_TO_STRING(upvalueIdx++) + TEXT("]"), upvalue);
+        for (size_t i = 0; i < allocator->mGlobalVariableCount; ++i)
+            addRoot(TEXT("global[") + CYS_TO_STRING(i) + TEXT("]"), allocator->mGlobalVariableList[i]);
+        for (const auto &[path, moduleObj] : allocator->mImportedModules)
+            addRoot(TEXT("import[") + SourceToString(path) + TEXT("]"), moduleObj);
+        // last,a string the program reaches keeps the retaining path through the program
+        size_t internedIdx = 0;
+        for (const auto &[str, strObj] : allocator->mInternedStrs)
+            addRoot(TEXT("interned[") + CYS_TO_STRING(internedIdx++) + TEXT("]"), strObj);
+
+        // breadth first,so the recorded parent and root give a shortest retaining path
+        std::vector<Object *> references;
+        while (!pending.empty())
+        {
+            auto id = pending.front();
+            pending.pop_front();
+
+            references.clear();
+            allocator->mTracedReferences = &references;
+            objects[id]->Blacken();
+            allocator->mTracedReferences = nullptr;
+
+            for (auto reference : references)
+            {
+                auto refId = visit(reference, snapshot.mNodes[id].root, (int64_t)id);
+                snapshot.mNodes[id].references.emplace_back(refId);
+            }
+        }
+
+        return snapshot;
+    }
+
+    HeapSnapshot HeapSnapshot::Load(std::string_view path)
+    {
+        auto bytes = ReadBinaryFile(path);
+#ifdef CYS_UTF8_ENCODE
+        auto content = Utf8::Decode(std::string(bytes.begin(), bytes.end()));
+#else
+        auto content = std::string(bytes.begin(), bytes.end());
+#endif
+        auto lines = Split(content, TCHAR('\n'));
+
+        HeapSnapshot snapshot;
+        size_t lineIdx = 0;
+        auto nextLine = [&]() -> const STRING &
+        {
+            if (lineIdx >= lines.size())
+                CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:unexpected end of file."));
+            return lines[lineIdx++];
+        };
+
+        auto header = Split(nextLine(), TCHAR(' '));
+        if (header.size() != 2 || header[0] != TEXT("CYS_HEAP_SNAPSHOT"))
+            CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:missing header."));
+        if (ParseNumber(header[1], lineIdx) != HEAP_SNAPSHOT_VERSION)
+            CYS_LOG_ERROR(TEXT("Unsupported heap snapshot version:{}."), header[1]);
+
+        auto rootCountLine = nextLine();
+        auto rootCount = ParseCount(rootCountLine, TEXT("roots"), lineIdx);
+        std::vector<size_t> rootLines;
+        for (size_t i = 0; i < rootCount; ++i)
+        {
+            auto fields = Split(nextLine(), TCHAR('\t'));
+            if (fields.size() != 2)
+                CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:bad root record at line {}."), lineIdx);
+            Root root;
+            root.label = fields[0];
+            root.references = ParseIds(fields[1], lineIdx);
+            snapshot.mRoots.emplace_back(root);
+            rootLines.emplace_back(lineIdx);
+        }
+
+        auto nodeCountLine = nextLine();
+        auto nodeCount = ParseCount(nodeCountLine, TEXT("nodes"), lineIdx);
+        std::vector<size_t> nodeLines;
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            auto fields = Split(nextLine(), TCHAR('\t'));
+            if (fields.size() != 8)
+                CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:bad node record at line {}."), lineIdx);
+            Node node;
+            node.address = ParseNumber(fields[1], lineIdx, 16);
+            node.kind = fields[2];
+            node.size = ParseNumber(fields[3], lineIdx);
+            node.root = ParseIndex(fields[4], lineIdx);
+            node.parent = ParseIndex(fields[5], lineIdx);
+            node.references = ParseIds(fields[6], lineIdx);
+            node.name = fields[7];
+            snapshot.mNodes.emplace_back(node);
+            nodeLines.emplace_back(lineIdx);
+        }
+
+        // the diff follows these indices without checking them
+        for (size_t i = 0; i < rootCount; ++i)
+            for (auto ref : snapshot.mRoots[i].references)
+                if (ref >= nodeCount)
+                    CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:node {} out of range at line {}."), ref, rootLines[i]);
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            const auto &node = snapshot.mNodes[i];
+            if (node.root < -1 || node.root >= static_cast<int64_t>(rootCount) || node.parent < -1 || node.parent >= static_cast<int64_t>(nodeCount))
+                CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:root or parent out of range at line {}."), nodeLines[i]);
+            for (auto ref : node.references)
+                if (ref >= nodeCount)
+                    CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:node {} out of range at line {}."), ref, nodeLines[i]);
+        }
+
+        return snapshot;
+    }
+
+    void HeapSnapshot::Save(std::string_view path) const
+    {
+        STRING_STREAM sstr;
+        sstr << TEXT("CYS_HEAP_SNAPSHOT ") << HEAP_SNAPSHOT_VERSION << TEXT("\n");
+
+        sstr << TEXT("roots ") << mRoots.size() << TEXT("\n");
+        for (const auto &root : mRoots)
+        {
+            sstr << root.label << TEXT("\t");
+            for (size_t i = 0; i < root.references.size(); ++i)
+                sstr << (i == 0 ? TEXT("") : TEXT(" ")) << root.references[i];
+            sstr << TEXT("\n");
+        }
+
+        sstr << TEXT("nodes ") << mNodes.size() << TEXT("\n");
+        for (size_t id = 0; id < mNodes.size(); ++id)
+        {
+            const auto &node = mNodes[id];
+            sstr << id << TEXT("\t") << std::hex << node.address << std::dec << TEXT("\t") << node.kind << TEXT("\t") << node.size << TEXT("\t") << node.root << TEXT("\t") << node.parent << TEXT("\t");
+            for (size_t i = 0; i < node.references.size(); ++i)
+                sstr << (i == 0 ? TEXT("") : TEXT(" ")) << node.references[i];
+            sstr << TEXT("\t") << node.name << TEXT("\n");
+        }
+
+#ifdef CYS_UTF8_ENCODE
+        auto content = Utf8::Encode(sstr.str());
+#else
+        auto content = sstr.str();
+#endif
+        WriteBinaryFile(path, std::vector<uint8_t>(content.begin(), content.end()));
+    }
+
+    const std::vector<HeapSnapshot::Root> &HeapSnapshot::GetRoots() const
+    {
+        return mRoots;
+    }
+
+    const std::vector<HeapSnapshot::Node> &HeapSnapshot::GetNodes() const
+    {
+        return mNodes;
+    }
+
+    std::vector<size_t> HeapSnapshot::ComputeRetainedSizes() const
+    {
+        // vertex 0 is a synthetic root linked to every gc root,node i is vertex i+1
+        const size_t vertexCount = mNodes.size() + 1;
+        const size_t undefined = SIZE_MAX;
+
+        std::vector<std::vector<size_t>> successors(vertexCount);
+        for (const auto &root : mRoots)
+            for (auto ref : root.references)
+                successors[0].emplace_back(ref + 1);
+        for (size_t i = 0; i < mNodes.size(); ++i)
+            for (auto ref : mNodes[i].references)
+                successors[i + 1].emplace_back(ref + 1);
+
+        std::vector<std::vector<size_t>> predecessors(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+            for (auto s : successors[v])
+                predecessors[s].emplace_back(v);
+
+        // iterative dfs for the post order numbering
+        std::vector<size_t> postOrderIdx(vertexCount, undefined);
+        std::vector<size_t> postOrder;
+        std::vector<bool> visited(vertexCount, false);
+        std::vector<std::pair<size_t, size_t>> stack{{0, 0}};
+        visited[0] = true;
+        while (!stack.empty())
+        {
+            auto &[v, next] = stack.back();
+            if (next < successors[v].size())
+            {
+                auto s = successors[v][next++];
+                if (!visited[s])
+                {
+                    visited[s] = true;
+                    stack.emplace_back(s, 0);
+                }
+            }
+            else
+            {
+                postOrderIdx[v] = postOrder.size();
+                postOrder.emplace_back(v);
+                stack.pop_back();
+            }
+        }
+
+        // "A Simple, Fast Dominance Algorithm",Cooper,Harvey and Kennedy
+        std::vector<size_t> idom(vertexCount, undefined);
+        idom[0] = 0;
+
+        auto intersect = [&](size_t a, size_t b)
+        {
+            while (a != b)
+            {
+                while (postOrderIdx[a] < postOrderIdx[b])
+                    a = idom[a];
+                while (postOrderIdx[b] < postOrderIdx[a])
+                    b = idom[b];
+            }
+            return a;
+        };
+
+        bool changed = true;
+        while (changed)
+        {
+            changed = false;
+            for (auto iter = postOrder.rbegin(); iter != postOrder.rend(); ++iter)
+            {
+                auto v = *iter;
+                if (v == 0)
+                    continue;
+
+                size_t newIdom = undefined;
+                for (auto p : predecessors[v])
+                {
+                    if (idom[p] == undefined)
+                        continue;
+                    newIdom = (newIdom == undefined) ? p : intersect(p, newIdom);
+                }
+
+                if (idom[v] != newIdom)
+                {
+                    idom[v] = newIdom;
+                    changed = true;
+                }
+            }
+        }
+
+        // a vertex's immediate dominator is a dfs ancestor,so post order visits dominated vertices first
+        std::vector<size_t> retained(vertexCount, 0);
+        for (size_t i = 0; i < mNodes.size(); ++i)
+            retained[i + 1] = mNodes[i].size;
+        for (auto v : postOrder)
+            if (v != 0 && idom[v] != undefined)
+                retained[idom[v]] += retained[v];
+
+        return std::vector<size_t>(retained.begin() + 1, retained.end());
+    }
+
+    STRING HeapSnapshot::GetRetainingPath(size_t node) const
+    {
+        std::vector<STRING> steps;
+        std::vector<bool> visited(mNodes.size(), false);
+        size_t cur = node;
+        while (mNodes[cur].parent != -1)
+        {
+            // a malformed snapshot file may link the parents into a cycle
+            if (visited[cur])
+                CYS_LOG_ERROR(TEXT("Invalid heap snapshot file:parent cycle through node {}."), cur);
+            visited[cur] = true;
+
+            const auto &parentRefs = mNodes[mNodes[cur].parent].references;
+            auto edgeIdx = std::find(parentRefs.begin(), parentRefs.end(), cur) - parentRefs.begin();
+            steps.emplace_back(mNodes[cur].kind + TEXT("[") + CYS_TO_STRING(edgeIdx) + TEXT("]"));
+            cur = mNodes[cur].parent;
+        }
+
+        STRING result = (mNodes[cur].root >= 0 ? mRoots[mNodes[cur].root].label : TEXT("?")) + TEXT("/") + mNodes[cur].kind;
+        for (auto iter = steps.rbegin(); iter != steps.rend(); ++iter)
+            result += TEXT("/") + *iter;
+        return result;
+    }
+
+    STRING HeapSnapshot::Diff(const HeapSnapshot &before, const HeapSnapshot &after, size_t topCount)
+    {
+        struct Delta
+        {
+            int64_t count{0};
+            int64_t bytes{0};
+        };
+
+        int64_t beforeBytes = 0;
+        int64_t afterBytes = 0;
+        std::unordered_map<STRING, Delta> groups;
+        for (const auto &node : before.mNodes)
+        {
+            beforeBytes += node.size;
+            auto &group = groups[node.kind + TEXT("\t") + node.name];
+            group.count--;
+            group.bytes -= node.size;
+        }
+        for (const auto &node : after.mNodes)
+        {
+            afterBytes += node.size;
+            auto &group = groups[node.kind + TEXT("\t") + node.name];
+            group.count++;
+            group.bytes += node.size;
+        }
+
+        STRING_STREAM sstr;
+        sstr << TEXT("objects: ") << before.mNodes.size() << TEXT(" -> ") << after.mNodes.size()
+             << TEXT(", bytes: ") << beforeBytes << TEXT(" -> ") << afterBytes
+             << TEXT(" (") << (afterBytes >= beforeBytes ? TEXT("+") : TEXT("")) << afterBytes - beforeBytes << TEXT(")\n\n");
+
+        std::vector<std::pair<STRING, Delta>> sortedGroups;
+        for (const auto &[key, delta] : groups)
+            if (delta.count != 0 || delta.bytes != 0)
+                sortedGroups.emplace_back(key, delta);
+        std::sort(sortedGroups.begin(), sortedGroups.end(), [](const auto &l, const auto &r)
+                  {
+                      if (std::abs(l.second.bytes) != std::abs(r.second.bytes))
+                          return std::abs(l.second.bytes) > std::abs(r.second.bytes);
+                      return l.first < r.first; });
+
+        sstr << TEXT("changed objects by kind and name:\n");
+        sstr << TEXT("  count\tbytes\tkind\tname\n");
+        for (size_t i = 0; i < sortedGroups.size() && i < topCount; ++i)
+        {
+            const auto &[key, delta] = sortedGroups[i];
+            sstr << TEXT("  ") << (delta.count > 0 ? TEXT("+") : TEXT("")) << delta.count
+                 << TEXT("\t") << (delta.bytes > 0 ? TEXT("+") : TEXT("")) << delta.bytes
+                 << TEXT("\t") << key << TEXT("\n");
+        }
+
+        std::unordered_map<STRING, size_t> beforeRetained;
+        auto beforeSizes = before.ComputeRetainedSizes();
+        for (size_t i = 0; i < before.mNodes.size(); ++i)
+            beforeRetained[before.GetRetainingPath(i)] = beforeSizes[i];
+
+        auto afterSizes = after.ComputeRetainedSizes();
+        std::vector<size_t> order(after.mNodes.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t l, size_t r)
+                  {
+                      if (afterSizes[l] != afterSizes[r])
+                          return afterSizes[l] > afterSizes[r];
+                      return l < r; });
+
+        sstr << TEXT("\nlargest retained-size dominators:\n");
+        sstr << TEXT("  retained\tdelta\tkind\tname\tretaining path\n");
+        for (size_t i = 0; i < order.size() && i < topCount; ++i)
+        {
+            auto id = order[i];
+            auto path = after.GetRetainingPath(id);
+            auto iter = beforeRetained.find(path);
+
+            sstr << TEXT("  ") << afterSizes[id] << TEXT("\t");
+            if (iter == beforeRetained.end())
+                sstr << TEXT("new");
+            else
+            {
+                int64_t delta = (int64_t)afterSizes[id] - (int64_t)iter->second;
+                sstr << (delta > 0 ? TEXT("+") : TEXT("")) << delta;
+            }
+            sstr << TEXT("\t") << after.mNodes[id].kind << TEXT("\t") << after.mNodes[id].name << TEXT("\t") << path << TEXT("\n");
+        }
+
+        return sstr.str();
+    }
+}
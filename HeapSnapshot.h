@@ -0,0 +1,59 @@
+#pragma once
+#include <vector>
+#include <string_view>
+#include "Object.h"
+#include "Utils.h"
+
+namespace CynicScript
+{
+    // A heap snapshot records every object reachable from the gc roots,with its kind,shallow size,
+    // outgoing references and the root retaining it(the root of the shortest path found by a BFS).
+    // References are collected by the same Blacken() traversal the collector uses for marking.
+    //
+    // Snapshot file format(utf-8 text,fields separated by tabs):
+    //     CYS_HEAP_SNAPSHOT <version>
+    //     roots <root count>
+    //     <label> <referenced node ids separated by spaces>
+    //     nodes <node count>
+    //     <id> <address> <kind> <size> <retaining root> <parent node or -1> <reference ids> <name>
+    class CYS_API HeapSnapshot
+    {
+    public:
+        struct Root
+        {
+            STRING label;
+            std::vector<size_t> references;
+        };
+
+        struct Node
+        {
+            uint64_t address{0};
+            STRING kind;
+            size_t size{0};
+            int64_t root{-1};
+            int64_t parent{-1};
+            std::vector<size_t> references;
+            STRING name;
+        };
+
+        static HeapSnapshot Capture();
+        static HeapSnapshot Load(std::string_view path);
+
+        void Save(std::string_view path) const;
+
+        const std::vector<Root> &GetRoots() const;
+        const std::vector<Node> &GetNodes() const;
+
+        // size of the nodes only reachable through the node,computed with the node's dominator tree
+        std::vector<size_t> ComputeRetainedSizes() const;
+
+        // stable description of the node across processes:the retaining root plus the kind and edge index of each step
+        STRING GetRetainingPath(size_t node) const;
+
+        static STRING Diff(const HeapSnapshot &before, const HeapSnapshot &after, size_t topCount = 20);
+
+    private:
+        std::vector<Root> mRoots;
+        std::vector<Node> mNodes;
+    };
+}
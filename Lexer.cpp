@@ -1,260 +1,502 @@
+#include <iterator>
+#include <thread>
+#include <algorithm>
 #include "Lexer.h"
 #include "Logger.h"
+#include "SimdScan.h"
 namespace CynicScript
 {
-	constexpr struct
+	struct Keyword
 	{
-		const CHAR_T *name;
+		SOURCE_STRING_VIEW name;
 		TokenKind type;
-	} keywords[] = {
-		{TEXT("let"), TokenKind::LET},
-		{TEXT("if"), TokenKind::IF},
-		{TEXT("else"), TokenKind::ELSE},
-		{TEXT("true"), TokenKind::TRUE},
-		{TEXT("false"), TokenKind::FALSE},
-		{TEXT("null"), TokenKind::NIL},
-		{TEXT("while"), TokenKind::WHILE},
-		{TEXT("for"), TokenKind::FOR},
-		{TEXT("fn"), TokenKind::FUNCTION},
-		{TEXT("class"), TokenKind::CLASS},
-		{TEXT("this"), TokenKind::THIS},
-		{TEXT("base"), TokenKind::BASE},
-		{TEXT("public"), TokenKind::PUBLIC},
-		{TEXT("protected"), TokenKind::PROTECTED},
-		{TEXT("private"), TokenKind::PRIVATE},
-		{TEXT("return"), TokenKind::RETURN},
-		{TEXT("static"), TokenKind::STATIC},
-		{TEXT("const"), TokenKind::CONST},
-		{TEXT("break"), TokenKind::BREAK},
-		{TEXT("continue"), TokenKind::CONTINUE},
-		{TEXT("import"), TokenKind::IMPORT},
-		{TEXT("module"), TokenKind::MODULE},
-		{TEXT("switch"), TokenKind::SWITCH},
-		{TEXT("default"), TokenKind::DEFAULT},
-		{TEXT("match"), TokenKind::MATCH},
-		{TEXT("enum"), TokenKind::ENUM},
-		{TEXT("u8"), TokenKind::U8},
-		{TEXT("u16"), TokenKind::U16},
-		{TEXT("u32"), TokenKind::U32},
-		{TEXT("u64"), TokenKind::U64},
-		{TEXT("i8"), TokenKind::I8},
-		{TEXT("i16"), TokenKind::I16},
-		{TEXT("i32"), TokenKind::I32},
-		{TEXT("i64"), TokenKind::I64},
-		{TEXT("f32"), TokenKind::F32},
-		{TEXT("f64"), TokenKind::F64},
-		{TEXT("bool"), TokenKind::BOOL},
-		{TEXT("char"), TokenKind::CHAR},
-		{TEXT("void"), TokenKind::VOID},
-		{TEXT("any"), TokenKind::ANY},
-		{TEXT("as"), TokenKind::AS},
-		{TEXT("new"), TokenKind::NEW},
-		{TEXT("struct"), TokenKind::STRUCT},
 	};
 
+	constexpr Keyword keywords[] = {
+		{"let", TokenKind::LET},
+		{"if", TokenKind::IF},
+		{"else", TokenKind::ELSE},
+		{"true", TokenKind::TRUE},
+		{"false", TokenKind::FALSE},
+		{"null", TokenKind::NIL},
+		{"while", TokenKind::WHILE},
+		{"for", TokenKind::FOR},
+		{"fn", TokenKind::FUNCTION},
+		{"class", TokenKind::CLASS},
+		{"this", TokenKind::THIS},
+		{"base", TokenKind::BASE},
+		{"public", TokenKind::PUBLIC},
+		{"protected", TokenKind::PROTECTED},
+		{"private", TokenKind::PRIVATE},
+		{"return", TokenKind::RETURN},
+		{"static", TokenKind::STATIC},
+		{"const", TokenKind::CONST},
+		{"break", TokenKind::BREAK},
+		{"continue", TokenKind::CONTINUE},
+		{"import", TokenKind::IMPORT},
+		{"module", TokenKind::MODULE},
+		{"switch", TokenKind::SWITCH},
+		{"default", TokenKind::DEFAULT},
+		{"match", TokenKind::MATCH},
+		{"enum", TokenKind::ENUM},
+		{"u8", TokenKind::U8},
+		{"u16", TokenKind::U16},
+		{"u32", TokenKind::U32},
+		{"u64", TokenKind::U64},
+		{"i8", TokenKind::I8},
+		{"i16", TokenKind::I16},
+		{"i32", TokenKind::I32},
+		{"i64", TokenKind::I64},
+		{"f32", TokenKind::F32},
+		{"f64", TokenKind::F64},
+		{"bool", TokenKind::BOOL},
+		{"char", TokenKind::CHAR},
+		{"void", TokenKind::VOID},
+		{"any", TokenKind::ANY},
+		{"as", TokenKind::AS},
+		{"new", TokenKind::NEW},
+		{"struct", TokenKind::STRUCT},
+	};
+
+	// Keywords are recognized through a perfect hash over the length and the first,second and last characters,
+	// so an identifier costs one table probe plus at most one comparison.The multipliers are searched at compile
+	// time,adding a keyword that makes the search fail is a compile error rather than a silent collision.
+	constexpr size_t KEYWORD_HASH_TABLE_SIZE = 128;
+	constexpr size_t KEYWORD_MIN_LENGTH = 2;
+	constexpr size_t KEYWORD_MAX_LENGTH = 9;
+
+	struct KeywordHashTable
+	{
+		uint32_t firstMultiplier{0};
+		uint32_t secondMultiplier{0};
+		int8_t slots[KEYWORD_HASH_TABLE_SIZE]{};
+	};
+
+	constexpr size_t HashKeyword(SOURCE_STRING_VIEW literal, uint32_t firstMultiplier, uint32_t secondMultiplier)
+	{
+		return (static_cast<uint8_t>(literal[0]) * firstMultiplier + static_cast<uint8_t>(literal[1]) * secondMultiplier + static_cast<uint8_t>(literal.back()) + static_cast<uint32_t>(literal.size())) & (KEYWORD_HASH_TABLE_SIZE - 1);
+	}
+
+	constexpr KeywordHashTable BuildKeywordHashTable()
+	{
+		for (uint32_t a = 1; a < 64; ++a)
+		{
+			for (uint32_t b = 1; b < 64; ++b)
+			{
+				KeywordHashTable table{a, b};
+				for (auto &slot : table.slots)
+					slot = -1;
+
+				bool collided = false;
+				for (size_t i = 0; i < std::size(keywords) && !collided; ++i)
+				{
+					auto &slot = table.slots[HashKeyword(keywords[i].name, a, b)];
+					if (slot != -1)
+						collided = true;
+					else
+						slot = static_cast<int8_t>(i);
+				}
+
+				if (!collided)
+					return table;
+			}
+		}
+		return KeywordHashTable{};
+	}
+
+	constexpr KeywordHashTable keywordHashTable = BuildKeywordHashTable();
+	static_assert(keywordHashTable.firstMultiplier != 0, "No perfect hash found for the keyword table,widen the multiplier search or the table size.");
+
+	constexpr bool IsKeywordLengthInRange()
+	{
+		for (const auto &keyword : keywords)
+			if (keyword.name.size() < KEYWORD_MIN_LENGTH || keyword.name.size() > KEYWORD_MAX_LENGTH)
+				return false;
+		return true;
+	}
+	static_assert(IsKeywordLengthInRange(), "Keyword length out of [KEYWORD_MIN_LENGTH,KEYWORD_MAX_LENGTH].");
+
+	constexpr TokenKind LookupKeyword(SOURCE_STRING_VIEW literal)
+	{
+		if (literal.size() < KEYWORD_MIN_LENGTH || literal.size() > KEYWORD_MAX_LENGTH)
+			return TokenKind::IDENTIFIER;
+
+		auto slot = keywordHashTable.slots[HashKeyword(literal, keywordHashTable.firstMultiplier, keywordHashTable.secondMultiplier)];
+		if (slot == -1 || keywords[slot].name != literal)
+			return TokenKind::IDENTIFIER;
+		return keywords[slot].type;
+	}
+
+	static_assert(LookupKeyword("continue") == TokenKind::CONTINUE);
+	static_assert(LookupKeyword("contin") == TokenKind::IDENTIFIER);
+
 	Lexer::Lexer()
 	{
 		ResetStatus();
 	}
 
-	const std::vector<Token *> &Lexer::ScanTokens(STRING_VIEW src)
+	const std::vector<Token *> &Lexer::ScanTokens(SOURCE_STRING_VIEW src)
 	{
-		Logger::RecordSource(src);
+		SOURCE_STRING buffer(src); // src may view the previous buffer
+		ResetStatus();
+		mSourceBuffer = std::move(buffer);
+		mSource = mSourceBuffer;
+		return Scan();
+	}
 
+	const std::vector<Token *> &Lexer::ScanFile(std::string_view path)
+	{
 		ResetStatus();
-		mSource = src;
-		while (!IsAtEnd())
+		Logger::RecordFilePath(path);
+		if (!mMappedSource.Open(path))
+			CYS_LOG_ERROR(TEXT("Failed to open file:{}"), Logger::Record::mCurFilePath);
+
+		mSource = SOURCE_STRING_VIEW(reinterpret_cast<const SOURCE_CHAR_T *>(mMappedSource.GetData()), mMappedSource.GetSize());
+		if (mSource.starts_with(UTF8_BOM))
+			mSource.remove_prefix(UTF8_BOM.size());
+		mSourceId = Logger::RecordSourceFile(path, mSource);
+		return Scan();
+	}
+
+	const std::vector<Token *> &Lexer::Scan()
+	{
+		Logger::RecordSource(mSource);
+		mEndPos = mSource.size();
+
+		if (mSource.size() < mParallelThreshold || !ScanParallel())
 		{
-			mStartPos = mCurPos;
-			ScanToken();
+			while (!IsAtEnd())
+			{
+				mStartPos = mCurPos;
+				ScanToken();
+			}
 		}
 
-		AddToken(TokenKind::END, TEXT("END"));
+		AddToken(TokenKind::END, "END");
 
 		return mTokens;
 	}
-	void Lexer::ScanToken()
+
+	void Lexer::SetParallelThreshold(size_t bytes)
+	{
+		mParallelThreshold = bytes;
+	}
+
+	void Lexer::SetParallelWorkerCount(size_t count)
+	{
+		mParallelWorkerCount = count;
+	}
+
+	bool Lexer::ScanParallel()
 	{
-		STRING c;
+		size_t workerCount = mParallelWorkerCount != 0 ? mParallelWorkerCount : std::max(1u, std::thread::hardware_concurrency());
+		workerCount = std::min<size_t>(workerCount, mSource.size() / LEXER_PARALLEL_MIN_CHUNK_SIZE);
+		auto splitPoints = FindSplitPoints(workerCount);
+		if (splitPoints.size() < 2)
+			return false;
+
+		for (size_t i = 0; i < splitPoints.size(); ++i)
+		{
+			auto &worker = mWorkers.emplace_back(std::make_unique<Lexer>());
+			worker->mSourceId = mSourceId;
+			worker->mDeferErrors = true;
+		}
+
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < splitPoints.size(); ++i)
+		{
+			uint64_t end = i + 1 < splitPoints.size() ? splitPoints[i + 1].pos : mSource.size();
+			threads.emplace_back([this, i, end, &splitPoints]()
+								 { mWorkers[i]->ScanRange(mSource, splitPoints[i].pos, end, splitPoints[i].line); });
+		}
+		for (auto &thread : threads)
+			thread.join();
+
+		// chunks are in source order,so the first error found is the one a sequential scan would have stopped at
+		for (const auto &worker : mWorkers)
+			if (worker->mError)
+				CYS_LOG_ERROR_WITH_LOC(worker->mError->pos, worker->mError->message);
+
+		size_t tokenCount = 0;
+		for (const auto &worker : mWorkers)
+			tokenCount += worker->mTokens.size();
+
+		mTokens.reserve(tokenCount + 1);
+		for (const auto &worker : mWorkers)
+			mTokens.insert(mTokens.end(), worker->mTokens.begin(), worker->mTokens.end());
 
-		CHAR_T ch;
-		bool isAscii = true;
-		if (!isascii(GetCurChar()))
+		mCurPos = mEndPos;
+		mLine = mWorkers.back()->mLine;
+		mColumn = mWorkers.back()->mColumn;
+		return true;
+	}
+
+	void Lexer::ScanRange(SOURCE_STRING_VIEW source, uint64_t begin, uint64_t end, uint64_t line)
+	{
+		mSource = source;
+		mCurPos = begin;
+		mEndPos = end;
+		mLine = line;
+		mColumn = 1;
+		while (!IsAtEnd() && !mError)
 		{
-			ch = GetCurChar();
-			isAscii = false;
-			while (!isascii(GetCurChar())) // not a ASCII char
+			mStartPos = mCurPos;
+			ScanToken();
+		}
+	}
+
+	void Lexer::ReportError(uint64_t pos, const STRING &message)
+	{
+		if (!mDeferErrors)
+			CYS_LOG_ERROR_WITH_LOC(pos, message);
+		if (!mError)
+			mError = LexError{pos, message};
+	}
+
+	std::vector<Lexer::SplitPoint> Lexer::FindSplitPoints(size_t chunkCount)
+	{
+		// Walk the source tracking only what can hide a newline from the tokenizer:string literals,character literals and
+		// comments,mirroring how ScanToken consumes them.A chunk starts right after the first newline outside of them at
+		// or past each chunk-sized offset,with the line number the sequential scan would have there.
+		std::vector<SplitPoint> result{{0, 1}};
+		if (chunkCount < 2)
+			return result;
+
+		const size_t chunkSize = mSource.size() / chunkCount;
+		const SOURCE_CHAR_T *p = mSource.data();
+		const size_t n = mSource.size();
+		uint64_t line = 1;
+		size_t pos = 0;
+		size_t nextSplit = chunkSize;
+
+		auto skipPast = [&](SOURCE_CHAR_T c)
+		{
+			while (pos < n)
+			{
+				pos += FindFirstOf(p + pos, n - pos, c, '\n');
+				if (pos >= n)
+					return;
+				if (p[pos++] == c)
+					return;
+				line++;
+			}
+		};
+
+		while (pos < n && result.size() < chunkCount)
+		{
+			pos += FindFirstOf(p + pos, n - pos, '\n', '\"', '\'', '/');
+			if (pos >= n)
+				break;
+
+			SOURCE_CHAR_T c = p[pos++];
+			if (c == '\n')
 			{
-				c.append(1, ch);
-				ch = GetCurCharAndStepOnce();
+				line++;
+				if (pos >= nextSplit && pos < n)
+				{
+					result.push_back({pos, line});
+					nextSplit = pos + chunkSize;
+				}
+			}
+			else if (c == '\"')
+				skipPast('\"');
+			else if (c == '\'')
+			{
+				size_t length;
+				Utf8::DecodeCodePoint(p + pos, n - pos, length);
+				pos += length + 1; // the character and the closing '\'',a newline here doesn't count as a line
+			}
+			else if (pos < n && p[pos] == '/')
+				pos += FindFirstOf(p + pos, n - pos, '\n');
+			else if (pos < n && p[pos] == '*')
+			{
+				pos++;
+				while (pos < n)
+				{
+					skipPast('*');
+					if (pos < n && p[pos] == '/')
+					{
+						pos++;
+						break;
+					}
+				}
 			}
 		}
-		else
+		return result;
+	}
+
+	void Lexer::ScanToken()
+	{
+		if (!isascii(GetCurChar())) // a multibyte sequence can only start an identifier
 		{
-			ch = GetCurCharAndStepOnce();
-			c.append(1, ch);
+			size_t length;
+			auto codePoint = DecodeCurCodePoint(length);
+			if (IsUnicodeLetter(codePoint))
+				Identifier();
+			else
+			{
+				mCurPos += length;
+				ReportError(mCurPos, TEXT("Unknown literal:") + SourceToString(SOURCE_STRING_VIEW(mSource).substr(mStartPos, length)));
+			}
+			return;
 		}
 
-		if (c == TEXT("("))
+		SOURCE_CHAR_T c = GetCurCharAndStepOnce();
+
+		if (c == '(')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('{')))
+			if (IsMatchCurCharAndStepOnce('{'))
 				AddToken(TokenKind::LPAREN_LBRACE);
 			else
 				AddToken(TokenKind::LPAREN);
 		}
-		else if (c == TEXT(")"))
+		else if (c == ')')
 			AddToken(TokenKind::RPAREN);
-		else if (c == TEXT("["))
+		else if (c == '[')
 			AddToken(TokenKind::LBRACKET);
-		else if (c == TEXT("]"))
+		else if (c == ']')
 			AddToken(TokenKind::RBRACKET);
-		else if (c == TEXT("{"))
+		else if (c == '{')
 			AddToken(TokenKind::LBRACE);
-		else if (c == TEXT("}"))
+		else if (c == '}')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR(')')))
+			if (IsMatchCurCharAndStepOnce(')'))
 				AddToken(TokenKind::RBRACE_RPAREN);
 			else
 				AddToken(TokenKind::RBRACE);
 		}
-		else if (c == TEXT("."))
+		else if (c == '.')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('.')))
+			if (IsMatchCurCharAndStepOnce('.'))
 			{
-				if (IsMatchCurCharAndStepOnce(TCHAR('.')))
+				if (IsMatchCurCharAndStepOnce('.'))
 					AddToken(TokenKind::ELLIPSIS);
 				else
-					CYS_LOG_ERROR_WITH_LOC(mCurPos, TEXT("Unknown literal:'..',did you want '.' or '...'?"));
+					ReportError(mCurPos, TEXT("Unknown literal:'..',did you want '.' or '...'?"));
 			}
 			else
 				AddToken(TokenKind::DOT);
 		}
-		else if (c == TEXT(","))
+		else if (c == ',')
 			AddToken(TokenKind::COMMA);
-		else if (c == TEXT(":"))
+		else if (c == ':')
 			AddToken(TokenKind::COLON);
-		else if (c == TEXT(";"))
+		else if (c == ';')
 			AddToken(TokenKind::SEMICOLON);
-		else if (c == TEXT("~"))
+		else if (c == '~')
 			AddToken(TokenKind::TILDE);
-		else if (c == TEXT("?"))
+		else if (c == '?')
 			AddToken(TokenKind::QUESTION);
-		else if (c == TEXT("\""))
+		else if (c == '\"')
 			String();
-		else if (c == TEXT("\'"))
+		else if (c == '\'')
 			Character();
-		else if (c == TEXT(" ") || c == TEXT("\t") || c == TEXT("\r"))
+		else if (c == ' ' || c == '\t' || c == '\r')
 		{
+			size_t blankCount = SpanBlank(mSource.data() + mCurPos, mEndPos - mCurPos);
+			mCurPos += blankCount;
+			mColumn += blankCount;
 		}
-		else if (c == TEXT("\n"))
+		else if (c == '\n')
 		{
 			mLine++;
 			mColumn = 1;
 		}
-		else if (c == TEXT("+"))
+		else if (c == '+')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::PLUS_EQUAL);
-			else if (IsMatchCurCharAndStepOnce(TCHAR('+')))
+			else if (IsMatchCurCharAndStepOnce('+'))
 				AddToken(TokenKind::PLUS_PLUS);
 			else
 				AddToken(TokenKind::PLUS);
 		}
-		else if (c == TEXT("-"))
+		else if (c == '-')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::MINUS_EQUAL);
-			else if (IsMatchCurCharAndStepOnce(TCHAR('-')))
+			else if (IsMatchCurCharAndStepOnce('-'))
 				AddToken(TokenKind::MINUS_MINUS);
 			else
 				AddToken(TokenKind::MINUS);
 		}
-		else if (c == TEXT("*"))
+		else if (c == '*')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::ASTERISK_EQUAL);
 			else
 				AddToken(TokenKind::ASTERISK);
 		}
-		else if (c == TEXT("/"))
+		else if (c == '/')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('/')))
+			if (IsMatchCurCharAndStepOnce('/'))
 			{
-				while (!IsMatchCurChar(TCHAR('\n')) && !IsAtEnd())
-					GetCurCharAndStepOnce();
+				size_t commentLength = FindFirstOf(mSource.data() + mCurPos, mEndPos - mCurPos, '\n');
+				mColumn += commentLength - CountUtf8ContinuationBytes(mSource.data() + mCurPos, commentLength);
+				mCurPos += commentLength;
 			}
-			else if (IsMatchCurCharAndStepOnce(TCHAR('*')))
+			else if (IsMatchCurCharAndStepOnce('*'))
 			{
 				while (!IsAtEnd())
 				{
-					if (IsMatchCurChar(TCHAR('\n')))
-					{
-						mLine++;
-						mColumn = 1;
-					}
-					Logger::Println(TEXT("{}"), GetCurChar());
-					GetCurCharAndStepOnce();
-					if (IsMatchCurChar(TCHAR('*')))
-					{
-						GetCurCharAndStepOnce();
-						if (IsMatchCurChar(TCHAR('/')))
-						{
-							GetCurCharAndStepOnce();
-							break;
-						}
-					}
+					SkipUntil('*');
+					if (IsAtEnd())
+						break;
+					GetCurCharAndStepOnce(); // eat '*'
+					if (IsMatchCurCharAndStepOnce('/'))
+						break;
 				}
 			}
-			else if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			else if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::SLASH_EQUAL);
 			else
 				AddToken(TokenKind::SLASH);
 		}
-		else if (c == TEXT("%"))
+		else if (c == '%')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::PERCENT_EQUAL);
 			AddToken(TokenKind::PERCENT);
 		}
-		else if (c == TEXT("!"))
+		else if (c == '!')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::BANG_EQUAL);
 			else
 				AddToken(TokenKind::BANG);
 		}
-		else if (c == TEXT("&"))
+		else if (c == '&')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('&')))
+			if (IsMatchCurCharAndStepOnce('&'))
 				AddToken(TokenKind::AMPERSAND_AMPERSAND);
-			else if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			else if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::AMPERSAND_EQUAL);
 			else
 				AddToken(TokenKind::AMPERSAND);
 		}
-		else if (c == TEXT("|"))
+		else if (c == '|')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('|')))
+			if (IsMatchCurCharAndStepOnce('|'))
 				AddToken(TokenKind::VBAR_VBAR);
-			else if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			else if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::VBAR_EQUAL);
 			else
 				AddToken(TokenKind::VBAR);
 		}
-		else if (c == TEXT("^"))
+		else if (c == '^')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::CARET_EQUAL);
 			else
 				AddToken(TokenKind::CARET);
 		}
-		else if (c == TEXT("<"))
+		else if (c == '<')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::LESS_EQUAL);
-			else if (IsMatchCurCharAndStepOnce(TCHAR('<')))
+			else if (IsMatchCurCharAndStepOnce('<'))
 			{
-				if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+				if (IsMatchCurCharAndStepOnce('='))
 					AddToken(TokenKind::LESS_LESS_EQUAL);
 				else
 					AddToken(TokenKind::LESS_LESS);
@@ -262,13 +504,13 @@ namespace CynicScript
 			else
 				AddToken(TokenKind::LESS);
 		}
-		else if (c == TEXT(">"))
+		else if (c == '>')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::GREATER_EQUAL);
-			else if (IsMatchCurCharAndStepOnce(TCHAR('>')))
+			else if (IsMatchCurCharAndStepOnce('>'))
 			{
-				if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+				if (IsMatchCurCharAndStepOnce('='))
 					AddToken(TokenKind::GREATER_GREATER_EQUAL);
 				else
 					AddToken(TokenKind::GREATER_GREATER);
@@ -276,40 +518,65 @@ namespace CynicScript
 			else
 				AddToken(TokenKind::GREATER);
 		}
-		else if (c == TEXT("="))
+		else if (c == '=')
 		{
-			if (IsMatchCurCharAndStepOnce(TCHAR('=')))
+			if (IsMatchCurCharAndStepOnce('='))
 				AddToken(TokenKind::EQUAL_EQUAL);
 			else
 				AddToken(TokenKind::EQUAL);
 		}
 		else
 		{
-			if (IsNumber(ch))
+			if (IsNumber(c))
 				Number();
-			else if (IsLetter(ch, isAscii))
+			else if (IsLetter(c))
 				Identifier();
 			else
 			{
-				auto literal = mSource.substr(mStartPos, mCurPos - mStartPos);
-				CYS_LOG_ERROR_WITH_LOC(mCurPos, TEXT("Unknown literal:") + literal);
+				auto literal = SOURCE_STRING_VIEW(mSource).substr(mStartPos, mCurPos - mStartPos);
+				ReportError(mCurPos, TEXT("Unknown literal:") + SourceToString(literal));
 			}
 		}
 	}
 
+	void Lexer::SkipUntil(SOURCE_CHAR_T c)
+	{
+		while (!IsAtEnd())
+		{
+			size_t count = FindFirstOf(mSource.data() + mCurPos, mEndPos - mCurPos, c, '\n');
+			mColumn += count - CountUtf8ContinuationBytes(mSource.data() + mCurPos, count);
+			mCurPos += count;
+			if (IsAtEnd() || IsMatchCurChar(c))
+				return;
+
+			mCurPos++; // eat '\n'
+			mLine++;
+			mColumn = 1;
+		}
+	}
+
 	void Lexer::ResetStatus()
 	{
 		mStartPos = mCurPos = 0;
 		mLine = 1;
 		mColumn = 1;
-		std::vector<Token *>().swap(mTokens);
+		mEndPos = 0;
+		mTokens.clear();
+		mWorkers.clear();
+		mError.reset();
+		mTokenArena.Reset();
+		mAtomCache.clear();
+		mSource = SOURCE_STRING_VIEW();
+		mSourceId = 0;
+		mSourceBuffer.clear();
+		mMappedSource.Close();
 	}
 
-	bool Lexer::IsMatchCurChar(CHAR_T c)
+	bool Lexer::IsMatchCurChar(SOURCE_CHAR_T c)
 	{
 		return GetCurChar() == c;
 	}
-	bool Lexer::IsMatchCurCharAndStepOnce(CHAR_T c)
+	bool Lexer::IsMatchCurCharAndStepOnce(SOURCE_CHAR_T c)
 	{
 		bool result = GetCurChar() == c;
 		if (result)
@@ -320,61 +587,74 @@ namespace CynicScript
 		return result;
 	}
 
-	CHAR_T Lexer::GetCurCharAndStepOnce()
+	SOURCE_CHAR_T Lexer::GetCurCharAndStepOnce()
 	{
 		if (!IsAtEnd())
 		{
 			mColumn++;
 			return mSource[mCurPos++];
 		}
-		return TCHAR('\0');
+		return '\0';
 	}
 
-	CHAR_T Lexer::GetCurChar()
+	SOURCE_CHAR_T Lexer::GetCurChar()
 	{
 		if (!IsAtEnd())
 			return mSource[mCurPos];
-		return TCHAR('\0');
+		return '\0';
 	}
 
 	void Lexer::AddToken(TokenKind type)
 	{
-		auto literal = mSource.substr(mStartPos, mCurPos - mStartPos);
-
-		SourceLocation srcLoc;
-		srcLoc.line = mLine;
-		srcLoc.column = mColumn - literal.size();
-		srcLoc.pos = mCurPos - literal.size();
-
-		mTokens.push_back(new Token(type, literal, srcLoc));
+		AddToken(type, SOURCE_STRING_VIEW(mSource).substr(mStartPos, mCurPos - mStartPos));
 	}
-	void Lexer::AddToken(TokenKind type, STRING_VIEW literal)
+	void Lexer::AddToken(TokenKind type, SOURCE_STRING_VIEW literal)
 	{
 		SourceLocation srcLoc;
 		srcLoc.line = mLine;
-		srcLoc.column = mColumn - literal.size();
+		srcLoc.column = mColumn - (literal.size() - CountUtf8ContinuationBytes(literal.data(), literal.size()));
 		srcLoc.pos = mCurPos - literal.size();
-		mTokens.push_back(new Token(type, literal, srcLoc));
+		mTokens.push_back(mTokenArena.New<Token>(type, literal, srcLoc));
+		mTokens.back()->sourceId = mSourceId;
 	}
 
 	bool Lexer::IsAtEnd()
 	{
-		return mCurPos >= mSource.size();
+		return mCurPos >= mEndPos;
 	}
 
-	bool Lexer::IsNumber(CHAR_T c)
+	bool Lexer::IsNumber(SOURCE_CHAR_T c)
 	{
-		return c >= TCHAR('0') && c <= TCHAR('9');
+		return c >= '0' && c <= '9';
 	}
-	bool Lexer::IsLetter(CHAR_T c, bool isAscii)
+	bool Lexer::IsLetter(SOURCE_CHAR_T c)
 	{
-		if (!isAscii)
-			return true;
-		return (c >= TCHAR('A') && c <= TCHAR('Z')) || (c >= TCHAR('a') && c <= TCHAR('z')) || c == TCHAR('_');
+		return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_';
 	}
-	bool Lexer::IsLetterOrNumber(CHAR_T c, bool isAscii)
+	bool Lexer::IsUnicodeLetter(uint32_t codePoint)
 	{
-		return IsLetter(c, isAscii) || IsNumber(c);
+		// every non ascii code point is an identifier char except spaces and punctuation a script may put next to a name
+		if (codePoint == Utf8::INVALID_CODE_POINT || codePoint < 0xC0 || codePoint == 0xD7 || codePoint == 0xF7 || codePoint == 0xFEFF)
+			return false;
+		if ((codePoint >= 0x2000 && codePoint <= 0x206F) || // general punctuation
+			(codePoint >= 0x2E00 && codePoint <= 0x2E7F) || // supplemental punctuation
+			(codePoint >= 0x3000 && codePoint <= 0x303F) || // cjk symbols and punctuation
+			(codePoint >= 0xFE10 && codePoint <= 0xFE1F) || // vertical forms
+			(codePoint >= 0xFE30 && codePoint <= 0xFE6F) || // cjk compatibility and small form variants
+			(codePoint >= 0xFF00 && codePoint <= 0xFF0F) || // fullwidth ascii punctuation
+			(codePoint >= 0xFF1A && codePoint <= 0xFF20) ||
+			(codePoint >= 0xFF3B && codePoint <= 0xFF40) ||
+			(codePoint >= 0xFF5B && codePoint <= 0xFF65))
+			return false;
+		return true;
+	}
+
+	uint32_t Lexer::DecodeCurCodePoint(size_t &length)
+	{
+		auto codePoint = Utf8::DecodeCodePoint(mSource.data() + mCurPos, mEndPos - mCurPos, length);
+		if (codePoint == Utf8::INVALID_CODE_POINT)
+			ReportError(mCurPos, TEXT("Invalid utf-8 sequence."));
+		return codePoint;
 	}
 
 	void Lexer::Number()
@@ -382,15 +662,15 @@ namespace CynicScript
 		while (IsNumber(GetCurChar()))
 			GetCurCharAndStepOnce();
 
-		if (IsMatchCurCharAndStepOnce(TCHAR('.')))
+		if (IsMatchCurCharAndStepOnce('.'))
 		{
 			if (IsNumber(GetCurChar()))
 				while (IsNumber(GetCurChar()))
 					GetCurCharAndStepOnce();
-			else if (GetCurChar() == TCHAR('f'))
+			else if (GetCurChar() == 'f')
 				GetCurCharAndStepOnce();
 			else
-				CYS_LOG_ERROR_WITH_LOC(mCurPos, TEXT("The character next to '.' in a floating number must be in [0-9] range or a single 'f' character."));
+				ReportError(mCurPos, TEXT("The character next to '.' in a floating number must be in [0-9] range or a single 'f' character."));
 		}
 
 		AddToken(TokenKind::NUMBER);
@@ -398,55 +678,61 @@ namespace CynicScript
 
 	void Lexer::Identifier()
 	{
-		CHAR_T c = GetCurChar();
-		bool isAscii = isascii(c) ? true : false;
-		while (IsLetterOrNumber(c, isAscii))
+		while (!IsAtEnd())
 		{
-			GetCurCharAndStepOnce();
-			c = GetCurChar();
-			isAscii = isascii(c) ? true : false;
-		}
+			size_t asciiCount = SpanAsciiIdentifier(mSource.data() + mCurPos, mEndPos - mCurPos);
+			mCurPos += asciiCount;
+			mColumn += asciiCount;
 
-		STRING literal = mSource.substr(mStartPos, mCurPos - mStartPos);
+			if (IsAtEnd() || isascii(GetCurChar())) // stopped at an ascii char that can't continue an identifier
+				break;
 
-		bool isKeyWord = false;
-		for (const auto &keyword : keywords)
-			if (STRCMP(keyword.name, literal.c_str()) == 0)
-			{
-				AddToken(keyword.type, literal);
-				isKeyWord = true;
+			size_t length;
+			if (!IsUnicodeLetter(DecodeCurCodePoint(length)))
 				break;
-			}
+			mCurPos += length;
+			mColumn++;
+		}
+
+		auto literal = SOURCE_STRING_VIEW(mSource).substr(mStartPos, mCurPos - mStartPos);
 
-		if (!isKeyWord)
-			AddToken(TokenKind::IDENTIFIER, literal);
+		auto kind = LookupKeyword(literal);
+		AddToken(kind, literal);
+		if (kind == TokenKind::IDENTIFIER)
+			mTokens.back()->atom = InternAtom(literal);
+	}
+
+	Atom Lexer::InternAtom(SOURCE_STRING_VIEW literal)
+	{
+		auto iter = mAtomCache.find(literal);
+		if (iter != mAtomCache.end())
+			return iter->second;
+
+		auto atom = AtomTable::GetInstance()->Intern(literal);
+		mAtomCache.emplace(literal, atom);
+		return atom;
 	}
 
 	void Lexer::String()
 	{
-		while (!IsMatchCurChar(TCHAR('\"')) && !IsAtEnd())
-		{
-			if (IsMatchCurChar(TCHAR('\n')))
-			{
-				mLine++;
-				mColumn = 1;
-			}
-			GetCurCharAndStepOnce();
-		}
+		SkipUntil('\"');
 
 		if (IsAtEnd())
 			Logger::Println(TEXT("[line {}]:Uniterminated string."), mLine);
 
 		GetCurCharAndStepOnce(); // eat the second '\"'
 
-		AddToken(TokenKind::STR, mSource.substr(mStartPos + 1, mCurPos - mStartPos - 2));
+		AddToken(TokenKind::STR, SOURCE_STRING_VIEW(mSource).substr(mStartPos + 1, mCurPos - mStartPos - 2));
 	}
 
 	void Lexer::Character()
 	{
-		GetCurCharAndStepOnce(); // eat the first '\''
+		size_t length;
+		DecodeCurCodePoint(length);
+		mCurPos += length; // eat the character,a multibyte sequence is one character
+		mColumn++;
 
-		AddToken(TokenKind::CHARACTER, mSource.substr(mStartPos + 1, 1));
+		AddToken(TokenKind::CHARACTER, SOURCE_STRING_VIEW(mSource).substr(mStartPos + 1, length));
 
 		GetCurCharAndStepOnce(); // eat the second '\''
 	}
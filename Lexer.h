@@ -4,8 +4,12 @@
 #include <string>
 #include <iostream>
 #include <unordered_map>
+#include <memory>
+#include <optional>
 #include "Token.h"
 #include "Utils.h"
+#include "Arena.h"
+#include "MappedFile.h"
 
 namespace CynicScript
 {
@@ -15,27 +19,58 @@ namespace CynicScript
 		Lexer();
 		~Lexer() = default;
 
-		const std::vector<Token *> &ScanTokens(STRING_VIEW src);
+		const std::vector<Token *> &ScanTokens(SOURCE_STRING_VIEW src); // src is utf-8,copied into the lexer
+		const std::vector<Token *> &ScanFile(std::string_view path);	 // scanned in place over a read-only mapping of the file
+
+		// sources of at least this size are split at safe newlines and tokenized on several threads
+		void SetParallelThreshold(size_t bytes);
+		// 0 uses one thread per hardware thread
+		void SetParallelWorkerCount(size_t count);
 
 	private:
 		void ResetStatus();
 
+		const std::vector<Token *> &Scan();
+
+		struct SplitPoint
+		{
+			uint64_t pos;
+			uint64_t line;
+		};
+
+		std::vector<SplitPoint> FindSplitPoints(size_t chunkCount);
+		bool ScanParallel();
+		void ScanRange(SOURCE_STRING_VIEW source, uint64_t begin, uint64_t end, uint64_t line);
+
+		// logs and stops like CYS_LOG_ERROR_WITH_LOC,except on the workers of a parallel scan which keep their first
+		// error for the calling thread to report and stop scanning their chunk
+		void ReportError(uint64_t pos, const STRING &message);
+
 		void ScanToken();
 
-		bool IsMatchCurChar(CHAR_T c);
-		bool IsMatchCurCharAndStepOnce(CHAR_T c);
+		bool IsMatchCurChar(SOURCE_CHAR_T c);
+		bool IsMatchCurCharAndStepOnce(SOURCE_CHAR_T c);
+
+		SOURCE_CHAR_T GetCurCharAndStepOnce();
+		SOURCE_CHAR_T GetCurChar();
 
-		CHAR_T GetCurCharAndStepOnce();
-		CHAR_T GetCurChar();
+		// advance to the next c or to the end of source,counting the newlines skipped on the way
+		void SkipUntil(SOURCE_CHAR_T c);
 
 		void AddToken(TokenKind type);
-		void AddToken(TokenKind type, STRING_VIEW literal);
+		void AddToken(TokenKind type, SOURCE_STRING_VIEW literal);
+
+		// the shared atom table locks,repeated identifiers of a scan are looked up here first
+		Atom InternAtom(SOURCE_STRING_VIEW literal);
 
 		bool IsAtEnd();
 
-		bool IsNumber(CHAR_T c);
-		bool IsLetter(CHAR_T c, bool isAscii);
-		bool IsLetterOrNumber(CHAR_T c, bool isAscii);
+		bool IsNumber(SOURCE_CHAR_T c);
+		bool IsLetter(SOURCE_CHAR_T c);
+		bool IsUnicodeLetter(uint32_t codePoint);
+
+		// decode the multibyte sequence at the current position,only done where identifiers need unicode classification
+		uint32_t DecodeCurCodePoint(size_t &length);
 
 		void Number();
 		void Identifier();
@@ -44,9 +79,28 @@ namespace CynicScript
 
 		uint64_t mStartPos;
 		uint64_t mCurPos;
+		uint64_t mEndPos;
 		uint64_t mLine;
 		uint64_t mColumn;
-		STRING mSource;
+		SOURCE_STRING_VIEW mSource;	 // utf-8 source being scanned,token literals are views into it
+		uint32_t mSourceId{0};		 // carried by the tokens of a scanned file,see Logger::RecordSourceFile()
+		SOURCE_STRING mSourceBuffer; // backs mSource for sources passed by value
+		MappedFile mMappedSource;	 // backs mSource for sources scanned from a file
+		Arena mTokenArena;			 // tokens of the current source,released together with its backing storage on the next scan
 		std::vector<Token *> mTokens;
+		std::unordered_map<SOURCE_STRING_VIEW, Atom> mAtomCache; // identifiers of the current source,keys view into it
+
+		size_t mParallelThreshold{LEXER_PARALLEL_THRESHOLD_DEFAULT};
+		size_t mParallelWorkerCount{0};
+		std::vector<std::unique_ptr<Lexer>> mWorkers; // chunk lexers of a parallel scan,own the arenas its tokens live in
+
+		struct LexError
+		{
+			uint64_t pos;
+			STRING message;
+		};
+
+		bool mDeferErrors{false};		 // set on the workers of a parallel scan,they must not log or exit from their thread
+		std::optional<LexError> mError; // first error of a worker
 	};
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <iostream>
 #include "Utils.h"
 #include "Logger.h"
+#include "Allocator.h"
+#include "HeapSnapshot.h"
 
 #define PRINT_LAMBDA(fn) [](Value *args, uint32_t argCount, const Token *relatedToken, Value &result) -> bool \
 {                                                                                                             \
@@ -74,12 +76,33 @@ namespace CynicScript
         mLibraries.emplace_back(libraryClass);
     }
 
+    void LibraryManager::RegisterLibrary(STRING_VIEW name, void (*loadMembers)(ClassObject *libraryClass))
+    {
+        auto libraryClass = new ClassObject(name);
+        libraryClass->memberLoader = loadMembers;
+        RegisterLibrary(libraryClass);
+    }
+
     const std::vector<ClassObject *> &LibraryManager::GetLibraries() const
     {
         return mLibraries;
     }
 
     LibraryManager::LibraryManager()
+    {
+        RegisterLibrary(TEXT("io"), LoadIoLibrary);
+        RegisterLibrary(TEXT("ds"), LoadDsLibrary);
+        RegisterLibrary(TEXT("mem"), LoadMemLibrary);
+        RegisterLibrary(TEXT("time"), LoadTimeLibrary);
+    }
+
+    void LibraryManager::LoadIoLibrary(ClassObject *ioClass)
+    {
+        ioClass->members[TEXT("print")] = new NativeFunctionObject(PRINT_LAMBDA(Logger::Print));
+        ioClass->members[TEXT("println")] = new NativeFunctionObject(PRINT_LAMBDA(Logger::Println));
+    }
+
+    void LibraryManager::LoadDsLibrary(ClassObject *dsClass)
     {
         const auto SizeOfFunction = new NativeFunctionObject([](Value *args, uint32_t argCount, const Token *relatedToken, Value &result) -> bool
                                                              {
@@ -210,6 +233,13 @@ namespace CynicScript
                                                                 return true;
                                                             });
 
+        dsClass->members[TEXT("sizeof")] = SizeOfFunction;
+        dsClass->members[TEXT("insert")] = InsertFunction;
+        dsClass->members[TEXT("erase")] = EraseFunction;
+    }
+
+    void LibraryManager::LoadMemLibrary(ClassObject *memClass)
+    {
         const auto AddressOfFunction = new NativeFunctionObject([](Value *args, uint32_t argCount, const Token *relatedToken, Value &result) -> bool
                                                                 {
                                                                     if (args == nullptr || argCount != 1)
@@ -222,31 +252,125 @@ namespace CynicScript
                                                                     return true;
                                                                 });
 
-        const auto ClockFunction = new NativeFunctionObject([](Value *args, uint32_t argCount, const Token *relatedToken, Value &result) -> bool
+        const auto GCStatsFunction = new NativeFunctionObject([](Value *, uint32_t argCount, const Token *relatedToken, Value &result) -> bool
+                                                              {
+                                                                  if (argCount != 0)
+                                                                      CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("[Native function 'gcstats']:Expect no argument."));
+
+                                                                  auto stats = Allocator::GetInstance()->GetGCStats();
+
+                                                                  // keep the result struct on stack while creating its children,creating an object may trigger a gc
+                                                                  auto statsStruct = Allocator::GetInstance()->CreateObject<StructObject>();
+                                                                  PUSH_STACK(statsStruct);
+
+                                                                  statsStruct->elements[TEXT("collections")] = Value((int64_t)stats.collectionCount);
+                                                                  statsStruct->elements[TEXT("pauseTotalNs")] = Value((int64_t)stats.totalPauseNs);
+                                                                  statsStruct->elements[TEXT("pauseMaxNs")] = Value((int64_t)stats.maxPauseNs);
+                                                                  statsStruct->elements[TEXT("bytesAllocated")] = Value((int64_t)stats.totalBytesAllocated);
+                                                                  statsStruct->elements[TEXT("bytesFreed")] = Value((int64_t)stats.totalBytesFreed);
+                                                                  statsStruct->elements[TEXT("objectsAllocated")] = Value((int64_t)stats.totalObjectsAllocated);
+                                                                  statsStruct->elements[TEXT("objectsFreed")] = Value((int64_t)stats.totalObjectsFreed);
+                                                                  statsStruct->elements[TEXT("heapBytes")] = Value((int64_t)stats.heapBytes);
+                                                                  statsStruct->elements[TEXT("peakHeapBytes")] = Value((int64_t)stats.peakHeapBytes);
+                                                                  statsStruct->elements[TEXT("nextGCBytes")] = Value((int64_t)stats.nextGCBytes);
+
+                                                                  auto histogram = Allocator::GetInstance()->CreateObject<ArrayObject>();
+                                                                  for (const auto &count : stats.pauseHistogram)
+                                                                      histogram->elements.emplace_back((int64_t)count);
+                                                                  statsStruct->elements[TEXT("pauseHistogram")] = histogram;
+
+                                                                  auto liveObjects = Allocator::GetInstance()->CreateObject<StructObject>();
+                                                                  for (size_t i = 0; i < OBJECT_KIND_COUNT; ++i)
+                                                                      liveObjects->elements[STRING(ObjectKindToString((ObjectKind)i))] = Value((int64_t)stats.liveObjectCount[i]);
+                                                                  statsStruct->elements[TEXT("liveObjects")] = liveObjects;
+
+                                                                  POP_STACK();
+
+                                                                  result = statsStruct;
+                                                                  return true;
+                                                              });
+
+        const auto HeapProfileFunction = new NativeFunctionObject([](Value *args, uint32_t argCount, const Token *relatedToken, Value &) -> bool
+                                                                  {
+                                                                      if (args == nullptr || argCount != 1 || !CYS_IS_STR_VALUE(args[0]))
+                                                                          CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("[Native function 'heapprofile']:Expect 1 string argument as the report path prefix."));
+#ifdef CYS_HEAP_PROFILE
+#ifdef CYS_UTF8_ENCODE
+                                                                      HeapProfiler::GetInstance()->WriteReports(Utf8::Encode(CYS_TO_STR_VALUE(args[0])->value));
+#else
+                                                                      HeapProfiler::GetInstance()->WriteReports(CYS_TO_STR_VALUE(args[0])->value);
+#endif
+#else
+                                                                      CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("[Native function 'heapprofile']:Heap profiler is not available,rebuild with CYS_HEAP_PROFILE."));
+#endif
+                                                                      return false;
+                                                                  });
+
+        const auto HeapSnapshotFunction = new NativeFunctionObject([](Value *args, uint32_t argCount, const Token *relatedToken, Value &) -> bool
+                                                                   {
+                                                                       if (args == nullptr || argCount != 1 || !CYS_IS_STR_VALUE(args[0]))
+                                                                           CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("[Native function 'heapsnapshot']:Expect 1 string argument as the snapshot file path."));
+#ifdef CYS_UTF8_ENCODE
+                                                                       HeapSnapshot::Capture().Save(Utf8::Encode(CYS_TO_STR_VALUE(args[0])->value));
+#else
+                                                                       HeapSnapshot::Capture().Save(CYS_TO_STR_VALUE(args[0])->value);
+#endif
+                                                                       return false;
+                                                                   });
+
+        const auto WeakRefFunction = new NativeFunctionObject([](Value *args, uint32_t argCount, const Token *relatedToken, Value &result) -> bool
+                                                              {
+                                                                  if (args == nullptr || argCount != 1)
+                                                                      CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("[Native function 'weakref']:Expect 1 arguments."));
+
+                                                                  if (!CYS_IS_OBJECT_VALUE(args[0]))
+                                                                      CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("[Native function 'weakref']:The arg0 is a value,only object can be weakly referenced."));
+
+                                                                  result = Allocator::GetInstance()->CreateObject<WeakRefObject>(args[0].object);
+                                                                  return true;
+                                                              });
+
+        const auto DerefFunction = new NativeFunctionObject([](Value *args, uint32_t argCount, const Token *relatedToken, Value &result) -> bool
                                                             {
-                                                                result = Value((double)clock() / CLOCKS_PER_SEC);
+                                                                if (args == nullptr || argCount != 1 || !CYS_IS_WEAK_REF_VALUE(args[0]))
+                                                                    CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("[Native function 'deref']:Expect 1 weakref argument."));
+
+                                                                auto target = CYS_TO_WEAK_REF_VALUE(args[0])->target;
+                                                                if (target == nullptr)
+                                                                    return false;
+
+                                                                result = target;
                                                                 return true;
                                                             });
 
-        auto ioClass = new ClassObject(TEXT("io"));
-        auto dsClass = new ClassObject(TEXT("ds"));
-        auto memClass = new ClassObject(TEXT("mem"));
-        auto timeClass = new ClassObject(TEXT("time"));
+        const auto WeakDictFunction = new NativeFunctionObject([](Value *, uint32_t argCount, const Token *relatedToken, Value &result) -> bool
+                                                               {
+                                                                   if (argCount != 0)
+                                                                       CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("[Native function 'weakdict']:Expect no argument."));
 
-        ioClass->members[TEXT("print")] = new NativeFunctionObject(PRINT_LAMBDA(Logger::Print));
-        ioClass->members[TEXT("println")] = new NativeFunctionObject(PRINT_LAMBDA(Logger::Println));
-
-        dsClass->members[TEXT("sizeof")] = SizeOfFunction;
-        dsClass->members[TEXT("insert")] = InsertFunction;
-        dsClass->members[TEXT("erase")] = EraseFunction;
+                                                                   auto dict = Allocator::GetInstance()->CreateObject<DictObject>();
+                                                                   dict->weakKeys = true;
+                                                                   result = dict;
+                                                                   return true;
+                                                               });
 
         memClass->members[TEXT("addressof")] = AddressOfFunction;
+        memClass->members[TEXT("gcstats")] = GCStatsFunction;
+        memClass->members[TEXT("heapprofile")] = HeapProfileFunction;
+        memClass->members[TEXT("heapsnapshot")] = HeapSnapshotFunction;
+        memClass->members[TEXT("weakref")] = WeakRefFunction;
+        memClass->members[TEXT("deref")] = DerefFunction;
+        memClass->members[TEXT("weakdict")] = WeakDictFunction;
+    }
 
-        timeClass->members[TEXT("clock")] = ClockFunction;
+    void LibraryManager::LoadTimeLibrary(ClassObject *timeClass)
+    {
+        const auto ClockFunction = new NativeFunctionObject([](Value *, uint32_t, const Token *, Value &result) -> bool
+                                                            {
+                                                                result = Value((double)clock() / CLOCKS_PER_SEC);
+                                                                return true;
+                                                            });
 
-        mLibraries.emplace_back(ioClass);
-        mLibraries.emplace_back(dsClass);
-        mLibraries.emplace_back(memClass);
-        mLibraries.emplace_back(timeClass);
+        timeClass->members[TEXT("clock")] = ClockFunction;
     }
 }
\ No newline at end of file
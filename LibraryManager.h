@@ -12,6 +12,9 @@ namespace CynicScript
         SINGLETON_DECL(LibraryManager)
 
         void RegisterLibrary(ClassObject *libraryClass);
+        // only the name is registered up front,the members are built the first time one of them is looked up,
+        // so libraries a script never touches cost nothing but their global slot
+        void RegisterLibrary(STRING_VIEW name, void (*loadMembers)(ClassObject *libraryClass));
 
         const std::vector<ClassObject *> &GetLibraries() const;
 
@@ -19,6 +22,11 @@ namespace CynicScript
         LibraryManager();
         ~LibraryManager() = default;
 
+        static void LoadIoLibrary(ClassObject *ioClass);
+        static void LoadDsLibrary(ClassObject *dsClass);
+        static void LoadMemLibrary(ClassObject *memClass);
+        static void LoadTimeLibrary(ClassObject *timeClass);
+
         std::vector<ClassObject *> mLibraries;
     };
 }
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <string>
 #include <cassert>
 #include <cstdarg>
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include "Token.h"
 #include "Utils.h"
 
@@ -21,7 +24,11 @@ namespace CynicScript
         namespace Record
         {
             inline STRING mCurFilePath = TEXT("interpreter");
-            inline STRING mSourceCode = TEXT("");
+            inline SOURCE_STRING_VIEW mSourceCode = ""; // utf-8 view of the source buffer retained by the lexer
+            inline std::atomic<uint64_t> mWarningCount{0}; // bumped by the compiler workers too
+            inline std::mutex mOutputMutex;                   // keeps the lines of one located message together
+            // path and source of each file scanned or loaded,tokens of imported files are reported against their own
+            inline std::deque<std::pair<STRING, SOURCE_STRING_VIEW>> mSourceFiles;
         }
 
         inline void Output(OSTREAM &os, STRING s)
@@ -57,38 +64,67 @@ namespace CynicScript
             Output(COUT, s, args...);
         }
 
-        inline void RecordSource(STRING_VIEW sourceCode)
+        inline void RecordSource(SOURCE_STRING_VIEW sourceCode)
         {
             Record::mSourceCode = sourceCode;
         }
 
+        inline void RecordFilePath(std::string_view path)
+        {
+#ifdef CYS_UTF8_ENCODE
+            Record::mCurFilePath = Utf8::Decode(std::string(path));
+#else
+            Record::mCurFilePath = path;
+#endif
+        }
+
+        // records the file like RecordFilePath() and RecordSource() and returns the id its tokens carry(see Token::sourceId).
+        // The source has to live as long as the tokens,like their literals
+        inline uint32_t RecordSourceFile(std::string_view path, SOURCE_STRING_VIEW sourceCode)
+        {
+            RecordFilePath(path);
+            RecordSource(sourceCode);
+            Record::mSourceFiles.emplace_back(Record::mCurFilePath, sourceCode);
+            return static_cast<uint32_t>(Record::mSourceFiles.size());
+        }
+
         template <typename... Args>
-        inline void AssemblyLogInfo(const STRING &headerHint, const STRING &colorHint, uint64_t lineNum, uint64_t column, uint64_t pos, const STRING &fmt, const Args &...args)
+        inline void AssemblyLogInfo(const STRING &headerHint, const STRING &colorHint, const STRING &filePath, SOURCE_STRING_VIEW sourceCode, uint64_t lineNum, uint64_t column, uint64_t pos, const STRING &fmt, const Args &...args)
         {
+            std::lock_guard<std::mutex> lock(Record::mOutputMutex);
+
             auto start = pos;
             auto end = pos;
 
-            if (Record::mCurFilePath != TEXT("interpreter"))
+            // programs loaded from binary files carry token locations but no source
+            if (pos > sourceCode.size())
+            {
+                auto startStr = headerHint + TEXT(":") + filePath + TEXT("(line ") + CYS_TO_STRING(lineNum) + TEXT(",column ") + CYS_TO_STRING(column) + TEXT("): ");
+                Println(TEXT("\033[{}m") + startStr + STRING(fmt) + TEXT("\033[0m"), colorHint, args...);
+                return;
+            }
+
+            if (filePath != TEXT("interpreter"))
             {
-                while ((Record::mSourceCode[start - 1] != TCHAR('\n') && Record::mSourceCode[start - 1] != TCHAR('\r')) && start - 1 > 0)
+                while (start > 0 && sourceCode[start - 1] != '\n' && sourceCode[start - 1] != '\r')
                     start--;
 
-                while ((Record::mSourceCode[end] != TCHAR('\n') && Record::mSourceCode[end] != TCHAR('\r')) && end < Record::mSourceCode.size())
+                while (end < sourceCode.size() && sourceCode[end] != '\n' && sourceCode[end] != '\r')
                     end++;
             }
             else
             {
                 start = 0;
-                end = Record::mSourceCode.size();
+                end = sourceCode.size();
             }
 
-            auto startStr = headerHint + TEXT(":") + Record::mCurFilePath + TEXT("(line ") + CYS_TO_STRING(lineNum) + TEXT(",column ") + CYS_TO_STRING(column) + TEXT("): ");
+            auto startStr = headerHint + TEXT(":") + filePath + TEXT("(line ") + CYS_TO_STRING(lineNum) + TEXT(",column ") + CYS_TO_STRING(column) + TEXT("): ");
 
-            auto lineSrcCode = Record::mSourceCode.substr(start, end - start);
+            auto lineSrcCode = SourceToString(sourceCode.substr(start, end - start));
 
             Println(TEXT("\033[{}m{}{}\033[0m"), colorHint, startStr, lineSrcCode);
 
-            auto blankSize = startStr.size() + pos - start;
+            auto blankSize = startStr.size() + SourceToString(sourceCode.substr(start, pos - start)).size();
 
             STRING errorHintStr;
             errorHintStr.insert(0, blankSize, TCHAR(' '));
@@ -121,19 +157,19 @@ namespace CynicScript
         {
             auto lineNum = 1;
             for (int32_t i = 0; i < pos; ++i)
-                if (Record::mSourceCode[i] == TCHAR('\n') || Record::mSourceCode[i] == TCHAR('\r'))
+                if (Record::mSourceCode[i] == '\n' || Record::mSourceCode[i] == '\r')
                     lineNum++;
 
             switch (logKind)
             {
             case Kind::INFO:
-                AssemblyLogInfo(TEXT("[INFO]"), TEXT("32"), lineNum, 1, pos, fmt, args...);
+                AssemblyLogInfo(TEXT("[INFO]"), TEXT("32"), Record::mCurFilePath, Record::mSourceCode, lineNum, 1, pos, fmt, args...);
                 break;
             case Kind::WARN:
-                AssemblyLogInfo(TEXT("[WARN]"), TEXT("33"), lineNum, 1, pos, fmt, args...);
+                AssemblyLogInfo(TEXT("[WARN]"), TEXT("33"), Record::mCurFilePath, Record::mSourceCode, lineNum, 1, pos, fmt, args...);
                 break;
             case Kind::ERROR:
-                AssemblyLogInfo(TEXT("[ERROR]"), TEXT("31"), lineNum, 1, pos, fmt, args...);
+                AssemblyLogInfo(TEXT("[ERROR]"), TEXT("31"), Record::mCurFilePath, Record::mSourceCode, lineNum, 1, pos, fmt, args...);
                 break;
             default:
                 break;
@@ -143,16 +179,18 @@ namespace CynicScript
         template <typename... Args>
         void Log(Kind logKind, const Token *tok, const STRING &fmt, const Args &...args)
         {
+            const auto &filePath = tok->sourceId != 0 ? Record::mSourceFiles[tok->sourceId - 1].first : Record::mCurFilePath;
+            auto sourceCode = tok->sourceId != 0 ? Record::mSourceFiles[tok->sourceId - 1].second : Record::mSourceCode;
             switch (logKind)
             {
             case Kind::INFO:
-                AssemblyLogInfo(TEXT("[INFO]"), TEXT("32"), tok->sourceLocation.line, tok->sourceLocation.column, tok->sourceLocation.pos, fmt, args...);
+                AssemblyLogInfo(TEXT("[INFO]"), TEXT("32"), filePath, sourceCode, tok->sourceLocation.line, tok->sourceLocation.column, tok->sourceLocation.pos, fmt, args...);
                 break;
             case Kind::WARN:
-                AssemblyLogInfo(TEXT("[WARN]"), TEXT("33"), tok->sourceLocation.line, tok->sourceLocation.column, tok->sourceLocation.pos, fmt, args...);
+                AssemblyLogInfo(TEXT("[WARN]"), TEXT("33"), filePath, sourceCode, tok->sourceLocation.line, tok->sourceLocation.column, tok->sourceLocation.pos, fmt, args...);
                 break;
             case Kind::ERROR:
-                AssemblyLogInfo(TEXT("[ERROR]"), TEXT("31"), tok->sourceLocation.line, tok->sourceLocation.column, tok->sourceLocation.pos, fmt, args...);
+                AssemblyLogInfo(TEXT("[ERROR]"), TEXT("31"), filePath, sourceCode, tok->sourceLocation.line, tok->sourceLocation.column, tok->sourceLocation.pos, fmt, args...);
                 break;
             default:
                 break;
@@ -195,12 +233,14 @@ namespace CynicScript
     do                                                                                 \
     {                                                                                  \
         CynicScript::Logger::Log(CynicScript::Logger::Kind::WARN, fmt, ##__VA_ARGS__); \
+        CynicScript::Logger::Record::mWarningCount++;                                  \
     } while (false)
 
 #define CYS_LOG_WARN_WITH_LOC(tokOrPos, fmt, ...)                                                \
     do                                                                                           \
     {                                                                                            \
         CynicScript::Logger::Log(CynicScript::Logger::Kind::WARN, tokOrPos, fmt, ##__VA_ARGS__); \
+        CynicScript::Logger::Record::mWarningCount++;                                            \
     } while (false)
 
 #define CYS_LOG_INFO(fmt, ...)                                                         \
@@ -0,0 +1,122 @@
+#include "MappedFile.h"
+#if defined(_WIN32) || defined(_WIN64)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace CynicScript
+{
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+	bool MappedFile::Open(std::string_view path)
+	{
+		Close();
+#if defined(_WIN32) || defined(_WIN64)
+		auto widePath = Utf8::Decode(std::string(path));
+		HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size))
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		mFileHandle = file;
+		mSize = static_cast<size_t>(size.QuadPart);
+		mIsOpen = true;
+		if (mSize == 0) // empty files can't be mapped
+			return true;
+
+		HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr)
+		{
+			Close();
+			return false;
+		}
+		mMappingHandle = mapping;
+
+		mData = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (mData == nullptr)
+		{
+			Close();
+			return false;
+		}
+#else
+		int fd = open(std::string(path).c_str(), O_RDONLY);
+		if (fd == -1)
+			return false;
+
+		struct stat status;
+		if (fstat(fd, &status) == -1)
+		{
+			close(fd);
+			return false;
+		}
+
+		mSize = static_cast<size_t>(status.st_size);
+		mIsOpen = true;
+		if (mSize == 0) // empty files can't be mapped
+		{
+			close(fd);
+			return true;
+		}
+
+		void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping keeps its own reference to the file
+		if (data == MAP_FAILED)
+		{
+			mSize = 0;
+			mIsOpen = false;
+			return false;
+		}
+		madvise(data, mSize, MADV_SEQUENTIAL);
+		mData = static_cast<const uint8_t *>(data);
+#endif
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+#if defined(_WIN32) || defined(_WIN64)
+		if (mData)
+			UnmapViewOfFile(mData);
+		if (mMappingHandle)
+			CloseHandle(mMappingHandle);
+		if (mFileHandle)
+			CloseHandle(mFileHandle);
+		mMappingHandle = nullptr;
+		mFileHandle = nullptr;
+#else
+		if (mData)
+			munmap(const_cast<uint8_t *>(mData), mSize);
+#endif
+		mData = nullptr;
+		mSize = 0;
+		mIsOpen = false;
+	}
+
+	bool MappedFile::IsOpen() const
+	{
+		return mIsOpen;
+	}
+
+	const uint8_t *MappedFile::GetData() const
+	{
+		return mData;
+	}
+
+	size_t MappedFile::GetSize() const
+	{
+		return mSize;
+	}
+}
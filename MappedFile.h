@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include "Utils.h"
+
+namespace CynicScript
+{
+	// Read-only memory mapping of a whole file,the content stays valid until Close() or destruction.
+	class CYS_API MappedFile
+	{
+		NON_COPYABLE(MappedFile)
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		bool Open(std::string_view path);
+		void Close();
+
+		bool IsOpen() const;
+
+		const uint8_t *GetData() const;
+		size_t GetSize() const;
+
+	private:
+		const uint8_t *mData{nullptr};
+		size_t mSize{0};
+		bool mIsOpen{false};
+#if defined(_WIN32) || defined(_WIN64)
+		void *mFileHandle{nullptr};
+		void *mMappingHandle{nullptr};
+#endif
+	};
+}
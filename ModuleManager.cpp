@@ -0,0 +1,43 @@
+#include "ModuleManager.h"
+#include "Logger.h"
+
+namespace CynicScript
+{
+    SINGLETON_IMPL(ModuleManager)
+
+    void ModuleManager::SetLoader(ModuleLoader loader)
+    {
+        mLoader = loader;
+    }
+
+    void ModuleManager::SetSearchDirectory(std::string_view directory)
+    {
+        mSearchDirectory = directory;
+    }
+
+    std::string ModuleManager::Resolve(const STRING &importPath, std::string_view importerPath) const
+    {
+        auto path = std::filesystem::path(StringToSource(importPath));
+        if (path.is_relative())
+            path = (importerPath.empty() ? mSearchDirectory : std::filesystem::path(importerPath).parent_path()) / path;
+
+        // every spelling of the same file shares one module
+        std::error_code error;
+        auto canonicalPath = std::filesystem::weakly_canonical(path, error);
+        return error ? path.lexically_normal().string() : canonicalPath.string();
+    }
+
+    FunctionObject *ModuleManager::GetModuleFunction(const std::string &path, const Token *relatedToken)
+    {
+        auto iter = mModuleFunctions.find(path);
+        if (iter != mModuleFunctions.end())
+            return iter->second;
+
+        if (!mLoader)
+            CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("Cannot import {},imports are not available here."), SourceToString(path));
+
+        auto function = mLoader(path);
+        mModuleFunctions.emplace(path, function);
+        return function;
+    }
+}
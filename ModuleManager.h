@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <functional>
+#include <filesystem>
+#include <unordered_map>
+#include "Object.h"
+#include "Utils.h"
+namespace CynicScript
+{
+    // Files brought in by import statements.The importing chunk only holds the path,the file is compiled into a module
+    // function the first time an import of it runs and that function is kept for the rest of the process,the module
+    // object it returns is kept by the allocator(see OP_IMPORT)
+    class CYS_API ModuleManager
+    {
+    public:
+        SINGLETON_DECL(ModuleManager)
+
+        // compiles or loads the module function of the file at an absolute path,errors are fatal
+        using ModuleLoader = std::function<FunctionObject *(std::string_view path)>;
+
+        void SetLoader(ModuleLoader loader);
+        // relative import paths are resolved against the directory of the file the import is written in,this one is used
+        // when that file is not known(the REPL or a program loaded from a binary file),usually the directory of the main
+        // script.The working directory by default
+        void SetSearchDirectory(std::string_view directory);
+
+        // absolute path of the file an import statement of the importing file refers to,an empty importer path stands
+        // for the search directory
+        std::string Resolve(const STRING &importPath, std::string_view importerPath) const;
+        FunctionObject *GetModuleFunction(const std::string &path, const Token *relatedToken);
+
+    private:
+        ModuleManager() = default;
+        ~ModuleManager() = default;
+
+        ModuleLoader mLoader;
+        std::filesystem::path mSearchDirectory;
+        std::unordered_map<std::string, FunctionObject *> mModuleFunctions;
+    };
+}
@@ -1,11 +1,63 @@
 #include "Object.h"
+#include <type_traits>
+#include <algorithm>
 #include "Chunk.h"
 #include "Utils.h"
 #include "Logger.h"
 #include "Allocator.h"
+#include "BytecodeImage.h"
 namespace CynicScript
 {
 
+	struct ObjectDispatchTable
+	{
+		void (*destroy)(Object *object);
+		STRING (*toString)(const Object *object);
+		void (*blacken)(Object *object); // nullptr if the kind holds no reference
+		bool (*isEqualTo)(Object *object, Object *other);
+		void (*serialize)(const Object *object, BytecodeWriter &writer);
+		size_t size;
+	};
+
+	template <typename T>
+	constexpr ObjectDispatchTable MakeObjectDispatchTable()
+	{
+		ObjectDispatchTable table{};
+		table.destroy = [](Object *object)
+		{ delete static_cast<T *>(object); };
+		table.toString = [](const Object *object)
+		{ return static_cast<const T *>(object)->ToString(); };
+		if constexpr (!std::is_same_v<decltype(&T::Blacken), void (Object::*)()>)
+			table.blacken = [](Object *object)
+			{ static_cast<T *>(object)->Blacken(); };
+		table.isEqualTo = [](Object *object, Object *other)
+		{ return static_cast<T *>(object)->IsEqualTo(other); };
+		table.serialize = [](const Object *object, BytecodeWriter &writer)
+		{ static_cast<const T *>(object)->Serialize(writer); };
+		table.size = sizeof(T);
+		return table;
+	}
+
+	// indexed by ObjectKind,keep the same order as the enum
+	constexpr ObjectDispatchTable gObjectDispatchTables[] = {
+		MakeObjectDispatchTable<StrObject>(),
+		MakeObjectDispatchTable<ArrayObject>(),
+		MakeObjectDispatchTable<DictObject>(),
+		MakeObjectDispatchTable<StructObject>(),
+		MakeObjectDispatchTable<FunctionObject>(),
+		MakeObjectDispatchTable<UpValueObject>(),
+		MakeObjectDispatchTable<ClosureObject>(),
+		MakeObjectDispatchTable<NativeFunctionObject>(),
+		MakeObjectDispatchTable<RefObject>(),
+		MakeObjectDispatchTable<ClassObject>(),
+		MakeObjectDispatchTable<ClassClosureBindObject>(),
+		MakeObjectDispatchTable<EnumObject>(),
+		MakeObjectDispatchTable<ModuleObject>(),
+		MakeObjectDispatchTable<WeakRefObject>(),
+	};
+
+	static_assert(sizeof(gObjectDispatchTables) / sizeof(ObjectDispatchTable) == OBJECT_KIND_COUNT, "Missing dispatch table of object kind");
+
 	Object::Object(ObjectKind kind)
 		: kind(kind), marked(false), next(nullptr)
 	{
@@ -14,15 +66,37 @@ namespace CynicScript
 	{
 	}
 
+	STRING Object::ToString() const
+	{
+		return gObjectDispatchTables[kind].toString(this);
+	}
+
+	bool Object::IsEqualTo(Object *other)
+	{
+		return gObjectDispatchTables[kind].isEqualTo(this, other);
+	}
+
+	void Object::Serialize(BytecodeWriter &writer) const
+	{
+		gObjectDispatchTables[kind].serialize(this, writer);
+	}
+
 	void Object::Mark()
 	{
+		auto allocator = Allocator::GetInstance();
+		if (allocator->mTracedReferences) // tracing for a heap snapshot,report the reference and leave the mark state untouched
+		{
+			allocator->mTracedReferences->emplace_back(this);
+			return;
+		}
+
 		if (marked)
 			return;
 #ifdef CYS_GC_DEBUG
 		Logger::Info(TEXT("(0x{}) mark: {}"), (void *)this, ToString());
 #endif
 		marked = true;
-		Allocator::GetInstance()->mGrayObjects.emplace_back(this);
+		allocator->mGrayObjects.emplace_back(this);
 	}
 	void Object::UnMark()
 	{
@@ -39,6 +113,8 @@ namespace CynicScript
 #ifdef CYS_GC_DEBUG
 		Logger::Info(TEXT("(0x{}) blacken: {}"), (void *)this, ToString());
 #endif
+		if (gObjectDispatchTables[kind].blacken)
+			gObjectDispatchTables[kind].blacken(this);
 	}
 
 	StrObject::StrObject(STRING_VIEW value)
@@ -60,9 +136,16 @@ namespace CynicScript
 		return value == CYS_TO_STR_OBJ(other)->value;
 	}
 
-	std::vector<uint8_t> StrObject::Serialize() const
+	void StrObject::Serialize(BytecodeWriter &writer) const
+	{
+		writer.WriteU8(Allocator::GetInstance()->IsInterned(this) ? 1 : 0);
+		writer.WriteString(StringToSource(value));
+	}
+
+	void StrObject::Deserialize(const BytecodeImage &image, size_t &offset)
 	{
-		return std::vector<uint8_t>();
+		image.ReadU8(offset); // interned or not,see DeserializeObject()
+		value = SourceToString(image.ReadString(offset));
 	}
 
 	ArrayObject::ArrayObject()
@@ -92,7 +175,6 @@ namespace CynicScript
 
 	void ArrayObject::Blacken()
 	{
-		Object::Blacken();
 		for (auto &e : elements)
 			e.Mark();
 	}
@@ -114,9 +196,8 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> ArrayObject::Serialize() const
+	void ArrayObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	DictObject::DictObject()
@@ -143,7 +224,25 @@ namespace CynicScript
 
 	void DictObject::Blacken()
 	{
-		Object::Blacken();
+		if (weakKeys)
+		{
+			// object keys are not traced,their values are marked later by the collector's ephemeron pass once the key is known to be alive
+			auto allocator = Allocator::GetInstance();
+			if (!allocator->mTracedReferences)
+				allocator->mWeakKeyDicts.emplace_back(this);
+			for (auto &[k, v] : elements)
+			{
+				if (!CYS_IS_OBJECT_VALUE(k))
+				{
+					k.Mark();
+					v.Mark();
+				}
+				else if (allocator->mTracedReferences)
+					v.Mark();
+			}
+			return;
+		}
+
 		for (auto &[k, v] : elements)
 		{
 			k.Mark();
@@ -176,9 +275,8 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> DictObject::Serialize() const
+	void DictObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	StructObject::StructObject()
@@ -205,7 +303,6 @@ namespace CynicScript
 
 	void StructObject::Blacken()
 	{
-		Object::Blacken();
 		for (auto &[k, v] : elements)
 			v.Mark();
 	}
@@ -233,9 +330,8 @@ namespace CynicScript
 
 		return true;
 	}
-	std::vector<uint8_t> StructObject::Serialize() const
+	void StructObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	FunctionObject::FunctionObject()
@@ -263,7 +359,6 @@ namespace CynicScript
 
 	void FunctionObject::Blacken()
 	{
-		Object::Blacken();
 		for (auto &c : chunk.constants)
 			c.Mark();
 
@@ -293,9 +388,22 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> FunctionObject::Serialize() const
+	void FunctionObject::Serialize(BytecodeWriter &writer) const
+	{
+		writer.WriteVarUint(arity);
+		writer.WriteU8(static_cast<uint8_t>(varArg));
+		writer.WriteU8(static_cast<uint8_t>(upValueCount));
+		writer.WriteString(StringToSource(name));
+		chunk.Serialize(writer);
+	}
+
+	void FunctionObject::Deserialize(const BytecodeImage &image, size_t &offset)
 	{
-		return std::vector<uint8_t>();
+		arity = static_cast<uint16_t>(image.ReadVarUint(offset));
+		varArg = static_cast<VarArg>(image.ReadU8(offset));
+		upValueCount = static_cast<int8_t>(image.ReadU8(offset));
+		name = SourceToString(image.ReadString(offset));
+		chunk.Deserialize(image, offset);
 	}
 
 #ifdef CYS_FUNCTION_CACHE_OPT
@@ -335,7 +443,6 @@ namespace CynicScript
 
 	void UpValueObject::Blacken()
 	{
-		Object::Blacken();
 		closed.Mark();
 	}
 
@@ -355,9 +462,8 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> UpValueObject::Serialize() const
+	void UpValueObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	ClosureObject::ClosureObject()
@@ -380,7 +486,6 @@ namespace CynicScript
 
 	void ClosureObject::Blacken()
 	{
-		Object::Blacken();
 		function->Mark();
 		for (int32_t i = 0; i < upvalues.size(); ++i)
 			if (upvalues[i])
@@ -403,9 +508,8 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> ClosureObject::Serialize() const
+	void ClosureObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	NativeFunctionObject::NativeFunctionObject()
@@ -432,9 +536,8 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> NativeFunctionObject::Serialize() const
+	void NativeFunctionObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	RefObject::RefObject(Value *pointer)
@@ -457,9 +560,8 @@ namespace CynicScript
 		return *pointer == *CYS_TO_REF_OBJ(other)->pointer;
 	}
 
-	std::vector<uint8_t> RefObject::Serialize() const
+	void RefObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	ClassObject::ClassObject()
@@ -478,6 +580,8 @@ namespace CynicScript
 
 	STRING ClassObject::ToString() const
 	{
+		const_cast<ClassObject *>(this)->LoadMembers();
+
 		STRING result = TEXT("class ") + name;
 		if (!parents.empty())
 		{
@@ -495,7 +599,6 @@ namespace CynicScript
 
 	void ClassObject::Blacken()
 	{
-		Object::Blacken();
 		for (auto &[k, v] : members)
 			v.Mark();
 		for (auto &[k, v] : parents)
@@ -511,6 +614,8 @@ namespace CynicScript
 		auto klass = CYS_TO_CLASS_OBJ(other);
 		if (name != klass->name)
 			return false;
+		LoadMembers();
+		klass->LoadMembers();
 		if (members != klass->members)
 			return false;
 		if (parents != klass->parents)
@@ -518,13 +623,14 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> ClassObject::Serialize() const
+	void ClassObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	bool ClassObject::GetMember(const STRING &name, Value &retV)
 	{
+		LoadMembers();
+
 		auto iter = members.find(name);
 		if (iter != members.end())
 		{
@@ -591,7 +697,6 @@ namespace CynicScript
 
 	void ClassClosureBindObject::Blacken()
 	{
-		Object::Blacken();
 		receiver.Mark();
 		closure->Mark();
 	}
@@ -608,9 +713,8 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> ClassClosureBindObject::Serialize() const
+	void ClassClosureBindObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	EnumObject::EnumObject()
@@ -640,7 +744,6 @@ namespace CynicScript
 
 	void EnumObject::Blacken()
 	{
-		Object::Blacken();
 		for (auto &[k, v] : pairs)
 			v.Mark();
 	}
@@ -668,9 +771,35 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> EnumObject::Serialize() const
+	void EnumObject::Serialize(BytecodeWriter &writer) const
+	{
+		writer.WriteString(StringToSource(name));
+
+		// sorted by key so the same enum always serializes to the same bytes
+		std::vector<std::pair<STRING, Value>> sortedPairs(pairs.begin(), pairs.end());
+		std::sort(sortedPairs.begin(), sortedPairs.end(), [](const auto &left, const auto &right)
+				  { return left.first < right.first; });
+
+		writer.WriteVarUint(sortedPairs.size());
+		for (const auto &[k, v] : sortedPairs)
+		{
+			writer.WriteString(StringToSource(k));
+			v.Serialize(writer);
+		}
+	}
+
+	void EnumObject::Deserialize(const BytecodeImage &image, size_t &offset)
 	{
-		return std::vector<uint8_t>();
+		name = SourceToString(image.ReadString(offset));
+
+		auto pairCount = image.ReadVarUint(offset);
+		for (uint64_t i = 0; i < pairCount; ++i)
+		{
+			auto key = SourceToString(image.ReadString(offset));
+			Value value;
+			value.Deserialize(image, offset);
+			pairs[key] = value;
+		}
 	}
 
 	ModuleObject::ModuleObject()
@@ -701,7 +830,6 @@ namespace CynicScript
 
 	void ModuleObject::Blacken()
 	{
-		Object::Blacken();
 		for (auto &[k, v] : values)
 			v.Mark();
 	}
@@ -718,9 +846,8 @@ namespace CynicScript
 		return true;
 	}
 
-	std::vector<uint8_t> ModuleObject::Serialize() const
+	void ModuleObject::Serialize(BytecodeWriter &) const
 	{
-		return std::vector<uint8_t>();
 	}
 
 	bool ModuleObject::GetMember(const STRING &name, Value &retV)
@@ -734,4 +861,118 @@ namespace CynicScript
 		return false;
 	}
 
-}
\ No newline at end of file
+	WeakRefObject::WeakRefObject()
+		: Object(ObjectKind::WEAK_REF)
+	{
+	}
+	WeakRefObject::WeakRefObject(Object *target)
+		: Object(ObjectKind::WEAK_REF), target(target)
+	{
+	}
+	WeakRefObject::~WeakRefObject()
+	{
+	}
+
+	STRING WeakRefObject::ToString() const
+	{
+		if (target == nullptr)
+			return TEXT("<weakref null>");
+		return TEXT("<weakref 0x") + PointerAddressToString((void *)target) + TEXT(">");
+	}
+
+	void WeakRefObject::Blacken()
+	{
+		auto allocator = Allocator::GetInstance();
+		if (!allocator->mTracedReferences && target != nullptr)
+			allocator->mWeakRefs.emplace_back(this);
+	}
+
+	bool WeakRefObject::IsEqualTo(Object *other)
+	{
+		if (!CYS_IS_WEAK_REF_OBJ(other))
+			return false;
+		return target == CYS_TO_WEAK_REF_OBJ(other)->target;
+	}
+
+	void WeakRefObject::Serialize(BytecodeWriter &) const
+	{
+	}
+
+	Object *DeserializeObject(const BytecodeImage &image, size_t &offset)
+	{
+		// allocated outside the gc like the constants of the compiler,they live as long as the chunk referring to them
+		auto kind = image.ReadU8(offset);
+		switch (kind)
+		{
+		case ObjectKind::STR:
+		{
+			// names are interned again,a literal gets an object of its own as it does from the compiler
+			if (image.ReadU8(offset) != 0)
+				return image.ReadStrObject(offset);
+			return new StrObject(SourceToString(image.ReadString(offset)));
+		}
+		case ObjectKind::FUNCTION:
+		{
+			auto function = new FunctionObject();
+			function->Deserialize(image, offset);
+			return function;
+		}
+		case ObjectKind::ENUM:
+		{
+			auto enumObj = new EnumObject();
+			enumObj->Deserialize(image, offset);
+			return enumObj;
+		}
+		default:
+			CYS_LOG_ERROR(TEXT("Cannot deserialize object of kind {},only constant objects are serializable"), kind);
+			return nullptr;
+		}
+	}
+
+	STRING_VIEW ObjectKindToString(ObjectKind kind)
+	{
+		switch (kind)
+		{
+		case ObjectKind::STR:
+			return TEXT("str");
+		case ObjectKind::ARRAY:
+			return TEXT("array");
+		case ObjectKind::DICT:
+			return TEXT("dict");
+		case ObjectKind::STRUCT:
+			return TEXT("struct");
+		case ObjectKind::FUNCTION:
+			return TEXT("function");
+		case ObjectKind::UPVALUE:
+			return TEXT("upvalue");
+		case ObjectKind::CLOSURE:
+			return TEXT("closure");
+		case ObjectKind::NATIVE_FUNCTION:
+			return TEXT("native_function");
+		case ObjectKind::REF:
+			return TEXT("ref");
+		case ObjectKind::CLASS:
+			return TEXT("class");
+		case ObjectKind::CLASS_CLOSURE_BIND:
+			return TEXT("class_closure_bind");
+		case ObjectKind::ENUM:
+			return TEXT("enum");
+		case ObjectKind::MODULE:
+			return TEXT("module");
+		case ObjectKind::WEAK_REF:
+			return TEXT("weakref");
+		default:
+			return TEXT("unknown");
+		}
+	}
+
+	size_t SizeOfObject(const Object *object)
+	{
+		return gObjectDispatchTables[object->kind].size;
+	}
+
+	void DestroyObject(Object *object)
+	{
+		gObjectDispatchTables[object->kind].destroy(object);
+	}
+}
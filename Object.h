@@ -22,6 +22,7 @@ namespace CynicScript
 #define CYS_IS_CLASS_CLOSURE_BIND_OBJ(obj) ((obj)->kind == ::CynicScript::ObjectKind::CLASS_CLOSURE_BIND)
 #define CYS_IS_ENUM_OBJ(obj) ((obj)->kind == ::CynicScript::ObjectKind::ENUM)
 #define CYS_IS_MODULE_OBJ(obj) ((obj)->kind == ::CynicScript::ObjectKind::MODULE)
+#define CYS_IS_WEAK_REF_OBJ(obj) ((obj)->kind == ::CynicScript::ObjectKind::WEAK_REF)
 
 #define CYS_TO_STR_OBJ(obj) ((::CynicScript::StrObject *)(obj))
 #define CYS_TO_ARRAY_OBJ(obj) ((::CynicScript::ArrayObject *)(obj))
@@ -36,6 +37,7 @@ namespace CynicScript
 #define CYS_TO_CLASS_CLOSURE_BIND_OBJ(obj) ((::CynicScript::ClassClosureBindObject *)(obj))
 #define CYS_TO_ENUM_OBJ(obj) ((::CynicScript::EnumObject *)(obj))
 #define CYS_TO_MODULE_OBJ(obj) ((::CynicScript::ModuleObject *)(obj))
+#define CYS_TO_WEAK_REF_OBJ(obj) ((::CynicScript::WeakRefObject *)(obj))
 
 #define CYS_IS_NULL_VALUE(v) ((v).kind == ::CynicScript::ValueKind::NIL)
 #define CYS_IS_INT_VALUE(v) ((v).kind == ::CynicScript::ValueKind::INT)
@@ -55,6 +57,7 @@ namespace CynicScript
 #define CYS_IS_CLASS_CLOSURE_BIND_VALUE(v) (CYS_IS_OBJECT_VALUE(v) && CYS_IS_CLASS_CLOSURE_BIND_OBJ((v).object))
 #define CYS_IS_ENUM_VALUE(v) (CYS_IS_OBJECT_VALUE(v) && CYS_IS_ENUM_OBJ((v).object))
 #define CYS_IS_MODULE_VALUE(v) (CYS_IS_OBJECT_VALUE(v) && CYS_IS_MODULE_OBJ((v).object))
+#define CYS_IS_WEAK_REF_VALUE(v) (CYS_IS_OBJECT_VALUE(v) && CYS_IS_WEAK_REF_OBJ((v).object))
 
 #define CYS_TO_INT_VALUE(v) ((v).integer)
 #define CYS_TO_REAL_VALUE(v) ((v).realnum)
@@ -73,6 +76,7 @@ namespace CynicScript
 #define CYS_TO_CLASS_CLOSURE_BIND_VALUE(v) (CYS_TO_CLASS_CLOSURE_BIND_OBJ((v).object))
 #define CYS_TO_ENUM_VALUE(v) (CYS_TO_ENUM_OBJ((v).object))
 #define CYS_TO_MODULE_VALUE(v) (CYS_TO_MODULE_OBJ((v).object))
+#define CYS_TO_WEAK_REF_VALUE(v) (CYS_TO_WEAK_REF_OBJ((v).object))
 
     enum CYS_API ObjectKind : uint8_t
     {
@@ -88,34 +92,55 @@ namespace CynicScript
         CLASS,
         CLASS_CLOSURE_BIND,
         ENUM,
-        MODULE
+        MODULE,
+        WEAK_REF
     };
 
+    constexpr size_t OBJECT_KIND_COUNT = ObjectKind::WEAK_REF + 1;
+
+    // 16 byte object header without vtable,ToString/Blacken/IsEqualTo/Serialize and destruction
+    // are dispatched through a table indexed by kind(see Object.cpp)
     struct CYS_API Object
     {
         Object(ObjectKind kind);
-        virtual ~Object();
+        ~Object();
 
-        virtual STRING ToString() const = 0;
+        STRING ToString() const;
         void Mark();
         void UnMark();
-        virtual void Blacken();
-        virtual bool IsEqualTo(Object *other) = 0;
-        virtual std::vector<uint8_t> Serialize() const = 0;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
+
+        Object *GetNext() const;
+        void SetNext(Object *object);
 
-        const ObjectKind kind;
-        bool marked{false};
-        Object *next{nullptr};
+        uint8_t kind;
+        bool marked;
+        Object *next; // gc record chain,kept full width since tagged pointers(arm TBI/MTE,HWASan) and 5-level paging use the high bits
     };
 
+    static_assert(sizeof(Object) == 16, "Object header must stay 16 bytes");
+
+    inline Object *Object::GetNext() const
+    {
+        return next;
+    }
+
+    inline void Object::SetNext(Object *object)
+    {
+        next = object;
+    }
+
     struct CYS_API StrObject : public Object
     {
         StrObject(STRING_VIEW value);
-        ~StrObject() override;
+        ~StrObject();
 
-        STRING ToString() const override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        STRING ToString() const;
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
+        void Deserialize(const BytecodeImage &image, size_t &offset);
 
         STRING value{};
     };
@@ -124,12 +149,12 @@ namespace CynicScript
     {
         ArrayObject();
         ArrayObject(const std::vector<struct Value> &elements);
-        ~ArrayObject() override;
+        ~ArrayObject();
 
-        STRING ToString() const override;
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        STRING ToString() const;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         std::vector<struct Value> elements{};
     };
@@ -138,28 +163,29 @@ namespace CynicScript
     {
         DictObject();
         DictObject(const ValueUnorderedMap &elements);
-        ~DictObject() override;
+        ~DictObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         ValueUnorderedMap elements{};
+        bool weakKeys{false}; // ephemeron table:an entry is kept only while its key object is reachable from elsewhere
     };
 
     struct CYS_API StructObject : public Object
     {
         StructObject();
         StructObject(const std::unordered_map<STRING, Value> &elements);
-        ~StructObject() override;
+        ~StructObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         std::unordered_map<STRING, Value> elements{};
     };
@@ -168,16 +194,17 @@ namespace CynicScript
     {
         FunctionObject();
         FunctionObject(STRING_VIEW name);
-        ~FunctionObject() override;
+        ~FunctionObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 #ifndef NDEBUG
         STRING ToStringWithChunk() const;
 #endif
 
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
+        void Deserialize(const BytecodeImage &image, size_t &offset);
 
 #ifdef CYS_FUNCTION_CACHE_OPT
         void SetCache(size_t hash, const std::vector<Value> &result);
@@ -187,7 +214,7 @@ namespace CynicScript
         std::unordered_map<size_t, std::vector<Value>> caches;
 #endif
 
-        uint8_t arity{0};
+        uint16_t arity{0};
         VarArg varArg{VarArg::NONE};
         int8_t upValueCount{0};
         Chunk chunk{};
@@ -198,13 +225,13 @@ namespace CynicScript
     {
         UpValueObject();
         UpValueObject(Value *location);
-        ~UpValueObject() override;
+        ~UpValueObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         Value *location{nullptr};
         Value closed{};
@@ -215,13 +242,13 @@ namespace CynicScript
     {
         ClosureObject();
         ClosureObject(FunctionObject *function);
-        ~ClosureObject() override;
+        ~ClosureObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         FunctionObject *function{nullptr};
         std::vector<UpValueObject *> upvalues{};
@@ -233,12 +260,12 @@ namespace CynicScript
     {
         NativeFunctionObject();
         NativeFunctionObject(NativeFunction f);
-        ~NativeFunctionObject() override;
+        ~NativeFunctionObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         NativeFunction fn{};
     };
@@ -246,12 +273,12 @@ namespace CynicScript
     struct CYS_API RefObject : public Object
     {
         RefObject(Value *pointer);
-        ~RefObject() override;
+        ~RefObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         Value *pointer{nullptr};
     };
@@ -260,34 +287,48 @@ namespace CynicScript
     {
         ClassObject();
         ClassObject(STRING_VIEW name);
-        ~ClassObject() override;
+        ~ClassObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         bool GetMember(const STRING &name, Value &retV);
         bool GetParentMember(const STRING &name, Value &retV);
 
+        // fill in the members of a library class the first time they are needed(see LibraryManager)
+        void LoadMembers();
+
         STRING name{};
         std::map<int32_t, ClosureObject *> constructors{}; // argument count as key for now
         std::unordered_map<STRING, Value> members{};
         std::map<STRING, ClassObject *> parents{};
+        void (*memberLoader)(ClassObject *klass){nullptr}; // cleared once the members are loaded
     };
 
+    inline void ClassObject::LoadMembers()
+    {
+        if (memberLoader)
+        {
+            auto loader = memberLoader;
+            memberLoader = nullptr;
+            loader(this);
+        }
+    }
+
     struct CYS_API ClassClosureBindObject : public Object
     {
         ClassClosureBindObject();
         ClassClosureBindObject(const Value &receiver, ClosureObject *cl);
-        ~ClassClosureBindObject() override;
+        ~ClassClosureBindObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         Value receiver{};
         ClosureObject *closure{nullptr};
@@ -297,13 +338,14 @@ namespace CynicScript
     {
         EnumObject();
         EnumObject(const STRING &name, const std::unordered_map<STRING, Value> &pairs);
-        ~EnumObject() override;
+        ~EnumObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
+        void Deserialize(const BytecodeImage &image, size_t &offset);
 
         bool GetMember(const STRING &name, Value &retV);
 
@@ -315,17 +357,39 @@ namespace CynicScript
     {
         ModuleObject();
         ModuleObject(const STRING &name, const std::unordered_map<STRING, Value> &values);
-        ~ModuleObject() override;
+        ~ModuleObject();
 
-        STRING ToString() const override;
+        STRING ToString() const;
 
-        void Blacken() override;
-        bool IsEqualTo(Object *other) override;
-        std::vector<uint8_t> Serialize() const override;
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
 
         bool GetMember(const STRING &name, Value &retV);
 
         STRING name{};
         std::unordered_map<STRING, Value> values{};
     };
-}
\ No newline at end of file
+
+    struct CYS_API WeakRefObject : public Object
+    {
+        WeakRefObject();
+        WeakRefObject(Object *target);
+        ~WeakRefObject();
+
+        STRING ToString() const;
+
+        void Blacken();
+        bool IsEqualTo(Object *other);
+        void Serialize(BytecodeWriter &writer) const;
+
+        Object *target{nullptr}; // not traced,cleared by the collector once the target is unreachable
+    };
+
+    // object written by Value::Serialize after its kind byte,only the kinds a compiler emits as constants are supported
+    Object *DeserializeObject(const BytecodeImage &image, size_t &offset);
+
+    STRING_VIEW ObjectKindToString(ObjectKind kind);
+    size_t SizeOfObject(const Object *object);
+    void DestroyObject(Object *object);
+}
@@ -75,77 +75,117 @@ namespace CynicScript
 			{Precedence::POSTFIX, Associativity::L2R},
 	};
 
-	std::unordered_map<TokenKind, PrefixFn> Parser::mPrefixFunctions =
+	constexpr std::array<ParseRule, TOKEN_KIND_COUNT> Parser::BuildParseRules()
+	{
+		struct PrefixBinding
 		{
-			{TokenKind::IDENTIFIER, &Parser::ParseIdentifierExpr},
-			{TokenKind::NUMBER, &Parser::ParseLiteralExpr},
-			{TokenKind::STR, &Parser::ParseLiteralExpr},
-			{TokenKind::NIL, &Parser::ParseLiteralExpr},
-			{TokenKind::TRUE, &Parser::ParseLiteralExpr},
-			{TokenKind::FALSE, &Parser::ParseLiteralExpr},
-			{TokenKind::CHAR, &Parser::ParseLiteralExpr},
-			{TokenKind::MINUS, &Parser::ParsePrefixExpr},
-			{TokenKind::TILDE, &Parser::ParsePrefixExpr},
-			{TokenKind::BANG, &Parser::ParsePrefixExpr},
-			{TokenKind::LPAREN, &Parser::ParseGroupExpr},
-			{TokenKind::LBRACKET, &Parser::ParseArrayExpr},
-			{TokenKind::LBRACE, &Parser::ParseDictExpr},
-			{TokenKind::AMPERSAND, &Parser::ParseRefExpr},
-			{TokenKind::FUNCTION, &Parser::ParseLambdaExpr},
-			{TokenKind::PLUS_PLUS, &Parser::ParsePrefixExpr},
-			{TokenKind::MINUS_MINUS, &Parser::ParsePrefixExpr},
-			{TokenKind::NEW, &Parser::ParseNewExpr},
-			{TokenKind::THIS, &Parser::ParseThisExpr},
-			{TokenKind::BASE, &Parser::ParseBaseExpr},
-			{TokenKind::MATCH, &Parser::ParseMatchExpr},
-			{TokenKind::LPAREN_LBRACE, &Parser::ParseCompoundExpr},
-			{TokenKind::ELLIPSIS, &Parser::ParseVarArgExpr},
-			{TokenKind::STRUCT, &Parser::ParseStructExpr},
-	};
+			TokenKind kind;
+			PrefixFn fn;
+		};
 
-	std::unordered_map<TokenKind, InfixFn> Parser::mInfixFunctions =
+		struct InfixBinding
 		{
-			{TokenKind::EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::PLUS_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::MINUS_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::ASTERISK_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::SLASH_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::PERCENT_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::AMPERSAND_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::VBAR_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::CARET_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::LESS_LESS_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::GREATER_GREATER_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::QUESTION, &Parser::ParseConditionExpr},
-			{TokenKind::VBAR_VBAR, &Parser::ParseInfixExpr},
-			{TokenKind::AMPERSAND_AMPERSAND, &Parser::ParseInfixExpr},
-			{TokenKind::VBAR, &Parser::ParseInfixExpr},
-			{TokenKind::CARET, &Parser::ParseInfixExpr},
-			{TokenKind::AMPERSAND, &Parser::ParseInfixExpr},
-			{TokenKind::LESS_LESS, &Parser::ParseInfixExpr},
-			{TokenKind::GREATER_GREATER, &Parser::ParseInfixExpr},
-			{TokenKind::EQUAL_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::BANG_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::LESS, &Parser::ParseInfixExpr},
-			{TokenKind::LESS_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::GREATER, &Parser::ParseInfixExpr},
-			{TokenKind::GREATER_EQUAL, &Parser::ParseInfixExpr},
-			{TokenKind::PLUS, &Parser::ParseInfixExpr},
-			{TokenKind::MINUS, &Parser::ParseInfixExpr},
-			{TokenKind::ASTERISK, &Parser::ParseInfixExpr},
-			{TokenKind::SLASH, &Parser::ParseInfixExpr},
-			{TokenKind::PERCENT, &Parser::ParseInfixExpr},
-			{TokenKind::LPAREN, &Parser::ParseCallExpr},
-			{TokenKind::LBRACKET, &Parser::ParseIndexExpr},
-			{TokenKind::DOT, &Parser::ParseDotExpr},
-			{TokenKind::BANG, &Parser::ParseFactorialExpr},
-	};
+			TokenKind kind;
+			InfixFn fn;
+		};
 
-	std::unordered_map<TokenKind, PostfixFn> Parser::mPostfixFunctions =
+		struct PostfixBinding
 		{
-			{TokenKind::PLUS_PLUS, &Parser::ParsePostfixExpr},
-			{TokenKind::MINUS_MINUS, &Parser::ParsePostfixExpr},
-	};
+			TokenKind kind;
+			PostfixFn fn;
+		};
+
+		constexpr PrefixBinding prefixDict[] =
+			{
+				{TokenKind::IDENTIFIER, &Parser::ParseIdentifierExpr},
+				{TokenKind::NUMBER, &Parser::ParseLiteralExpr},
+				{TokenKind::STR, &Parser::ParseLiteralExpr},
+				{TokenKind::NIL, &Parser::ParseLiteralExpr},
+				{TokenKind::TRUE, &Parser::ParseLiteralExpr},
+				{TokenKind::FALSE, &Parser::ParseLiteralExpr},
+				{TokenKind::CHAR, &Parser::ParseLiteralExpr},
+				{TokenKind::MINUS, &Parser::ParsePrefixExpr},
+				{TokenKind::TILDE, &Parser::ParsePrefixExpr},
+				{TokenKind::BANG, &Parser::ParsePrefixExpr},
+				{TokenKind::LPAREN, &Parser::ParseGroupExpr},
+				{TokenKind::LBRACKET, &Parser::ParseArrayExpr},
+				{TokenKind::LBRACE, &Parser::ParseDictExpr},
+				{TokenKind::AMPERSAND, &Parser::ParseRefExpr},
+				{TokenKind::FUNCTION, &Parser::ParseLambdaExpr},
+				{TokenKind::PLUS_PLUS, &Parser::ParsePrefixExpr},
+				{TokenKind::MINUS_MINUS, &Parser::ParsePrefixExpr},
+				{TokenKind::NEW, &Parser::ParseNewExpr},
+				{TokenKind::THIS, &Parser::ParseThisExpr},
+				{TokenKind::BASE, &Parser::ParseBaseExpr},
+				{TokenKind::MATCH, &Parser::ParseMatchExpr},
+				{TokenKind::LPAREN_LBRACE, &Parser::ParseCompoundExpr},
+				{TokenKind::ELLIPSIS, &Parser::ParseVarArgExpr},
+				{TokenKind::STRUCT, &Parser::ParseStructExpr},
+		};
+
+		constexpr InfixBinding infixDict[] =
+			{
+				{TokenKind::EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::PLUS_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::MINUS_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::ASTERISK_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::SLASH_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::PERCENT_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::AMPERSAND_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::VBAR_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::CARET_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::LESS_LESS_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::GREATER_GREATER_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::QUESTION, &Parser::ParseConditionExpr},
+				{TokenKind::VBAR_VBAR, &Parser::ParseInfixExpr},
+				{TokenKind::AMPERSAND_AMPERSAND, &Parser::ParseInfixExpr},
+				{TokenKind::VBAR, &Parser::ParseInfixExpr},
+				{TokenKind::CARET, &Parser::ParseInfixExpr},
+				{TokenKind::AMPERSAND, &Parser::ParseInfixExpr},
+				{TokenKind::LESS_LESS, &Parser::ParseInfixExpr},
+				{TokenKind::GREATER_GREATER, &Parser::ParseInfixExpr},
+				{TokenKind::EQUAL_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::BANG_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::LESS, &Parser::ParseInfixExpr},
+				{TokenKind::LESS_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::GREATER, &Parser::ParseInfixExpr},
+				{TokenKind::GREATER_EQUAL, &Parser::ParseInfixExpr},
+				{TokenKind::PLUS, &Parser::ParseInfixExpr},
+				{TokenKind::MINUS, &Parser::ParseInfixExpr},
+				{TokenKind::ASTERISK, &Parser::ParseInfixExpr},
+				{TokenKind::SLASH, &Parser::ParseInfixExpr},
+				{TokenKind::PERCENT, &Parser::ParseInfixExpr},
+				{TokenKind::LPAREN, &Parser::ParseCallExpr},
+				{TokenKind::LBRACKET, &Parser::ParseIndexExpr},
+				{TokenKind::DOT, &Parser::ParseDotExpr},
+				{TokenKind::BANG, &Parser::ParseFactorialExpr},
+		};
+
+		constexpr PostfixBinding postfixDict[] =
+			{
+				{TokenKind::PLUS_PLUS, &Parser::ParsePostfixExpr},
+				{TokenKind::MINUS_MINUS, &Parser::ParsePostfixExpr},
+		};
+
+		std::array<ParseRule, TOKEN_KIND_COUNT> rules{};
+		for (const auto &binding : prefixDict)
+			rules[static_cast<size_t>(binding.kind)].prefix = binding.fn;
+		for (const auto &binding : infixDict)
+			rules[static_cast<size_t>(binding.kind)].infix = binding.fn;
+		for (const auto &binding : postfixDict)
+			rules[static_cast<size_t>(binding.kind)].postfix = binding.fn;
+
+		for (const auto &binding : precedenceDict)
+			rules[static_cast<size_t>(binding.kind)].precedence = binding.precedence;
+		for (auto &rule : rules)
+			for (const auto &binding : associativityDict)
+				if (binding.precedence == rule.precedence)
+					rule.associativity = binding.associativity;
+
+		return rules;
+	}
+
+	constexpr std::array<ParseRule, TOKEN_KIND_COUNT> Parser::mParseRules = Parser::BuildParseRules();
 
 	Parser::Parser()
 		: mCurClassInfo(nullptr), mCurPos(0)
@@ -154,8 +194,6 @@ namespace CynicScript
 
 	Parser::~Parser()
 	{
-		std::unordered_map<TokenKind, PrefixFn>().swap(mPrefixFunctions);
-		std::unordered_map<TokenKind, InfixFn>().swap(mInfixFunctions);
 	}
 
 	Stmt *Parser::Parse(const std::vector<Token *> &tokens)
@@ -194,6 +232,8 @@ namespace CynicScript
 			return ParseEnumDecl();
 		case TokenKind::MODULE:
 			return ParseModuleDecl();
+		case TokenKind::IMPORT:
+			return ParseImportDecl();
 		default:
 			return nullptr;
 		}
@@ -322,13 +362,13 @@ namespace CynicScript
 					CYS_LOG_ERROR_WITH_LOC(fn->name->tagToken, TEXT("The class member function name :{} conflicts with its class:{}, only constructor function name is allowed to same with its class's name"), fn->name->literal);
 				classStmt->functions.emplace_back(privilege, std::move(ClassDecl::FunctionMember(ClassDecl::FunctionKind::MEMBER, fn)));
 			}
-			else if (GetCurToken()->literal == classStmt->name) // constructor
+			else if (SourceToString(GetCurToken()->literal) == classStmt->name) // constructor
 			{
 				auto fn = (FunctionDecl *)ParseFunctionDecl();
 				classStmt->functions.emplace_back(privilege, std::move(ClassDecl::FunctionMember(ClassDecl::FunctionKind::CONSTRUCTOR, fn)));
 			}
 			else
-				Consume({TokenKind::LET, TokenKind::FUNCTION, TokenKind::CONST}, TEXT("UnExpect identifier '") + GetCurToken()->literal + TEXT("'."));
+				Consume({TokenKind::LET, TokenKind::FUNCTION, TokenKind::CONST}, TEXT("UnExpect identifier '") + SourceToString(GetCurToken()->literal) + TEXT("'."));
 		}
 
 		Consume(TokenKind::RBRACE, TEXT("Expect '}' after class stmt's '{'"));
@@ -350,12 +390,11 @@ namespace CynicScript
 		while (!IsMatchCurToken(TokenKind::RBRACE))
 		{
 			auto name = (IdentifierExpr *)ParseIdentifierExpr();
-			Expr *value = new LiteralExpr(name->tagToken, name->literal);
+			Expr *value = nullptr;
 			if (IsMatchCurTokenAndStepOnce(TokenKind::EQUAL))
-			{
-				SAFE_DELETE(value);
 				value = ParseExpr();
-			}
+			else
+				value = new LiteralExpr(name->tagToken, name->literal);
 
 			items[name] = value;
 
@@ -411,6 +450,31 @@ namespace CynicScript
 		return moduleDecl;
 	}
 
+	Decl *Parser::ParseImportDecl()
+	{
+		auto token = Consume(TokenKind::IMPORT, TEXT("Expect 'import' keyword."));
+		auto pathToken = Consume(TokenKind::STR, TEXT("Expect a file path string after 'import'."));
+		Consume(TokenKind::SEMICOLON, TEXT("Expect ';' after import stmt."));
+
+		// the module is named after the file,import "lib/strutils.cys" binds strutils
+		auto path = SourceToString(pathToken->literal);
+		auto nameStart = path.find_last_of(TEXT("/\\"));
+		nameStart = nameStart == STRING::npos ? 0 : nameStart + 1;
+		auto nameEnd = path.find_last_of(TEXT('.'));
+		if (nameEnd == STRING::npos || nameEnd < nameStart)
+			nameEnd = path.size();
+		auto name = path.substr(nameStart, nameEnd - nameStart);
+
+		bool isIdentifier = !name.empty() && !(name[0] >= TEXT('0') && name[0] <= TEXT('9'));
+		for (const auto &c : name)
+			if (!((c >= TEXT('a') && c <= TEXT('z')) || (c >= TEXT('A') && c <= TEXT('Z')) || (c >= TEXT('0') && c <= TEXT('9')) || c == TEXT('_') || static_cast<uint32_t>(c) >= 0x80))
+				isIdentifier = false;
+		if (!isIdentifier)
+			CYS_LOG_ERROR_WITH_LOC(pathToken, TEXT("Cannot import {},the module is named after the file and '{}' is not an identifier."), path, name);
+
+		return new ImportDecl(token, new IdentifierExpr(pathToken, name), path);
+	}
+
 	Stmt *Parser::ParseDeclAndStmt()
 	{
 		Stmt *result = ParseDecl();
@@ -903,32 +967,29 @@ namespace CynicScript
 
 	Expr *Parser::ParseExpr(Precedence precedence)
 	{
-		if (mPrefixFunctions.find(GetCurToken()->kind) == mPrefixFunctions.end())
+		auto prefixFn = GetParseRule(GetCurToken()->kind).prefix;
+		if (prefixFn == nullptr)
 		{
 			auto token = GetCurTokenAndStepOnce();
-			CYS_LOG_ERROR_WITH_LOC(token, TEXT("no prefix definition for:{}"), token->literal);
+			CYS_LOG_ERROR_WITH_LOC(token, TEXT("no prefix definition for:{}"), SourceToString(token->literal));
 
 			auto nullExpr = new LiteralExpr(token);
 
 			return nullExpr;
 		}
 
-		auto prefixFn = mPrefixFunctions[GetCurToken()->kind];
-
 		auto leftExpr = (this->*prefixFn)();
 
-		while (!IsMatchCurToken(TokenKind::SEMICOLON) && (GetCurTokenAssociativity() == Associativity::L2R ? precedence < GetCurTokenPrecedence() : precedence <= GetCurTokenPrecedence()))
+		while (!IsMatchCurToken(TokenKind::SEMICOLON))
 		{
-			if (mPostfixFunctions.find(GetCurToken()->kind) != mPostfixFunctions.end())
-			{
-				auto postfixFn = mPostfixFunctions[GetCurToken()->kind];
-				leftExpr = (this->*postfixFn)(leftExpr);
-			}
-			else if (mInfixFunctions.find(GetCurToken()->kind) != mInfixFunctions.end())
-			{
-				auto infixFn = mInfixFunctions[GetCurToken()->kind];
-				leftExpr = (this->*infixFn)(leftExpr);
-			}
+			const auto &rule = GetParseRule(GetCurToken()->kind);
+			if (rule.associativity == Associativity::L2R ? precedence >= rule.precedence : precedence > rule.precedence)
+				break;
+
+			if (rule.postfix)
+				leftExpr = (this->*rule.postfix)(leftExpr);
+			else if (rule.infix)
+				leftExpr = (this->*rule.infix)(leftExpr);
 			else
 				break;
 		}
@@ -938,9 +999,9 @@ namespace CynicScript
 
 	Expr *Parser::ParseIdentifierExpr()
 	{
-		auto token = Consume(TokenKind::IDENTIFIER, TEXT("Unexpect Identifier'") + GetCurToken()->literal + TEXT("'."));
+		auto token = Consume(TokenKind::IDENTIFIER, TEXT("Unexpect Identifier'") + SourceToString(GetCurToken()->literal) + TEXT("'."));
 		auto identifierExpr = new IdentifierExpr(token);
-		identifierExpr->literal = token->literal;
+		identifierExpr->literal = SourceToString(token->literal);
 		return identifierExpr;
 	}
 
@@ -949,9 +1010,9 @@ namespace CynicScript
 		auto token = GetCurTokenAndStepOnce();
 		if (token->kind == TokenKind::NUMBER)
 		{
-			auto literal = token->literal;
+			std::string literal(token->literal);
 			LiteralExpr *numExpr = new LiteralExpr(token);
-			if (literal.find('.') != STRING::npos)
+			if (literal.find('.') != std::string::npos)
 			{
 				auto v = std::stod(literal);
 				numExpr->f64Value = v;
@@ -978,7 +1039,7 @@ namespace CynicScript
 			return numExpr;
 		}
 		else if (token->kind == TokenKind::STR)
-			return new LiteralExpr(token, token->literal);
+			return new LiteralExpr(token, SourceToString(token->literal));
 		else if (token->kind == TokenKind::NIL)
 			return new LiteralExpr(token);
 		else if (token->kind == TokenKind::TRUE)
@@ -1076,7 +1137,7 @@ namespace CynicScript
 	Expr *Parser::ParsePrefixExpr()
 	{
 		auto prefixExpr = new PrefixExpr(GetCurToken());
-		prefixExpr->op = GetCurTokenAndStepOnce()->literal;
+		prefixExpr->op = SourceToString(GetCurTokenAndStepOnce()->literal);
 		prefixExpr->right = ParseExpr(Precedence::PREFIX);
 		return prefixExpr;
 	}
@@ -1094,7 +1155,7 @@ namespace CynicScript
 		auto infixExpr = new InfixExpr(GetCurToken());
 		infixExpr->left = prefixExpr;
 		Precedence opPrece = GetCurTokenPrecedence();
-		infixExpr->op = GetCurTokenAndStepOnce()->literal;
+		infixExpr->op = SourceToString(GetCurTokenAndStepOnce()->literal);
 		infixExpr->right = ParseExpr(opPrece);
 		return infixExpr;
 	}
@@ -1102,7 +1163,7 @@ namespace CynicScript
 	Expr *Parser::ParsePostfixExpr(Expr *prefixExpr)
 	{
 		auto postfixExpr = new PostfixExpr(GetCurToken());
-		postfixExpr->op = GetCurTokenAndStepOnce()->literal;
+		postfixExpr->op = SourceToString(GetCurTokenAndStepOnce()->literal);
 		postfixExpr->left = prefixExpr;
 		return postfixExpr;
 	}
@@ -1272,7 +1333,7 @@ namespace CynicScript
 	{
 		//TODO:only support basic single word type
 		auto token = GetCurTokenAndStepOnce();
-		return Type(token->literal);
+		return Type(SourceToString(token->literal));
 	}
 
 	ClassDecl::MemberPrivilege Parser::ParseClassMemberPrivilege()
@@ -1305,18 +1366,12 @@ namespace CynicScript
 
 	Precedence Parser::GetCurTokenPrecedence()
 	{
-		for (const auto &precedenceBinding : precedenceDict)
-			if (precedenceBinding.kind == GetCurToken()->kind)
-				return precedenceBinding.precedence;
-		return Precedence::LOWEST;
+		return GetParseRule(GetCurToken()->kind).precedence;
 	}
 
 	Associativity Parser::GetCurTokenAssociativity()
 	{
-		for (const auto &associativityBinding : associativityDict)
-			if (associativityBinding.precedence == GetCurTokenPrecedence())
-				return associativityBinding.associativity;
-		return Associativity::L2R;
+		return GetParseRule(GetCurToken()->kind).associativity;
 	}
 
 	Token *Parser::GetNextToken()
@@ -1334,10 +1389,7 @@ namespace CynicScript
 
 	Precedence Parser::GetNextTokenPrecedence()
 	{
-		for (const auto &precedenceBinding : precedenceDict)
-			if (precedenceBinding.kind == GetNextToken()->kind)
-				return precedenceBinding.precedence;
-		return Precedence::LOWEST;
+		return GetParseRule(GetNextToken()->kind).precedence;
 	}
 
 	bool Parser::IsMatchCurToken(TokenKind kind)
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <array>
 #include <cassert>
 #include <iostream>
 #include <unordered_map>
@@ -48,6 +49,16 @@ namespace CynicScript
 	typedef Expr *(Parser::*InfixFn)(Expr *);
 	typedef Expr *(Parser::*PostfixFn)(Expr *);
 
+	// Pratt parsing entry of a token kind,the parse functions are null where the token cannot start or continue an expression
+	struct ParseRule
+	{
+		PrefixFn prefix{nullptr};
+		InfixFn infix{nullptr};
+		PostfixFn postfix{nullptr};
+		Precedence precedence{Precedence::LOWEST};
+		Associativity associativity{Associativity::L2R};
+	};
+
 	class CYS_API Parser
 	{
 		NON_COPYABLE(Parser)
@@ -66,6 +77,7 @@ namespace CynicScript
 		Decl *ParseClassDecl();
 		Decl *ParseEnumDecl();
 		Decl *ParseModuleDecl();
+		Decl *ParseImportDecl();
 
 		Stmt *ParseDeclAndStmt();
 
@@ -136,8 +148,9 @@ namespace CynicScript
 		int64_t mCurPos;
 		std::vector<Token *> mTokens;
 
-		static std::unordered_map<TokenKind, PrefixFn> mPrefixFunctions;
-		static std::unordered_map<TokenKind, InfixFn> mInfixFunctions;
-		static std::unordered_map<TokenKind, PostfixFn> mPostfixFunctions;
+		static constexpr std::array<ParseRule, TOKEN_KIND_COUNT> BuildParseRules();
+		static const ParseRule &GetParseRule(TokenKind kind) { return mParseRules[static_cast<size_t>(kind)]; }
+
+		static const std::array<ParseRule, TOKEN_KIND_COUNT> mParseRules; // indexed by TokenKind
 	};
 }
\ No newline at end of file
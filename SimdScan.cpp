@@ -0,0 +1,197 @@
+#include "SimdScan.h"
+#include <bit>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CYS_SIMD_SCAN_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CYS_SIMD_SCAN_SSE2
+#endif
+
+namespace CynicScript
+{
+	namespace
+	{
+		bool IsAsciiIdentifierChar(SOURCE_CHAR_T c)
+		{
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+		}
+
+		bool IsBlankChar(SOURCE_CHAR_T c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+#if defined(CYS_SIMD_SCAN_AVX2)
+		using SimdRegister = __m256i;
+		constexpr size_t SIMD_REGISTER_BYTES = 32;
+
+		SimdRegister SimdLoad(const SOURCE_CHAR_T *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+		SimdRegister SimdOr(SimdRegister a, SimdRegister b) { return _mm256_or_si256(a, b); }
+		SimdRegister SimdAnd(SimdRegister a, SimdRegister b) { return _mm256_and_si256(a, b); }
+		uint32_t SimdMoveMask(SimdRegister v) { return static_cast<uint32_t>(_mm256_movemask_epi8(v)); }
+
+		SimdRegister SimdSplat(SOURCE_CHAR_T c) { return _mm256_set1_epi8(static_cast<char>(c)); }
+		SimdRegister SimdCmpEq(SimdRegister a, SimdRegister b) { return _mm256_cmpeq_epi8(a, b); }
+		SimdRegister SimdCmpGt(SimdRegister a, SimdRegister b) { return _mm256_cmpgt_epi8(a, b); }
+#elif defined(CYS_SIMD_SCAN_SSE2)
+		using SimdRegister = __m128i;
+		constexpr size_t SIMD_REGISTER_BYTES = 16;
+
+		SimdRegister SimdLoad(const SOURCE_CHAR_T *p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+		SimdRegister SimdOr(SimdRegister a, SimdRegister b) { return _mm_or_si128(a, b); }
+		SimdRegister SimdAnd(SimdRegister a, SimdRegister b) { return _mm_and_si128(a, b); }
+		uint32_t SimdMoveMask(SimdRegister v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+
+		SimdRegister SimdSplat(SOURCE_CHAR_T c) { return _mm_set1_epi8(static_cast<char>(c)); }
+		SimdRegister SimdCmpEq(SimdRegister a, SimdRegister b) { return _mm_cmpeq_epi8(a, b); }
+		SimdRegister SimdCmpGt(SimdRegister a, SimdRegister b) { return _mm_cmpgt_epi8(a, b); }
+#endif
+
+#if defined(CYS_SIMD_SCAN_AVX2) || defined(CYS_SIMD_SCAN_SSE2)
+		constexpr size_t SIMD_LANE_COUNT = SIMD_REGISTER_BYTES;
+		constexpr uint32_t SIMD_FULL_MASK = SIMD_REGISTER_BYTES == 32 ? 0xFFFFFFFFu : ((1u << SIMD_REGISTER_BYTES) - 1);
+
+		// lanes in [lo,hi],the comparisons are signed so utf-8 multibyte sequence bytes never match an ascii range
+		SimdRegister SimdInRange(SimdRegister v, SOURCE_CHAR_T lo, SOURCE_CHAR_T hi)
+		{
+			return SimdAnd(SimdCmpGt(v, SimdSplat(lo - 1)), SimdCmpGt(SimdSplat(hi + 1), v));
+		}
+
+		size_t FirstLane(uint32_t mask)
+		{
+			return static_cast<size_t>(std::countr_zero(mask));
+		}
+#endif
+	}
+
+	size_t FindFirstOf(const SOURCE_CHAR_T *p, size_t n, SOURCE_CHAR_T a)
+	{
+		size_t i = 0;
+#if defined(CYS_SIMD_SCAN_AVX2) || defined(CYS_SIMD_SCAN_SSE2)
+		const SimdRegister va = SimdSplat(a);
+		for (; i + SIMD_LANE_COUNT <= n; i += SIMD_LANE_COUNT)
+		{
+			uint32_t mask = SimdMoveMask(SimdCmpEq(SimdLoad(p + i), va));
+			if (mask)
+				return i + FirstLane(mask);
+		}
+#endif
+		for (; i < n; ++i)
+			if (p[i] == a)
+				return i;
+		return n;
+	}
+
+	size_t FindFirstOf(const SOURCE_CHAR_T *p, size_t n, SOURCE_CHAR_T a, SOURCE_CHAR_T b)
+	{
+		size_t i = 0;
+#if defined(CYS_SIMD_SCAN_AVX2) || defined(CYS_SIMD_SCAN_SSE2)
+		const SimdRegister va = SimdSplat(a);
+		const SimdRegister vb = SimdSplat(b);
+		for (; i + SIMD_LANE_COUNT <= n; i += SIMD_LANE_COUNT)
+		{
+			SimdRegister v = SimdLoad(p + i);
+			uint32_t mask = SimdMoveMask(SimdOr(SimdCmpEq(v, va), SimdCmpEq(v, vb)));
+			if (mask)
+				return i + FirstLane(mask);
+		}
+#endif
+		for (; i < n; ++i)
+			if (p[i] == a || p[i] == b)
+				return i;
+		return n;
+	}
+
+	size_t FindFirstOf(const SOURCE_CHAR_T *p, size_t n, SOURCE_CHAR_T a, SOURCE_CHAR_T b, SOURCE_CHAR_T c, SOURCE_CHAR_T d)
+	{
+		size_t i = 0;
+#if defined(CYS_SIMD_SCAN_AVX2) || defined(CYS_SIMD_SCAN_SSE2)
+		const SimdRegister va = SimdSplat(a);
+		const SimdRegister vb = SimdSplat(b);
+		const SimdRegister vc = SimdSplat(c);
+		const SimdRegister vd = SimdSplat(d);
+		for (; i + SIMD_LANE_COUNT <= n; i += SIMD_LANE_COUNT)
+		{
+			SimdRegister v = SimdLoad(p + i);
+			uint32_t mask = SimdMoveMask(SimdOr(SimdOr(SimdCmpEq(v, va), SimdCmpEq(v, vb)), SimdOr(SimdCmpEq(v, vc), SimdCmpEq(v, vd))));
+			if (mask)
+				return i + FirstLane(mask);
+		}
+#endif
+		for (; i < n; ++i)
+			if (p[i] == a || p[i] == b || p[i] == c || p[i] == d)
+				return i;
+		return n;
+	}
+
+	size_t SpanAsciiIdentifier(const SOURCE_CHAR_T *p, size_t n)
+	{
+		size_t i = 0;
+#if defined(CYS_SIMD_SCAN_AVX2) || defined(CYS_SIMD_SCAN_SSE2)
+		const SimdRegister underscore = SimdSplat('_');
+		for (; i + SIMD_LANE_COUNT <= n; i += SIMD_LANE_COUNT)
+		{
+			SimdRegister v = SimdLoad(p + i);
+			SimdRegister isIdentifier = SimdOr(SimdOr(SimdInRange(v, 'a', 'z'), SimdInRange(v, 'A', 'Z')),
+											   SimdOr(SimdInRange(v, '0', '9'), SimdCmpEq(v, underscore)));
+			uint32_t mask = ~SimdMoveMask(isIdentifier) & SIMD_FULL_MASK;
+			if (mask)
+				return i + FirstLane(mask);
+		}
+#endif
+		for (; i < n; ++i)
+			if (!IsAsciiIdentifierChar(p[i]))
+				return i;
+		return n;
+	}
+
+	size_t SpanBlank(const SOURCE_CHAR_T *p, size_t n)
+	{
+		size_t i = 0;
+#if defined(CYS_SIMD_SCAN_AVX2) || defined(CYS_SIMD_SCAN_SSE2)
+		const SimdRegister space = SimdSplat(' ');
+		const SimdRegister tab = SimdSplat('\t');
+		const SimdRegister carriageReturn = SimdSplat('\r');
+		for (; i + SIMD_LANE_COUNT <= n; i += SIMD_LANE_COUNT)
+		{
+			SimdRegister v = SimdLoad(p + i);
+			SimdRegister isBlank = SimdOr(SimdCmpEq(v, space), SimdOr(SimdCmpEq(v, tab), SimdCmpEq(v, carriageReturn)));
+			uint32_t mask = ~SimdMoveMask(isBlank) & SIMD_FULL_MASK;
+			if (mask)
+				return i + FirstLane(mask);
+		}
+#endif
+		for (; i < n; ++i)
+			if (!IsBlankChar(p[i]))
+				return i;
+		return n;
+	}
+
+	size_t CountUtf8ContinuationBytes(const SOURCE_CHAR_T *p, size_t n)
+	{
+		size_t i = 0;
+		size_t count = 0;
+#if defined(CYS_SIMD_SCAN_AVX2) || defined(CYS_SIMD_SCAN_SSE2)
+		const SimdRegister firstNonContinuation = SimdSplat(static_cast<SOURCE_CHAR_T>(0xC0)); // 0x80~0xBF are below 0xC0 as signed bytes
+		for (; i + SIMD_LANE_COUNT <= n; i += SIMD_LANE_COUNT)
+			count += std::popcount(SimdMoveMask(SimdCmpGt(firstNonContinuation, SimdLoad(p + i))));
+#endif
+		for (; i < n; ++i)
+			if ((static_cast<uint8_t>(p[i]) & 0xC0) == 0x80)
+				count++;
+		return count;
+	}
+
+	const char *GetSimdScanInstructionSet()
+	{
+#if defined(CYS_SIMD_SCAN_AVX2)
+		return "avx2";
+#elif defined(CYS_SIMD_SCAN_SSE2)
+		return "sse2";
+#else
+		return "scalar";
+#endif
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include "Utils.h"
+
+namespace CynicScript
+{
+	// Vectorized character scanning primitives used by the lexer on its hot loops(string literals,comments,
+	// identifiers and blank runs).AVX2 or SSE2 is selected at compile time from the target instruction set,
+	// other targets use the scalar loop.All functions work on utf-8 bytes and never read past p + n.
+
+	// offset of the first byte equal to a,n if there is none
+	size_t CYS_API FindFirstOf(const SOURCE_CHAR_T *p, size_t n, SOURCE_CHAR_T a);
+	// offset of the first byte equal to a or b,n if there is none
+	size_t CYS_API FindFirstOf(const SOURCE_CHAR_T *p, size_t n, SOURCE_CHAR_T a, SOURCE_CHAR_T b);
+	// offset of the first byte equal to any of a,b,c and d,n if there is none
+	size_t CYS_API FindFirstOf(const SOURCE_CHAR_T *p, size_t n, SOURCE_CHAR_T a, SOURCE_CHAR_T b, SOURCE_CHAR_T c, SOURCE_CHAR_T d);
+	// length of the leading run of ascii identifier characters:[A-Za-z0-9_]
+	size_t CYS_API SpanAsciiIdentifier(const SOURCE_CHAR_T *p, size_t n);
+	// length of the leading run of ' ','\t' and '\r'
+	size_t CYS_API SpanBlank(const SOURCE_CHAR_T *p, size_t n);
+	// number of utf-8 continuation bytes(10xxxxxx),the byte count minus it is the code point count
+	size_t CYS_API CountUtf8ContinuationBytes(const SOURCE_CHAR_T *p, size_t n);
+
+	// name of the instruction set the scanning primitives were compiled for
+	const char CYS_API *GetSimdScanInstructionSet();
+}
@@ -4,6 +4,7 @@
 #include <string_view>
 #include <ostream>
 #include "Utils.h"
+#include "Atom.h"
 namespace CynicScript
 {
 	enum class TokenKind
@@ -105,6 +106,8 @@ namespace CynicScript
 		END,
 	};
 
+	constexpr size_t TOKEN_KIND_COUNT = static_cast<size_t>(TokenKind::END) + 1;
+
 	struct SourceLocation
 	{
 		uint64_t line{1};
@@ -114,17 +117,19 @@ namespace CynicScript
 
 	struct CYS_API Token
 	{
-		Token() : kind(TokenKind::END), literal(TEXT("")) {}
-		Token(TokenKind kind, STRING_VIEW literal, const SourceLocation &srcLoc) : kind(kind), literal(literal), sourceLocation(srcLoc) {}
+		Token() : kind(TokenKind::END), literal("") {}
+		Token(TokenKind kind, SOURCE_STRING_VIEW literal, const SourceLocation &srcLoc) : kind(kind), literal(literal), sourceLocation(srcLoc) {}
 
 		STRING ToString() const
 		{
-			return TEXT("\"") + literal + TEXT("\"(") + CYS_TO_STRING(sourceLocation.line) + TEXT(",") + CYS_TO_STRING(sourceLocation.line) + TEXT(")");
+			return TEXT("\"") + SourceToString(literal) + TEXT("\"(") + CYS_TO_STRING(sourceLocation.line) + TEXT(",") + CYS_TO_STRING(sourceLocation.line) + TEXT(")");
 		}
 
 		TokenKind kind;
-		STRING literal;
+		SOURCE_STRING_VIEW literal; // utf-8 view into the source buffer retained by the lexer
 		SourceLocation sourceLocation;
+		Atom atom{NO_ATOM}; // interned literal of identifiers
+		uint32_t sourceId{0}; // file the token comes from(see Logger::RecordSourceFile),0 for the current one
 	};
 
 	inline OSTREAM &operator<<(OSTREAM &stream, const Token &token)
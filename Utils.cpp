@@ -4,26 +4,27 @@
 #include <codecvt>
 #include <fstream>
 #include <sstream>
+#include <filesystem>
 namespace CynicScript
 {
-    STRING ReadFile(std::string_view path)
+    SOURCE_STRING ReadFile(std::string_view path)
     {
-#ifdef CYS_UTF8_ENCODE
-        auto utf8Path = Utf8::Decode(path.data());
-        Logger::Record::mCurFilePath = utf8Path;
-#else
-        Logger::Record::mCurFilePath = path;
-#endif
+        Logger::RecordFilePath(path);
 
-        STD_IFSTREAM file;
-        file.open(Logger::Record::mCurFilePath.c_str(), std::ios::in | std::ios::binary);
+        std::ifstream file;
+        file.open(std::filesystem::path(Logger::Record::mCurFilePath), std::ios::in | std::ios::binary | std::ios::ate);
         if (!file.is_open())
             CYS_LOG_ERROR_WITH_LOC(TEXT("Failed to open file:{}"), Logger::Record::mCurFilePath);
 
-        STRING_STREAM sstream;
-        sstream << file.rdbuf();
+        SOURCE_STRING content;
+        content.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(content.data(), content.size());
         file.close();
-        return sstream.str();
+
+        if (content.starts_with(UTF8_BOM))
+            content.erase(0, UTF8_BOM.size());
+        return content;
     }
 
     void WriteBinaryFile(std::string_view path, const std::vector<uint8_t> &content)
@@ -114,6 +115,110 @@ namespace CynicScript
             std::wstring_convert<std::codecvt_utf8<wchar_t>> converter;
             return converter.from_bytes(str);
         }
+
+        uint32_t DecodeCodePoint(const char *p, size_t n, size_t &length)
+        {
+            const auto *bytes = reinterpret_cast<const uint8_t *>(p);
+            length = 1;
+            if (n == 0)
+                return INVALID_CODE_POINT;
+            if (bytes[0] < 0x80)
+                return bytes[0];
+
+            uint32_t codePoint;
+            uint32_t minCodePoint;
+            if ((bytes[0] & 0xE0) == 0xC0)
+            {
+                length = 2;
+                codePoint = bytes[0] & 0x1F;
+                minCodePoint = 0x80;
+            }
+            else if ((bytes[0] & 0xF0) == 0xE0)
+            {
+                length = 3;
+                codePoint = bytes[0] & 0x0F;
+                minCodePoint = 0x800;
+            }
+            else if ((bytes[0] & 0xF8) == 0xF0)
+            {
+                length = 4;
+                codePoint = bytes[0] & 0x07;
+                minCodePoint = 0x10000;
+            }
+            else
+                return INVALID_CODE_POINT;
+
+            if (length > n)
+            {
+                length = 1;
+                return INVALID_CODE_POINT;
+            }
+
+            for (size_t i = 1; i < length; ++i)
+            {
+                if ((bytes[i] & 0xC0) != 0x80)
+                {
+                    length = 1;
+                    return INVALID_CODE_POINT;
+                }
+                codePoint = (codePoint << 6) | (bytes[i] & 0x3F);
+            }
+
+            // overlong forms,surrogates and values past the unicode range
+            if (codePoint < minCodePoint || (codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF)
+            {
+                length = 1;
+                return INVALID_CODE_POINT;
+            }
+            return codePoint;
+        }
+    }
+
+    STRING SourceToString(SOURCE_STRING_VIEW source)
+    {
+#ifdef CYS_UTF8_ENCODE
+        // malformed sequences become U+FFFD instead of throwing,the source may be broken while reporting its errors
+        STRING result;
+        result.reserve(source.size());
+        for (size_t i = 0; i < source.size();)
+        {
+            if (static_cast<uint8_t>(source[i]) < 0x80)
+            {
+                result.push_back(static_cast<CHAR_T>(source[i++]));
+                continue;
+            }
+
+            size_t length;
+            auto codePoint = Utf8::DecodeCodePoint(source.data() + i, source.size() - i, length);
+            i += length;
+            if (codePoint == Utf8::INVALID_CODE_POINT)
+                codePoint = 0xFFFD;
+
+            if constexpr (sizeof(CHAR_T) == 2)
+            {
+                if (codePoint > 0xFFFF)
+                {
+                    codePoint -= 0x10000;
+                    result.push_back(static_cast<CHAR_T>(0xD800 + (codePoint >> 10)));
+                    result.push_back(static_cast<CHAR_T>(0xDC00 + (codePoint & 0x3FF)));
+                    continue;
+                }
+            }
+            result.push_back(static_cast<CHAR_T>(codePoint));
+        }
+        return result;
+#else
+        return STRING(source);
+#endif
+    }
+
+    SOURCE_STRING StringToSource(STRING_VIEW str)
+    {
+#ifdef CYS_UTF8_ENCODE
+        return Utf8::Encode(STRING(str));
+#else
+        return SOURCE_STRING(str);
+#endif
     }
     namespace ByteConverter
     {
@@ -131,7 +236,7 @@ namespace CynicScript
             return result;
         }
 
-        uint64_t GetU64Integer(const std::vector<uint8_t> data, uint32_t start)
+        uint64_t GetU64Integer(std::span<const uint8_t> data, size_t start)
         {
             uint64_t v{0};
             for (int32_t i = 0; i < 8; ++i)
@@ -149,12 +254,113 @@ namespace CynicScript
             return result;
         }
 
-        uint32_t GetU32Integer(const std::vector<uint8_t> data, uint32_t start)
+        uint32_t GetU32Integer(std::span<const uint8_t> data, size_t start)
         {
             uint32_t v{0};
             for (int32_t i = 0; i < 4; ++i)
                 v |= ((uint32_t)(data[start + i] & 0x000000FF) << ((3 - i) * 8));
             return v;
         }
+
+        void WriteU8(std::vector<uint8_t> &data, uint8_t integer)
+        {
+            data.emplace_back(integer);
+        }
+
+        void WriteU32(std::vector<uint8_t> &data, uint32_t integer)
+        {
+            auto bytes = ToU32ByteList(integer);
+            data.insert(data.end(), bytes.begin(), bytes.end());
+        }
+
+        void WriteU64(std::vector<uint8_t> &data, uint64_t integer)
+        {
+            auto bytes = ToU64ByteList(integer);
+            data.insert(data.end(), bytes.begin(), bytes.end());
+        }
+
+        void WriteVarUint(std::vector<uint8_t> &data, uint64_t integer)
+        {
+            while (integer >= 0x80)
+            {
+                data.emplace_back(static_cast<uint8_t>(integer | 0x80));
+                integer >>= 7;
+            }
+            data.emplace_back(static_cast<uint8_t>(integer));
+        }
+
+        void WriteVarInt(std::vector<uint8_t> &data, int64_t integer)
+        {
+            WriteVarUint(data, (static_cast<uint64_t>(integer) << 1) ^ static_cast<uint64_t>(integer >> 63));
+        }
+
+        static void CheckReadable(std::span<const uint8_t> data, size_t offset, size_t size)
+        {
+            if (offset > data.size() || size > data.size() - offset)
+                CYS_LOG_ERROR(TEXT("Truncated CynicScript binary data,cannot read {} bytes at {}"), size, offset);
+        }
+
+        uint8_t ReadU8(std::span<const uint8_t> data, size_t &offset)
+        {
+            CheckReadable(data, offset, 1);
+            return data[offset++];
+        }
+
+        uint32_t ReadU32(std::span<const uint8_t> data, size_t &offset)
+        {
+            CheckReadable(data, offset, 4);
+            auto v = GetU32Integer(data, offset);
+            offset += 4;
+            return v;
+        }
+
+        uint64_t ReadU64(std::span<const uint8_t> data, size_t &offset)
+        {
+            CheckReadable(data, offset, 8);
+            auto v = GetU64Integer(data, offset);
+            offset += 8;
+            return v;
+        }
+
+        const uint8_t *ReadBytes(std::span<const uint8_t> data, size_t &offset, size_t size)
+        {
+            CheckReadable(data, offset, size);
+            auto result = data.data() + offset;
+            offset += size;
+            return result;
+        }
+
+        uint64_t ReadVarUint(std::span<const uint8_t> data, size_t &offset)
+        {
+            uint64_t v{0};
+            for (uint32_t shift = 0; shift < 64; shift += 7)
+            {
+                CheckReadable(data, offset, 1);
+                auto byte = data[offset++];
+                v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                    return v;
+            }
+            CYS_LOG_ERROR(TEXT("Invalid CynicScript binary data,var integer at {} is longer than 64 bits"), offset);
+            return v;
+        }
+
+        int64_t ReadVarInt(std::span<const uint8_t> data, size_t &offset)
+        {
+            auto v = ReadVarUint(data, offset);
+            return static_cast<int64_t>((v >> 1) ^ (~(v & 1) + 1));
+        }
+    }
+
+    uint64_t HashBytes(const void *data, size_t size, uint64_t seed)
+    {
+        auto bytes = static_cast<const uint8_t *>(data);
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3;
+        }
+        return hash;
     }
 }
\ No newline at end of file
@@ -3,13 +3,24 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <span>
 
-#define STACK_MAX 1024
-#define GLOBAL_VARIABLE_MAX 512
+#define STACK_MAX (UINT16_COUNT * 2) // a frame addresses up to 65536 locals through OP_WIDE,with room for the frames below
+#define CALL_FRAME_MAX 1024
+#define GLOBAL_VARIABLE_MAX UINT16_COUNT
 
 #define UINT8_COUNT (UINT8_MAX + 1)
+#define UINT16_COUNT (UINT16_MAX + 1)
+#define UINT24_COUNT (1 << 24)
 
 #define GC_HEAP_GROW_FACTOR 2
+#define GC_PAUSE_HISTOGRAM_BUCKET_COUNT 16
+
+#define HEAP_PROFILE_DEFAULT_SAMPLE_INTERVAL 4096
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+#define BYTECODE_IMAGE_PAGE_SIZE 4096
 
 #ifndef CYS_BUILD_STATIC
 #if defined(_WIN32) || defined(_WIN64)
@@ -59,6 +70,16 @@
 #define STRCMP strcmp
 #endif
 
+// Source text is read and scanned as utf-8 bytes whatever the runtime string type is,the lexer and parser
+// only convert to STRING when they materialize a name or a literal for the runtime.
+#define SOURCE_CHAR_T char
+#define SOURCE_STRING std::string
+#define SOURCE_STRING_VIEW std::string_view
+#define UTF8_BOM SOURCE_STRING_VIEW("\xEF\xBB\xBF")
+
+#define LEXER_PARALLEL_THRESHOLD_DEFAULT (8 * 1024 * 1024)
+#define LEXER_PARALLEL_MIN_CHUNK_SIZE (1024 * 1024)
+
 #define MAIN_ENTRY_FUNCTION_NAME TEXT("_main_start_up")
 
 #define NON_COPYABLE(T)                     \
@@ -104,7 +125,7 @@ namespace CynicScript
 		WITH_NAME,
 	};
 
-	STRING CYS_API ReadFile(std::string_view path);
+	SOURCE_STRING CYS_API ReadFile(std::string_view path);
 	void CYS_API WriteBinaryFile(std::string_view path, const std::vector<uint8_t> &content);
 	std::vector<uint8_t> CYS_API ReadBinaryFile(std::string_view path);
 
@@ -118,14 +139,40 @@ namespace CynicScript
 	{
 		std::string Encode(const std::wstring &str);
 		std::wstring Decode(const std::string &str);
+
+		constexpr uint32_t INVALID_CODE_POINT = 0xFFFFFFFF;
+
+		// decode the sequence starting at p,length receives its byte count,INVALID_CODE_POINT for a malformed sequence
+		uint32_t CYS_API DecodeCodePoint(const char *p, size_t n, size_t &length);
 	}
 
+	STRING CYS_API SourceToString(SOURCE_STRING_VIEW source);
+	SOURCE_STRING CYS_API StringToSource(STRING_VIEW str);
+
 	namespace ByteConverter
 	{
 		std::array<uint8_t, 8> ToU64ByteList(int64_t integer);
-		uint64_t GetU64Integer(const std::vector<uint8_t> data, uint32_t start);
+		uint64_t GetU64Integer(std::span<const uint8_t> data, size_t start);
 
 		std::array<uint8_t, 4> ToU32ByteList(int32_t integer);
-		uint32_t GetU32Integer(const std::vector<uint8_t> data, uint32_t start);
+		uint32_t GetU32Integer(std::span<const uint8_t> data, size_t start);
+
+		// append to data,fixed size integers are big endian,var integers are LEB128 with signed ones zigzag encoded
+		void WriteU8(std::vector<uint8_t> &data, uint8_t integer);
+		void WriteU32(std::vector<uint8_t> &data, uint32_t integer);
+		void WriteU64(std::vector<uint8_t> &data, uint64_t integer);
+		void WriteVarUint(std::vector<uint8_t> &data, uint64_t integer);
+		void WriteVarInt(std::vector<uint8_t> &data, int64_t integer);
+
+		// read at offset and advance it past the value
+		uint8_t ReadU8(std::span<const uint8_t> data, size_t &offset);
+		uint32_t ReadU32(std::span<const uint8_t> data, size_t &offset);
+		uint64_t ReadU64(std::span<const uint8_t> data, size_t &offset);
+		uint64_t ReadVarUint(std::span<const uint8_t> data, size_t &offset);
+		int64_t ReadVarInt(std::span<const uint8_t> data, size_t &offset);
+		const uint8_t *ReadBytes(std::span<const uint8_t> data, size_t &offset, size_t size);
 	}
+
+	// 64 bit FNV-1a,chain calls by passing the previous result as seed
+	uint64_t CYS_API HashBytes(const void *data, size_t size, uint64_t seed = 0xCBF29CE484222325);
 }
\ No newline at end of file
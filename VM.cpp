@@ -5,6 +5,7 @@
 #include "Object.h"
 #include "Token.h"
 #include "Logger.h"
+#include "ModuleManager.h"
 namespace CynicScript
 {
 	std::vector<Value> VM::Run(FunctionObject *mainFunc) noexcept
@@ -17,7 +18,7 @@ namespace CynicScript
 
 		CallFrame mainCallFrame;
 		mainCallFrame.closure = closure;
-		mainCallFrame.ip = closure->function->chunk.opCodes.data();
+		mainCallFrame.ip = closure->function->chunk.GetOpCodes();
 		mainCallFrame.slots = STACK_TOP() - 1;
 
 		PUSH_CALL_FRAME(mainCallFrame);
@@ -38,7 +39,7 @@ namespace CynicScript
 		return returnValues;
 	}
 
-	void VM::Execute()
+	void VM::Execute(size_t baseCallFrameCount)
 	{
 		//  - * /
 #define COMMON_BINARY(op)                                                                                                                                                                                                    \
@@ -117,6 +118,13 @@ namespace CynicScript
 	} while (0);
 
 #define READ_INS() (*frame->ip++)
+#define READ_INS_U16() (frame->ip += 2, static_cast<uint16_t>(frame->ip[-2] << 8 | frame->ip[-1]))
+#define READ_INS_U24() (frame->ip += 3, static_cast<uint32_t>(frame->ip[-3]) << 16 | frame->ip[-2] << 8 | frame->ip[-1])
+#define READ_INS_U32() (frame->ip += 4, static_cast<uint32_t>(frame->ip[-4]) << 24 | static_cast<uint32_t>(frame->ip[-3]) << 16 | frame->ip[-2] << 8 | frame->ip[-1])
+
+// slot indices and element counts,widened by a preceding OP_WIDE
+#define READ_OPERAND() (isWide ? READ_INS_U16() : READ_INS())
+#define READ_JUMP_OFFSET() (isWide ? READ_INS_U32() : READ_INS_U16())
 
 #define CHECK_IDX_RANGE(v, idx)                 \
 	if (idx < 0 || idx >= (uint64_t)(v).size()) \
@@ -126,14 +134,18 @@ namespace CynicScript
 	if (!CYS_IS_INT_VALUE(idxValue))  \
 		CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("Invalid idx type for array or string,only integer is available."));
 
+		bool isWide = false;
 		while (1)
 		{
-			if (CYS_IS_CALL_FRAME_STACK_EMPTY())
+			if (CALL_FRAME_COUNT() == baseCallFrameCount)
 				return;
 			CallFrame *frame = PEEK_CALL_FRAME(0);
 
 			auto instruction = READ_INS();
-			auto relatedToken = frame->closure->function->chunk.opCodeRelatedTokens[READ_INS()];
+			auto relatedToken = frame->closure->function->chunk.opCodeRelatedTokens[READ_INS_U16()];
+#ifdef CYS_HEAP_PROFILE
+			frame->relatedToken = relatedToken;
+#endif
 			switch (instruction)
 			{
 			case OP_RETURN:
@@ -180,9 +192,10 @@ namespace CynicScript
 				break;
 			}
 			case OP_CONSTANT:
+			case OP_CONSTANT_LONG:
 			{
-				auto pos = READ_INS();
-				auto v = frame->closure->function->chunk.constants[pos];
+				auto pos = instruction == OP_CONSTANT ? READ_INS() : READ_INS_U24();
+				auto v = frame->closure->function->chunk.GetConstant(pos);
 				PUSH_STACK(v);
 				break;
 			}
@@ -193,7 +206,7 @@ namespace CynicScript
 			}
 			case OP_SET_GLOBAL:
 			{
-				auto pos = READ_INS();
+				auto pos = READ_OPERAND();
 				auto v = PEEK_STACK(0);
 
 				auto globalValue = GET_GLOBAL_VARIABLE(pos);
@@ -206,13 +219,13 @@ namespace CynicScript
 			}
 			case OP_GET_GLOBAL:
 			{
-				auto pos = READ_INS();
+				auto pos = READ_OPERAND();
 				PUSH_STACK(*GET_GLOBAL_VARIABLE(pos));
 				break;
 			}
 			case OP_SET_LOCAL:
 			{
-				auto pos = READ_INS();
+				auto pos = READ_OPERAND();
 				auto value = PEEK_STACK(0);
 
 				auto slot = frame->slots + pos;
@@ -225,20 +238,20 @@ namespace CynicScript
 			}
 			case OP_GET_LOCAL:
 			{
-				auto pos = READ_INS();
+				auto pos = READ_OPERAND();
 				PUSH_STACK(frame->slots[pos]); // now assume base ptr on the stack bottom
 				break;
 			}
 			case OP_SET_UPVALUE:
 			{
-				auto pos = READ_INS();
+				auto pos = READ_OPERAND();
 				auto v = PEEK_STACK(0);
 				*frame->closure->upvalues[pos]->location = PEEK_STACK(0);
 				break;
 			}
 			case OP_GET_UPVALUE:
 			{
-				auto pos = READ_INS();
+				auto pos = READ_OPERAND();
 				PUSH_STACK(*frame->closure->upvalues[pos]->location);
 				break;
 			}
@@ -372,7 +385,7 @@ namespace CynicScript
 			}
 			case OP_ARRAY:
 			{
-				auto count = READ_INS();
+				auto count = READ_OPERAND();
 
 				std::vector<Value> elements(count);
 				size_t i = 0;
@@ -388,7 +401,7 @@ namespace CynicScript
 			}
 			case OP_DICT:
 			{
-				auto count = READ_INS();
+				auto count = READ_OPERAND();
 				ValueUnorderedMap elements;
 
 				auto dict = Allocator::GetInstance()->CreateObject<DictObject>(elements);
@@ -479,44 +492,44 @@ namespace CynicScript
 			}
 			case OP_JUMP_IF_FALSE:
 			{
-				uint16_t address = (*(frame->ip++) << 8) | (*(frame->ip++));
+				auto address = READ_JUMP_OFFSET();
 				if (IsFalsey(PEEK_STACK(0)))
 					frame->ip += address;
 				break;
 			}
 			case OP_JUMP:
 			{
-				uint16_t address = (*(frame->ip++) << 8) | (*(frame->ip++));
+				auto address = READ_JUMP_OFFSET();
 				frame->ip += address;
 				break;
 			}
 			case OP_LOOP:
 			{
-				uint16_t address = (*(frame->ip++) << 8) | (*(frame->ip++));
+				auto address = READ_JUMP_OFFSET();
 				frame->ip -= address;
 				break;
 			}
 			case OP_REF_GLOBAL:
 			{
-				auto index = READ_INS();
+				auto index = READ_OPERAND();
 				PUSH_STACK(Allocator::GetInstance()->CreateObject<RefObject>(GET_GLOBAL_VARIABLE(index)));
 				break;
 			}
 			case OP_REF_LOCAL:
 			{
-				auto index = READ_INS();
+				auto index = READ_OPERAND();
 				PUSH_STACK(Allocator::GetInstance()->CreateObject<RefObject>(frame->slots + index));
 				break;
 			}
 			case OP_REF_UPVALUE:
 			{
-				auto index = READ_INS();
+				auto index = READ_OPERAND();
 				PUSH_STACK(Allocator::GetInstance()->CreateObject<RefObject>(frame->closure->upvalues[index]->location));
 				break;
 			}
 			case OP_REF_INDEX_GLOBAL:
 			{
-				auto index = READ_INS();
+				auto index = READ_OPERAND();
 				auto idxValue = POP_STACK();
 
 				auto globalValue = GET_GLOBAL_VARIABLE(index);
@@ -537,7 +550,7 @@ namespace CynicScript
 			}
 			case OP_REF_INDEX_LOCAL:
 			{
-				auto index = READ_INS();
+				auto index = READ_OPERAND();
 				auto idxValue = POP_STACK();
 				Value *v = frame->slots + index;
 				if (CYS_IS_DICT_VALUE((*v)))
@@ -556,7 +569,7 @@ namespace CynicScript
 			}
 			case OP_REF_INDEX_UPVALUE:
 			{
-				auto index = READ_INS();
+				auto index = READ_OPERAND();
 				auto idxValue = POP_STACK();
 				Value *v = frame->closure->upvalues[index]->location;
 				if (CYS_IS_DICT_VALUE((*v)))
@@ -575,7 +588,7 @@ namespace CynicScript
 			}
 			case OP_CALL:
 			{
-				auto argCount = READ_INS();
+				auto argCount = READ_OPERAND();
 				auto callee = PEEK_STACK(argCount);
 				if (CYS_IS_CLOSURE_VALUE(callee) || CYS_IS_CLASS_CLOSURE_BIND_VALUE(callee)) // normal function or class member function
 				{
@@ -642,7 +655,7 @@ namespace CynicScript
 						// init a new frame
 						CallFrame newframe;
 						newframe.closure = CYS_TO_CLOSURE_VALUE(callee);
-						newframe.ip = newframe.closure->function->chunk.opCodes.data();
+						newframe.ip = newframe.closure->function->chunk.GetOpCodes();
 						newframe.slots = STACK_TOP() - argCount - 1;
 #ifdef CYS_FUNCTION_CACHE_OPT
 						newframe.argumentsHash = argsHash;
@@ -668,7 +681,7 @@ namespace CynicScript
 						// init a new frame
 						CallFrame newframe;
 						newframe.closure = ctor;
-						newframe.ip = newframe.closure->function->chunk.opCodes.data();
+						newframe.ip = newframe.closure->function->chunk.GetOpCodes();
 						newframe.slots = STACK_TOP() - argCount - 1;
 
 						PUSH_CALL_FRAME(newframe);
@@ -694,10 +707,10 @@ namespace CynicScript
 			case OP_CLASS:
 			{
 				auto name = PEEK_STACK(0);
-				auto ctorCount = READ_INS();
-				auto varCount = READ_INS();
-				auto constCount = READ_INS();
-				auto parentClassCount = READ_INS();
+				auto ctorCount = READ_OPERAND();
+				auto varCount = READ_OPERAND();
+				auto constCount = READ_OPERAND();
+				auto parentClassCount = READ_OPERAND();
 
 				auto classObj = Allocator::GetInstance()->CreateObject<ClassObject>();
 
@@ -738,7 +751,7 @@ namespace CynicScript
 			}
 			case OP_STRUCT:
 			{
-				auto eCount = READ_INS();
+				auto eCount = READ_OPERAND();
 				auto structObj = Allocator::GetInstance()->CreateObject<StructObject>();
 				for (int64_t i = 0; i < (int64_t)eCount; ++i)
 				{
@@ -870,9 +883,10 @@ namespace CynicScript
 				break;
 			}
 			case OP_CLOSURE:
+			case OP_CLOSURE_LONG:
 			{
-				auto pos = READ_INS();
-				auto func = CYS_TO_FUNCTION_VALUE(frame->closure->function->chunk.constants[pos]);
+				auto pos = instruction == OP_CLOSURE ? READ_INS() : READ_INS_U24();
+				auto func = CYS_TO_FUNCTION_VALUE(frame->closure->function->chunk.GetConstant(pos));
 
 				PUSH_STACK(func); // push function object for avoiding gc
 				auto closure = Allocator::GetInstance()->CreateObject<ClosureObject>(func);
@@ -882,7 +896,7 @@ namespace CynicScript
 
 				for (int32_t i = 0; i < closure->upvalues.size(); ++i)
 				{
-					auto index = READ_INS();
+					auto index = READ_OPERAND();
 					auto depth = READ_INS();
 					if (depth == CALL_FRAME_COUNT() - 1)
 					{
@@ -994,8 +1008,8 @@ namespace CynicScript
 				auto name = PEEK_STACK(0);
 				auto nameStr = CYS_TO_STR_VALUE(name)->value;
 
-				auto varCount = READ_INS();
-				auto constCount = READ_INS();
+				auto varCount = READ_OPERAND();
+				auto constCount = READ_OPERAND();
 
 				auto moduleObj = Allocator::GetInstance()->CreateObject<ModuleObject>();
 				moduleObj->name = nameStr;
@@ -1023,6 +1037,44 @@ namespace CynicScript
 
 				break;
 			}
+			case OP_IMPORT:
+			{
+				// relative to the file the import is written in,tokens of a program loaded from a binary file don't know it
+				std::string importerPath;
+				if (relatedToken->sourceId != 0)
+					importerPath = StringToSource(Logger::Record::mSourceFiles[relatedToken->sourceId - 1].first);
+				auto path = ModuleManager::GetInstance()->Resolve(CYS_TO_STR_VALUE(POP_STACK())->value, importerPath);
+				if (auto moduleObj = Allocator::GetInstance()->GetImportedModule(path))
+				{
+					PUSH_STACK(moduleObj);
+					break;
+				}
+
+				auto function = ModuleManager::GetInstance()->GetModuleFunction(path, relatedToken);
+				for (size_t i = 0; i < CALL_FRAME_COUNT(); ++i)
+					if (PEEK_CALL_FRAME(i)->closure->function == function)
+						CYS_LOG_ERROR_WITH_LOC(relatedToken, TEXT("Circular import of {}."), SourceToString(path));
+
+				// the module function runs to completion before the import goes on,it takes a null per symbol like
+				// the function of a module declaration and leaves the module object on the stack
+				PUSH_STACK(function);
+				auto closure = Allocator::GetInstance()->CreateObject<ClosureObject>(function);
+				POP_STACK();
+				PUSH_STACK(closure);
+				for (uint32_t i = 0; i < function->arity; ++i)
+					PUSH_STACK(Value());
+
+				CallFrame moduleCallFrame{};
+				moduleCallFrame.closure = closure;
+				moduleCallFrame.ip = function->chunk.GetOpCodes();
+				moduleCallFrame.slots = STACK_TOP() - function->arity - 1;
+				PUSH_CALL_FRAME(moduleCallFrame);
+
+				Execute(CALL_FRAME_COUNT() - 1);
+
+				Allocator::GetInstance()->SetImportedModule(path, CYS_TO_MODULE_VALUE(PEEK_STACK(0)));
+				break;
+			}
 			case OP_RESET:
 			{
 				auto count = READ_INS();
@@ -1039,9 +1091,16 @@ namespace CynicScript
 				}
 				break;
 			}
+			case OP_WIDE:
+			{
+				isWide = true;
+				continue; // keep it for the next instruction
+			}
 			default:
 				break;
 			}
+
+			isWide = false;
 		}
 	}
 
@@ -16,7 +16,8 @@ namespace CynicScript
         std::vector<Value> Run(FunctionObject *mainFunc) noexcept;
 
     private:
-        void Execute();
+        // returns once the frames above baseCallFrameCount have returned
+        void Execute(size_t baseCallFrameCount = 0);
 
         bool IsFalsey(const Value &v) noexcept;
     };
@@ -1,5 +1,6 @@
 #include "Value.h"
 #include "Object.h"
+#include "BytecodeImage.h"
 namespace CynicScript
 {
     Value::Value() noexcept
@@ -55,29 +56,38 @@ namespace CynicScript
             object->UnMark();
     }
 
-    std::vector<uint8_t> Value::Serialize() const
+    void Value::Serialize(BytecodeWriter &writer) const
     {
-        std::vector<uint8_t> result;
+        // kind in the low and permission in the high nibble
+        writer.WriteU8(kind | (static_cast<uint8_t>(std::underlying_type<Permission>::type(permission)) << 4));
 
-        result.emplace_back(kind);
-        result.emplace_back(static_cast<uint8_t>(std::underlying_type<Permission>::type(permission)));
-
-        if (CYS_IS_INT_VALUE(*this) || CYS_IS_REAL_VALUE(*this) || CYS_IS_BOOL_VALUE(*this))
+        if (CYS_IS_BOOL_VALUE(*this))
+            writer.WriteU8(boolean ? 1 : 0);
+        else if (CYS_IS_INT_VALUE(*this))
+            writer.WriteVarInt(integer);
+        else if (CYS_IS_REAL_VALUE(*this))
+            writer.WriteU64(integer);
+        else if (CYS_IS_OBJECT_VALUE(*this))
         {
-            auto byteList = ByteConverter::ToU64ByteList(integer);
-            result.insert(result.end(), byteList.begin(), byteList.end());
+            writer.WriteU8(static_cast<uint8_t>(object->kind));
+            object->Serialize(writer);
         }
-
-        return result;
     }
 
-    void Value::Deserialize(const std::vector<uint8_t> &data)
+    void Value::Deserialize(const BytecodeImage &image, size_t &offset)
     {
-        kind = (ValueKind)data[0];
-        permission = (Permission)data[1];
+        auto kindAndPermission = image.ReadU8(offset);
+        kind = (ValueKind)(kindAndPermission & 0x0F);
+        permission = (Permission)(kindAndPermission >> 4);
 
-        if (CYS_IS_INT_VALUE(*this) || CYS_IS_REAL_VALUE(*this) || CYS_IS_BOOL_VALUE(*this))
-            integer = ByteConverter::GetU64Integer(data, 2);
+        if (CYS_IS_BOOL_VALUE(*this))
+            boolean = image.ReadU8(offset) != 0;
+        else if (CYS_IS_INT_VALUE(*this))
+            integer = image.ReadVarInt(offset);
+        else if (CYS_IS_REAL_VALUE(*this))
+            integer = image.ReadU64(offset);
+        else if (CYS_IS_OBJECT_VALUE(*this))
+            object = DeserializeObject(image, offset);
     }
 
     bool operator==(const Value &left, const Value &right)
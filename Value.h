@@ -4,6 +4,9 @@
 #include "Utils.h"
 namespace CynicScript
 {
+	class BytecodeWriter;
+	class BytecodeImage;
+
 	enum ValueKind : uint8_t
 	{
 		NIL,
@@ -26,8 +29,8 @@ namespace CynicScript
 		void Mark() const;
 		void UnMark() const;
 
-		std::vector<uint8_t> Serialize() const;
-		void Deserialize(const std::vector<uint8_t> &data);
+		void Serialize(BytecodeWriter &writer) const;
+		void Deserialize(const BytecodeImage &image, size_t &offset);
 
 		ValueKind kind;
 		Permission permission = Permission::MUTABLE;
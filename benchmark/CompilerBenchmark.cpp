@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include "Lexer.h"
+#include "Parser.h"
+#include "Compiler.h"
+#include "BytecodeCache.h"
+#include "Ast.h"
+#include "Logger.h"
+
+namespace
+{
+	// top level functions and modules,every one is a body the compiler defers and hands to a worker
+	SOURCE_STRING GenerateProgram(size_t functionCount)
+	{
+		SOURCE_STRING program;
+		for (size_t i = 0; i < functionCount; ++i)
+		{
+			auto index = std::to_string(i);
+			auto factor = std::to_string(i % 13 + 1);
+			program += "fn func" + index + "(x,y){\n";
+			program += "    let a=x*" + factor + "+y;\n";
+			program += "    let arr=[a,y," + factor + ".5,true];\n";
+			program += "    while(a<" + factor + "00){\n";
+			program += "        if(a%2==0)\n";
+			program += "            a=a+arr[0];\n";
+			program += "        else\n";
+			program += "            a=a*2+1;\n";
+			program += "    }\n";
+			if (i > 0)
+				program += "    if(a>" + factor + "000) return func" + std::to_string(i - 1) + "(a,y);\n";
+			program += "    return a;\n";
+			program += "}\n";
+
+			if (i % 4 == 0)
+			{
+				program += "module m" + index + "{\n";
+				program += "    let v=" + index + ";\n";
+				program += "    fn g(x){ return x+v+func" + index + "(x,1); }\n";
+				program += "}\n";
+			}
+		}
+		program += "let result=func" + std::to_string(functionCount - 1) + "(1,2);\n";
+		return program;
+	}
+}
+
+// Compiler throughput over a generated program of many top level functions and modules,compiled on the calling
+// thread and by parallel workers.The serialized bytecode of both has to be the same byte for byte.
+// Usage: CynicScriptCompilerBenchmark [function count] [iterations] [parallel workers,0 for one per hardware thread]
+int main(int argc, char **argv)
+{
+	size_t functionCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+	size_t iterations = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5;
+	size_t workerCount = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 0;
+
+	if (functionCount == 0)
+	{
+		std::fprintf(stderr, "at least one function is needed\n");
+		return EXIT_FAILURE;
+	}
+
+	auto program = GenerateProgram(functionCount);
+
+	CynicScript::Lexer lexer;
+	const auto &tokens = lexer.ScanTokens(program);
+	CynicScript::Parser parser;
+
+	CynicScript::Compiler serialCompiler;
+	serialCompiler.SetParallelWorkerCount(1);
+	CynicScript::Compiler parallelCompiler;
+	parallelCompiler.SetParallelWorkerCount(workerCount);
+
+	auto measure = [&](CynicScript::Compiler &compiler, std::vector<uint8_t> &bytecode)
+	{
+		double bestSeconds = 0.0;
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			auto stmt = parser.Parse(tokens);
+			auto start = std::chrono::steady_clock::now();
+			auto mainFunc = compiler.Compile(stmt);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (i == 0 || seconds < bestSeconds)
+				bestSeconds = seconds;
+
+			bytecode = CynicScript::BytecodeCache::Serialize(mainFunc);
+			CynicScript::AstArena::GetInstance()->Release();
+		}
+		return bestSeconds;
+	};
+
+	std::vector<uint8_t> serialBytecode;
+	std::vector<uint8_t> parallelBytecode;
+	double serialSeconds = measure(serialCompiler, serialBytecode);
+	double parallelSeconds = measure(parallelCompiler, parallelBytecode);
+
+	double megaBytes = static_cast<double>(program.size()) / (1024.0 * 1024.0);
+	CynicScript::Logger::Println(TEXT("compiler: {} functions, {} MB, {} tokens, {} KB bytecode, best of {}: {} ms, {} MB/s"),
+								 functionCount, megaBytes, tokens.size(), serialBytecode.size() / 1024, iterations, serialSeconds * 1000.0, megaBytes / serialSeconds);
+	CynicScript::Logger::Println(TEXT("parallel compiler({} workers): {} KB bytecode, best of {}: {} ms, {} MB/s"),
+								 workerCount == 0 ? std::thread::hardware_concurrency() : workerCount, parallelBytecode.size() / 1024, iterations, parallelSeconds * 1000.0, megaBytes / parallelSeconds);
+
+	if (serialBytecode.size() != parallelBytecode.size())
+	{
+		std::fprintf(stderr, "parallel bytecode has %zu bytes,the serial one %zu\n", parallelBytecode.size(), serialBytecode.size());
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < serialBytecode.size(); ++i)
+	{
+		if (serialBytecode[i] != parallelBytecode[i])
+		{
+			std::fprintf(stderr, "parallel bytecode differs from the serial one at byte %zu\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <cstdint>
+#include "Lexer.h"
+#include "Logger.h"
+#include "SimdScan.h"
+
+#ifndef CYS_BENCHMARK_CORPUS_DIR
+#define CYS_BENCHMARK_CORPUS_DIR "examples"
+#endif
+
+// Lexer throughput over a corpus built from the example scripts,repeated until it reaches the target size.
+// The parallel scan is timed too and its token stream has to equal the serial one.
+// Usage: CynicScriptLexerBenchmark [corpus directory] [target size in MB] [iterations] [parallel workers,0 for one per hardware thread]
+int main(int argc, char **argv)
+{
+	std::string corpusDir = argc > 1 ? argv[1] : CYS_BENCHMARK_CORPUS_DIR;
+	size_t targetBytes = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 16) * 1024 * 1024;
+	size_t iterations = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10;
+	size_t workerCount = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 0;
+
+	std::vector<std::filesystem::path> files;
+	for (const auto &entry : std::filesystem::directory_iterator(corpusDir))
+		if (entry.is_regular_file() && entry.path().extension() == ".cys")
+			files.emplace_back(entry.path());
+	std::sort(files.begin(), files.end());
+
+	if (files.empty())
+	{
+		std::fprintf(stderr, "no .cys file found in %s\n", corpusDir.c_str());
+		return EXIT_FAILURE;
+	}
+
+	// examples marked with an //ERROR comment demonstrate lexing or parsing errors and would stop the run
+	SOURCE_STRING unit;
+	size_t unitBytes = 0;
+	size_t usedFileCount = 0;
+	for (const auto &file : files)
+	{
+		auto content = CynicScript::ReadFile(file.string());
+		if (content.find("//ERROR") != SOURCE_STRING::npos)
+			continue;
+		unit += content;
+		unit += "\n";
+		unitBytes += content.size() + 1;
+		usedFileCount++;
+	}
+
+	SOURCE_STRING corpus;
+	size_t corpusBytes = 0;
+	while (corpusBytes < targetBytes)
+	{
+		corpus += unit;
+		corpusBytes += unitBytes;
+	}
+
+	// the serial lexer never splits the corpus,the parallel one always does when it is large enough for two chunks
+	CynicScript::Lexer serialLexer;
+	serialLexer.SetParallelThreshold(SIZE_MAX);
+	CynicScript::Lexer parallelLexer;
+	parallelLexer.SetParallelThreshold(0);
+	parallelLexer.SetParallelWorkerCount(workerCount);
+
+	auto measure = [&](CynicScript::Lexer &lexer, size_t &tokenCount)
+	{
+		double bestSeconds = 0.0;
+		for (size_t i = 0; i < iterations; ++i)
+		{
+			auto start = std::chrono::steady_clock::now();
+			tokenCount = lexer.ScanTokens(corpus).size();
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			if (i == 0 || seconds < bestSeconds)
+				bestSeconds = seconds;
+		}
+		return bestSeconds;
+	};
+
+	size_t serialTokenCount = 0;
+	size_t parallelTokenCount = 0;
+	double serialSeconds = measure(serialLexer, serialTokenCount);
+	double parallelSeconds = measure(parallelLexer, parallelTokenCount);
+
+	double megaBytes = static_cast<double>(corpusBytes) / (1024.0 * 1024.0);
+	CynicScript::Logger::Println(TEXT("lexer({}): {} files, {} MB, {} tokens, best of {}: {} ms, {} MB/s"),
+								 CynicScript::GetSimdScanInstructionSet(), usedFileCount, megaBytes, serialTokenCount, iterations, serialSeconds * 1000.0, megaBytes / serialSeconds);
+	CynicScript::Logger::Println(TEXT("parallel lexer({} workers): {} tokens, best of {}: {} ms, {} MB/s"),
+								 workerCount == 0 ? std::thread::hardware_concurrency() : workerCount, parallelTokenCount, iterations, parallelSeconds * 1000.0, megaBytes / parallelSeconds);
+
+	// both lexers still hold the tokens of their last scan of the same corpus
+	const auto &serialTokens = serialLexer.ScanTokens(corpus);
+	const auto &parallelTokens = parallelLexer.ScanTokens(corpus);
+	for (size_t i = 0; i < std::max(serialTokens.size(), parallelTokens.size()); ++i)
+	{
+		if (i >= serialTokens.size() || i >= parallelTokens.size())
+		{
+			std::fprintf(stderr, "parallel token stream has %zu tokens,the serial one %zu\n", parallelTokens.size(), serialTokens.size());
+			return EXIT_FAILURE;
+		}
+
+		const auto *serial = serialTokens[i];
+		const auto *parallel = parallelTokens[i];
+		if (serial->kind != parallel->kind || serial->literal != parallel->literal || serial->atom != parallel->atom ||
+			serial->sourceLocation.line != parallel->sourceLocation.line || serial->sourceLocation.column != parallel->sourceLocation.column ||
+			serial->sourceLocation.pos != parallel->sourceLocation.pos)
+		{
+			std::fprintf(stderr, "parallel token stream differs from the serial one at token %zu(line %llu)\n", i, static_cast<unsigned long long>(serial->sourceLocation.line));
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
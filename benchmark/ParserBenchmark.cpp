@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Lexer.h"
+#include "Parser.h"
+#include "Ast.h"
+#include "Logger.h"
+
+namespace
+{
+	// deterministic generator so every run parses the same corpus
+	class Random
+	{
+	public:
+		uint32_t Next(uint32_t bound)
+		{
+			mState = mState * 6364136223846793005ull + 1442695040888963407ull;
+			return static_cast<uint32_t>(mState >> 33) % bound;
+		}
+
+	private:
+		uint64_t mState{0x2545F4914F6CDD1Dull};
+	};
+
+	const char *gLeaves[] = {"a", "b", "1", "42", "2.5", "\"s\"", "obj.field", "arr[i]", "fn0(x)", "obj.inner.value"};
+	const char *gBinaryOperators[] = {"+", "-", "*", "/", "%", "==", "!=", "<", "<=", ">", ">=", "&&", "||", "&", "|", "^", "<<", ">>"};
+
+	// nests depth levels of operators,calls,indexing and conditions around a leaf,every level walks the whole precedence chain
+	std::string GenerateExpr(Random &random, size_t depth)
+	{
+		std::string expr = gLeaves[random.Next(std::size(gLeaves))];
+		for (size_t i = 0; i < depth; ++i)
+		{
+			const char *leaf = gLeaves[random.Next(std::size(gLeaves))];
+			switch (random.Next(6))
+			{
+			case 0:
+				expr = "-(" + expr + ")";
+				break;
+			case 1:
+				expr = "fn1(" + expr + "," + leaf + ")";
+				break;
+			case 2:
+				expr = "arr[" + expr + "]";
+				break;
+			case 3:
+				expr = "(" + expr + "?" + leaf + ":" + leaf + ")";
+				break;
+			default:
+				expr = std::string("(") + leaf + " " + gBinaryOperators[random.Next(std::size(gBinaryOperators))] + " " + expr + ")";
+				break;
+			}
+		}
+		return expr;
+	}
+}
+
+// Parser throughput over generated statements made of deeply nested expressions,tokens are scanned once up front.
+// Usage: CynicScriptParserBenchmark [nesting depth] [target size in MB] [iterations]
+int main(int argc, char **argv)
+{
+	size_t depth = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 64;
+	size_t targetBytes = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 4) * 1024 * 1024;
+	size_t iterations = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 10;
+
+	Random random;
+	SOURCE_STRING corpus;
+	size_t stmtCount = 0;
+	while (corpus.size() < targetBytes)
+	{
+		corpus += "let v" + std::to_string(stmtCount) + "=" + GenerateExpr(random, depth) + ";\n";
+		stmtCount++;
+	}
+
+	CynicScript::Lexer lexer;
+	const auto &tokens = lexer.ScanTokens(corpus);
+
+	CynicScript::Parser parser;
+	double bestSeconds = 0.0;
+	size_t astBytes = 0;
+	for (size_t i = 0; i < iterations; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		parser.Parse(tokens);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (i == 0 || seconds < bestSeconds)
+			bestSeconds = seconds;
+
+		astBytes = CynicScript::AstArena::GetInstance()->GetAllocatedBytes();
+		CynicScript::AstArena::GetInstance()->Release();
+	}
+
+	double megaBytes = static_cast<double>(corpus.size()) / (1024.0 * 1024.0);
+	CynicScript::Logger::Println(TEXT("parser: depth {}, {} stmts, {} MB, {} tokens, {} KB ast, best of {}: {} ms, {} MB/s, {} Mtokens/s"),
+								 depth, stmtCount, megaBytes, tokens.size(), astBytes / 1024, iterations, bestSeconds * 1000.0, megaBytes / bestSeconds, tokens.size() / bestSeconds / 1e6);
+	return EXIT_SUCCESS;
+}